@@ -36,10 +36,14 @@ class SemiLocalFunAA;
 class CallsiteDepthCombinator : public ModulePass, public liberty::LoopAA {
   typedef DenseMap<IIKey, bool> IICache;
   typedef DenseMap<IIKey, Remedies> IICacheR;
+  typedef DenseMap<IIKey, unsigned> IIConsulted;
 
   IICache iiCache;
   IICacheR iiCacheR;
 
+  // Lowest stack position consulted by each entry.
+  IIConsulted iiConsulted;
+
   bool isEligible(const Instruction *i) const;
 
   KillFlow *killflow;
@@ -48,11 +52,15 @@ protected:
   virtual void uponStackChange() {
     iiCache.clear();
     iiCacheR.clear();
+    iiConsulted.clear();
   }
 
+  virtual void uponStackChange(unsigned changed);
+
 public:
   static char ID;
-  CallsiteDepthCombinator() : ModulePass(ID), iiCache(), iiCacheR() {}
+  CallsiteDepthCombinator()
+      : ModulePass(ID), iiCache(), iiCacheR(), iiConsulted() {}
 
   virtual bool runOnModule(Module &M);
 
@@ -116,7 +124,10 @@ public:
                                     SemiLocalFunAA *semi = nullptr);
 
   /// Like the previous, but accepts pre-computed
-  /// inst-search objects over src,dst.
+  /// inst-search objects over src,dst.  Deferred
+  /// callsites reported by lazy searches are tested
+  /// as a whole first, and expanded (cheapest first)
+  /// only if that cannot disprove the flow.
   static bool doFlowSearchCrossIter(const Instruction *src,
                                     const Instruction *dst, const Loop *L,
                                     InstSearch &writes, InstSearch &reads,
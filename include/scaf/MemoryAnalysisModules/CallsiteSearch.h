@@ -10,6 +10,10 @@
  * of Callsite-Depth-Combinator-AA.
  * Look there for an example of usage.
  *
+ * Each function is walked at most once per kind
+ * of search; the searches compose the resulting
+ * CalleeSummary objects, which KillFlow memoizes.
+ *
  * Note about memory management:
  *  The instruction search classes produce
  *  CtxInst objects, which contain an instruction
@@ -32,6 +36,7 @@
 #include "Assumptions.h"
 
 #include <map>
+#include <memory>
 #include <set>
 
 namespace llvm {
@@ -110,6 +115,14 @@ struct Context {
              bool Before, bool PointerIsLocalToContext = false,
              time_t queryStart = 0, unsigned Timeout = 0) const;
 
+  /// Same as kills(kill, ptr, locInCtx, Before, true), except that
+  /// it assumes (ptr) is not killed within the innermost callee of
+  /// this context, and so starts at the callsite of that callee.
+  /// For operations of a CalleeSummary, which were already tested
+  /// within their function.
+  bool killsOutsideCallee(KillFlow &kill, const Value *ptr, bool Before,
+                          time_t queryStart = 0, unsigned Timeout = 0) const;
+
   /// Compute the set of aggregate objects (objects) from which
   /// the pointer (ptr) may be defined, and which are not killed
   /// (Before) or (!Before) the location (locInCtx) within this
@@ -134,6 +147,11 @@ private:
              bool Before, bool PointerIsLocalToContext, time_t queryStart = 0,
              unsigned Timeout = 0) const;
 
+  bool killsOutside(KillFlow &kill, const Value *ptr, const Value *obj,
+                    const CallsiteContext *ctx, bool Before,
+                    bool PointerIsLocalToContext, time_t queryStart,
+                    unsigned Timeout) const;
+
   void getUnderlyingObjects(KillFlow &kill, const Value *ptr,
                             const Instruction *locInCtx, CallsiteContext *ctx,
                             UO &objects, bool Before) const;
@@ -202,6 +220,42 @@ typedef std::pair<CtxInst, CtxInst> CCPair;
 typedef std::vector<CCPair> CCPairs;
 typedef std::map<CCPair, Remedies> CCPairsRemedsMap;
 
+/// A context-free summary of the operations within one function
+/// which a search may report, in the order in which the search
+/// visits them.  It does not look into callees: callsites of defined
+/// functions are listed as NestedCall, and the search composes them
+/// with their own summaries.  Memory operations which are killed
+/// within the function cannot be live-in/live-out of any callsite of
+/// it, and are omitted.
+struct CalleeSummary {
+  enum Kind {
+    MemOp,         // a non-callsite which may read/write memory
+    OpaqueCall,    // an indirect call, or a call to an external function
+    SemiLocalCall, // an external call with hidden state (SemiLocalFunAA)
+    LocalCall,     // a call whose footprint is its arguments (PureFunAA)
+    NestedCall     // a call to a defined function
+  };
+
+  struct Op {
+    const Instruction *inst;
+    Kind kind;
+  };
+
+  CalleeSummary() : numKilledLocally(0) {}
+
+  std::vector<Op> ops;
+  unsigned numKilledLocally;
+};
+
+/// Callee summaries, per function and kind of search.  Owned by
+/// KillFlow, since the kill verdicts they record depend on the
+/// analyses below it.
+struct CalleeSummaries {
+  // (function, search flags)
+  typedef std::pair<const Function *, unsigned> Key;
+  std::map<Key, CalleeSummary> summaries;
+};
+
 /// Iterator abstraction over the search
 struct InstSearch;
 struct InstSearchIterator {
@@ -230,7 +284,7 @@ private:
 /// Represents the state of a depth-first
 /// search over instructions.
 struct InstSearch {
-  typedef CIList Fringe;
+  typedef std::vector<std::pair<CalleeSummary::Op, Context>> Fringe;
   typedef std::set<const Instruction *> Visited;
   typedef InstSearchIterator iterator;
 
@@ -250,25 +304,58 @@ struct InstSearch {
   const CtxInst &getHit(unsigned n) const;
   unsigned getNumHits() const;
 
+  /// A lazy search reports callsites to defined functions
+  /// nested within the starting instruction as hits, without
+  /// searching their callees.  Must be set before the first hit
+  /// is requested.
+  void setLazy(bool l) { lazy = l; }
+  bool isLazy() const { return lazy; }
+
+  /// Is this hit a callsite whose callee was not searched?
+  bool isDeferred(const CtxInst &hit) const;
+
+  /// Search the callee of a deferred hit.  The new search is
+  /// lazy and shares this search's visited callsites.
+  virtual std::unique_ptr<InstSearch> expand(const CtxInst &deferred) const = 0;
+
 protected:
-  /// Contains yet-to-be-explored instructions
+  /// Start a sub-search which inherits the configuration
+  /// and visited callsites of parent.
+  InstSearch(const InstSearch *parent);
+
+  /// Contains yet-to-be-explored operations of callee
+  /// summaries, each in the context which reached it.
   Fringe fringe;
 
   /// Contains callsite instructions which have already
-  /// been visited; avoids infinite recursion.
-  Visited visited;
+  /// been visited; avoids infinite recursion.  Shared
+  /// with sub-searches.
+  std::shared_ptr<Visited> visited;
 
   /// Contains all of the instructions of interest we
   /// have yet found.
-  Fringe hits;
+  CIList hits;
 
   time_t queryStart;
   unsigned Timeout;
   PureFunAA *pure;
   SemiLocalFunAA *semi;
+  bool lazy;
 
   bool mayReadWrite(const Instruction *inst) const;
 
+  /// Determine how this search treats (inst).  Returns false
+  /// if it neither reads nor writes as this search requires.
+  bool classify(const Instruction *inst, CalleeSummary::Kind &kind) const;
+
+  /// The summary of (fcn) for this kind of search, computed
+  /// by summarize() on first use and memoized in KillFlow.
+  const CalleeSummary &getSummary(KillFlow &kill, const Function *fcn,
+                                  bool forward) const;
+
+  virtual void summarize(const Function *fcn,
+                         CalleeSummary &summary) const = 0;
+
 private:
   /// We are searching for reads and/or writes.
   const bool Reads, Writes;
@@ -283,15 +370,18 @@ struct ForwardSearch : public InstSearch {
                 time_t queryStart = 0, unsigned Timeout = 0,
                 PureFunAA *pure = nullptr, SemiLocalFunAA *semi = nullptr);
   virtual void tryGetMoreHits();
+  virtual std::unique_ptr<InstSearch> expand(const CtxInst &deferred) const;
 
 private:
+  ForwardSearch(const ForwardSearch *parent, const CtxInst &call);
+
   KillFlow &kill;
 
-  bool goal(const CtxInst &n);
   bool isGoalState(const CtxInst &n);
+  bool visit(const CalleeSummary::Op &op, const Context &ctx);
+  void enterCallee(const CtxInst &call);
   void searchSuccessors();
-  void expandSuccessors(const CtxInst &ci);
-  void expandSuccessors(DomTreeNode *nn, const Context &ctx);
+  virtual void summarize(const Function *fcn, CalleeSummary &summary) const;
 };
 
 struct ForwardLoadSearch : public ForwardSearch {
@@ -314,16 +404,18 @@ struct ReverseSearch : public InstSearch {
                 time_t queryStart = 0, unsigned Timeout = 0,
                 PureFunAA *pure = nullptr, SemiLocalFunAA *semi = nullptr);
   virtual void tryGetMoreHits();
+  virtual std::unique_ptr<InstSearch> expand(const CtxInst &deferred) const;
 
 private:
+  ReverseSearch(const ReverseSearch *parent, const CtxInst &call);
+
   KillFlow &kill;
 
-  bool goal(const CtxInst &n);
   bool isGoalState(const CtxInst &n);
+  bool visit(const CalleeSummary::Op &op, const Context &ctx);
+  void enterCallee(const CtxInst &call);
   void searchPredecessors();
-  void expandPredecessors(const CtxInst &ci);
-  void expandPredecessors(DomTreeNode *nn, const Context &ctx);
-  void expandRoots(const PostDominatorTree *pdt, const Context &ctx);
+  virtual void summarize(const Function *fcn, CalleeSummary &summary) const;
 };
 
 struct ReverseLoadSearch : public ReverseSearch {
@@ -11,9 +11,16 @@
 #include "scaf/MemoryAnalysisModules/FindSource.h"
 #include "scaf/MemoryAnalysisModules/LoopAA.h"
 #include "scaf/Utilities/ModuleLoops.h"
+#include "scaf/Utilities/UnderlyingObjectsCache.h"
+
+#include <memory>
 
 namespace liberty {
 using namespace arcana::noelle;
+
+// See CallsiteSearch.h
+struct CalleeSummaries;
+
 class KillFlow : public ModulePass, public LoopAA {
   typedef std::pair<const Function *, const Value *> FcnPtrPair;
   typedef DenseMap<FcnPtrPair, bool> FcnKills;
@@ -36,8 +43,15 @@ class KillFlow : public ModulePass, public LoopAA {
   DenseMap<const BasicBlock *, SmallPtrSet<const Instruction *, 1>>
       loopKillAlongInsts;
 
+  // Summaries of callees for CallsiteSearch.
+  std::unique_ptr<CalleeSummaries> calleeSummaries;
+
+  // Lowest stack position consulted by any entry of the caches above.
+  unsigned cachesConsulted;
+
   // Hold reference to this.
   ModuleLoops *mloops;
+  UnderlyingObjectsCache *uoc;
   const TargetLibraryInfo *tli;
   // Pass *proxy;
 
@@ -80,6 +94,7 @@ class KillFlow : public ModulePass, public LoopAA {
 
 protected:
   virtual void uponStackChange();
+  virtual void uponStackChange(unsigned changed);
 
 public:
   static char ID;
@@ -90,6 +105,7 @@ public:
     DL = &M.getDataLayout();
     InitializeLoopAA(this, *DL);
     setModuleLoops(&getAnalysis<ModuleLoops>());
+    setUnderlyingObjectsCache(&getAnalysis<UnderlyingObjectsCache>());
     tli = &getAnalysis<TargetLibraryInfoWrapperPass>().getTLI();
     // setProxy(this);
     return false;
@@ -97,6 +113,8 @@ public:
 
   void setModuleLoops(ModuleLoops *ml) { mloops = ml; }
 
+  void setUnderlyingObjectsCache(UnderlyingObjectsCache *c) { uoc = c; }
+
   /*
   void setProxy(Pass* p)
   {
@@ -106,6 +124,17 @@ public:
 
   void setDL(const DataLayout *d) { DL = d; }
 
+  /// Callee summaries of ForwardSearch and ReverseSearch.  These
+  /// record kill verdicts, and so are cleared when the stack changes.
+  CalleeSummaries &getCalleeSummaries();
+
+  /// Account for an answer read from, or written to, the caches
+  /// of this KillFlow (including the callee summaries).
+  void noteCacheHit() const { noteConsulted(cachesConsulted); }
+  void noteCacheFilled() {
+    cachesConsulted = std::min(cachesConsulted, getLowestConsulted());
+  }
+
   virtual SchedulingPreference getSchedulingPreference() const {
     return SchedulingPreference(Normal - 7);
   }
@@ -115,6 +144,7 @@ public:
   void getAnalysisUsage(AnalysisUsage &AU) const {
     LoopAA::getAnalysisUsage(AU);
     AU.addRequired<ModuleLoops>();
+    AU.addRequired<UnderlyingObjectsCache>();
     AU.addRequired<TargetLibraryInfoWrapperPass>();
     AU.setPreservesAll();
   }
@@ -136,6 +166,19 @@ public:
       return getNextAA();
   }
 
+  /// As above, counted toward the current scope, for the
+  /// queries made directly rather than through modref().
+  LoopAA *consultEffectiveTopAA() const {
+    LoopAA *top = getEffectiveTopAA();
+    noteConsulted(top);
+    return top;
+  }
+  LoopAA *consultEffectiveNextAA() const {
+    LoopAA *next = getEffectiveNextAA();
+    noteConsulted(next);
+    return next;
+  }
+
   /// getAdjustedAnalysisPointer - This method is used when a pass implements
   /// an analysis interface through multiple inheritance.  If needed, it
   /// should override this to adjust the this pointer as needed for the
@@ -103,6 +103,9 @@
 
 #include "Assumptions.h"
 
+#include <algorithm>
+#include <tuple>
+
 namespace liberty {
 using namespace llvm;
 using namespace arcana::noelle;
@@ -163,6 +166,24 @@ public:
   /// implementation.  Most should leave this unchanged.
   virtual SchedulingPreference getSchedulingPreference() const;
 
+  /// How cheap a set of remedies is, in the order used by
+  /// isCheaper(): remedies without points-to first, then
+  /// those without expensive remedies, then by total cost.
+  typedef std::tuple<bool, bool, unsigned long> RemedyRank;
+
+  static RemedyRank getRemedyRank(const Remedies &R);
+
+  /// A lower bound on the rank of the remedies of any answer this
+  /// implementation gives.  It must be cheap to report; it is used
+  /// to order implementations of equal scheduling preference and to
+  /// stop a query once nothing below can offer a cheaper answer.
+  /// The default (no remedies) never stops a query.
+  virtual RemedyRank getMinRemedyRank() const;
+
+  /// Could neither this implementation nor any below it in the
+  /// stack answer with remedies cheaper than R?
+  bool isCheapestPossible(const Remedies &R) const;
+
   /// Three methods:
   ///
   ///   pointer-vs-pointer   (alias)
@@ -305,6 +326,15 @@ public:
   virtual LoopAA *getTopAA() const;
   LoopAA *getRealTopAA() const;
 
+  /// The top, counted toward the current scope as a module about
+  /// to be queried directly.  Use it for the queries whose answers
+  /// are cached; the accessors above leave the scope alone.
+  LoopAA *consultTopAA() const {
+    LoopAA *top = getTopAA();
+    noteConsulted(top);
+    return top;
+  }
+
   /// Get a handle to the DataLayout object.
   const DataLayout *getDataLayout() const;
 
@@ -322,6 +352,63 @@ public:
   /// by adding/subtracting other LoopAAs.
   void stackHasChanged();
 
+  /// Tell the LoopAA stack that implementations at this position
+  /// (scheduling preference) were added, removed, or started or
+  /// stopped answering.  Cached answers whose queries did not
+  /// reach that far down may be kept.
+  void stackHasChanged(unsigned changed);
+
+  /// Tell the LoopAA stack that a client is done with loop L.
+  /// Answers about L found by speculation may be dropped.
+  void loopHasFinished(const Loop *L);
+
+  /// The scheduling preference this implementation
+  /// was inserted with.
+  unsigned getStackPosition() const { return position; }
+
+  /// Cache entries record how far down the stack the queries that
+  /// computed them went, as the lowest position consulted.  A change
+  /// at a position above that cannot affect them.
+  static const unsigned NothingConsulted = ~0U;
+
+  static bool isAffected(unsigned lowestConsulted, unsigned changed) {
+    return lowestConsulted <= changed;
+  }
+
+  /// Measures the lowest position consulted by the queries made
+  /// during its lifetime, which also count toward enclosing scopes.
+  class ConsultedScope {
+  public:
+    ConsultedScope() : saved(lowestConsulted) {
+      lowestConsulted = NothingConsulted;
+    }
+    ~ConsultedScope() {
+      lowestConsulted = std::min(saved, lowestConsulted);
+    }
+
+    unsigned getLowest() const { return lowestConsulted; }
+
+  private:
+    unsigned saved;
+  };
+
+  /// Count a cached entry toward the current scope, or a module
+  /// about to be queried directly.  The base alias() and modref()
+  /// count the module they forward to; a module which queries
+  /// another directly counts it itself.
+  static void noteConsulted(unsigned lowest) {
+    lowestConsulted = std::min(lowestConsulted, lowest);
+  }
+  static void noteConsulted(const LoopAA *aa) {
+    if (aa)
+      noteConsulted(aa->position);
+  }
+
+  /// The lowest position consulted so far in the innermost scope.
+  /// Everything an entry is computed from was consulted in the
+  /// scope it is written in, so this is a safe bound for it.
+  static unsigned getLowestConsulted() { return lowestConsulted; }
+
   // utilities for processing remedies
   static bool containsExpensiveRemeds(const Remedies &R);
   static bool containsPointsToRemeds(const Remedies &R);
@@ -369,12 +456,24 @@ public:
 protected:
   /// Called indirectly by stackHasChanged().
   virtual void uponStackChange();
+
+  /// Called indirectly by stackHasChanged(changed).  Implementations
+  /// which record the lowest position consulted by their entries may
+  /// only drop the affected ones; the default drops everything.
+  virtual void uponStackChange(unsigned changed);
+
+  /// Called indirectly by loopHasFinished().
+  virtual void uponLoopFinished(const Loop *L);
+
   unsigned getDepth();
 
 private:
   const DataLayout *td;
   const TargetLibraryInfo *tli;
   LoopAA *nextAA, *prevAA;
+  unsigned position;
+
+  static unsigned lowestConsulted;
 };
 
 /// IO easiness
@@ -466,6 +565,8 @@ public:
 
   virtual SchedulingPreference getSchedulingPreference() const;
 
+  virtual RemedyRank getMinRemedyRank() const;
+
   virtual StringRef getLoopAAName() const { return "NoLoopAA"; }
 
   virtual AliasResult alias(const Value *ptrA, unsigned sizeA,
@@ -1,7 +1,9 @@
 #ifndef PURE_FUN_AA_H
 #define PURE_FUN_AA_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/Analysis/CallGraph.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Pass.h"
@@ -34,6 +36,17 @@ public:
   typedef SCC::const_iterator SCCIt;
   typedef std::set<StringRef, ltstr> StringSet;
 
+  /// The known value of a property for an SCC: 1 (true),
+  /// 0 (false), or -1 if it must be derived from the code.
+  typedef llvm::function_ref<int(SCCNum)> SCCLookup;
+
+  /// Decide a property for one SCC, given the values
+  /// already decided for the SCCs below it.
+  typedef llvm::function_ref<bool(SCCNum, SCCLookup)> SCCSummarizer;
+
+  /// One value per SCC, indexed by SCCNum.
+  typedef std::vector<unsigned char> SCCResults;
+
 private:
   typedef llvm::DenseMap<const llvm::Function *, SCCNum> FunToSCCMap;
   typedef FunToSCCMap::const_iterator FunToSCCMapIt;
@@ -43,6 +56,16 @@ private:
   SCCNum sccCount;
   FunToSCCMap sccMap;
 
+  /// The functions of each SCC, indexed by SCCNum
+  std::vector<std::vector<const llvm::Function *>> sccFunctions;
+
+  /// SCCs grouped for bottom-up summarization.  schedule[i] holds
+  /// the tasks of level i; a task is a list of SCCs, in increasing
+  /// order, which may call one another through direct calls.  The
+  /// tasks of one level only call into earlier levels.
+  typedef std::vector<SCCNum> SCCTask;
+  std::vector<std::vector<SCCTask>> schedule;
+
   SCCNumSet readOnlySet;
   SCCNumSet writeSet;
 
@@ -59,7 +82,7 @@ private:
   static StringSet localFunSet;
   static StringSet noMemFunSet;
 
-  void runOnSCC(const SCC &scc);
+  void buildSchedule();
 
 public:
   static bool isBadDeref(const Instruction *inst);
@@ -93,6 +116,22 @@ public:
                            const StringSet &knownFunSet,
                            Property property) const;
 
+  /// As above, with the SCC values given by a lookup.
+  bool isRecursiveProperty(const llvm::Function *fun, SCCLookup lookup,
+                           const StringSet &knownFunSet,
+                           Property property) const;
+
+  llvm::ArrayRef<const llvm::Function *> getSCCFunctions(SCCNum scc) const {
+    return sccFunctions[scc];
+  }
+
+  /// Evaluate a property of every SCC of the call graph, bottom-up.
+  /// SCCs in different tasks of the same level are evaluated
+  /// concurrently.  While SCC s is evaluated, the lookup reports the
+  /// values of SCCs numbered below s, so the results are the same
+  /// as those of a sequential walk in scc_iterator order.
+  void summarizeSCCs(SCCSummarizer summarize, SCCResults &results) const;
+
   virtual ModRefResult getModRefInfo(llvm::CallSite CS1, TemporalRelation Rel,
                                      llvm::CallSite CS2, const llvm::Loop *L,
                                      Remedies &R);
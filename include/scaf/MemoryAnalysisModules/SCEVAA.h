@@ -0,0 +1,134 @@
+#ifndef LLVM_LIBERTY_SCEV_AA_H
+#define LLVM_LIBERTY_SCEV_AA_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Pass.h"
+
+#include "scaf/MemoryAnalysisModules/ClassicLoopAA.h"
+
+#include <unordered_map>
+
+namespace liberty {
+using namespace llvm;
+using namespace arcana::noelle;
+
+/// An affine description of a pointer within a loop nest:
+///
+///   ptr = base + sum_k strides[k] * i_k
+///
+/// where i_k counts the iterations of loops[k].  loops[0] is
+/// the loop it was computed for, and the rest are the subloops
+/// which contain the pointer, outermost first.
+struct AccessDescriptor {
+  AccessDescriptor() : scoped(nullptr), valid(false), base(nullptr) {}
+
+  /// getSCEVAtScope() of the pointer in loops[0]
+  const SCEV *scoped;
+
+  /// False if the pointer is not affine in the nest,
+  /// or if some stride is not a (small) constant.
+  bool valid;
+
+  /// Invariant in loops[0]
+  const SCEV *base;
+
+  SmallVector<const Loop *, 2> loops;
+  SmallVector<int64_t, 2> strides;
+
+  /// The last value of each iteration counter, i.e. the
+  /// backedge-taken count of the loop, or -1 if unknown.
+  SmallVector<int64_t, 2> maxIterations;
+};
+
+/// The result of a dependence test between two pointers in a loop nest.
+struct SCEVDependence {
+  enum Direction { LT = 1, EQ = 2, GT = 4, ALL = LT | EQ | GT };
+
+  /// Distance and direction within one loop common to both pointers.
+  /// The distance is the iteration of the second pointer minus that of
+  /// the first; LT means the first is accessed in an earlier iteration.
+  struct Level {
+    const Loop *loop;
+    unsigned direction;
+    bool hasMinDistance, hasMaxDistance;
+    int64_t minDistance, maxDistance;
+  };
+
+  SCEVDependence() : independent(false) {}
+
+  /// The pointers never overlap.
+  bool independent;
+
+  /// One per common loop, outermost first; empty if the
+  /// pointers could not be analyzed.
+  SmallVector<Level, 2> levels;
+
+  /// Is the distance in the outermost loop at least K iterations?
+  bool distanceAtLeast(int64_t K) const {
+    return independent ||
+           (!levels.empty() && levels[0].hasMinDistance &&
+            levels[0].minDistance >= K);
+  }
+};
+
+/// This analysis compares SCEV expressions to analysis
+/// induction variables.  It is meant to very quickly
+/// handle a common case instead of using ModuleSMTAA
+/// to handle a more general case slowly.
+class SCEVAA : public ModulePass, public liberty::ClassicLoopAA {
+public:
+  static char ID;
+  SCEVAA() : ModulePass(ID) {}
+
+  bool runOnModule(Module &M);
+
+  virtual AliasResult aliasCheck(const Pointer &P1, TemporalRelation Rel,
+                                 const Pointer &P2, const Loop *L, Remedies &R,
+                                 DesiredAliasResult dAliasRes = DNoOrMustAlias);
+
+  /// Test for a dependence between the footprints of P1 and P2 in
+  /// loop L with the ZIV, GCD, SIV and Banerjee tests.  With
+  /// Rel == Before, P1 is accessed in an earlier iteration of L
+  /// than P2; with After, in a later one.
+  SCEVDependence getDependence(const Pointer &P1, TemporalRelation Rel,
+                               const Pointer &P2, const Loop *L);
+
+  /// The access descriptor of ptr in loop L, cached per loop.
+  const AccessDescriptor &getAccessDescriptor(const Value *ptr,
+                                              const Loop *L);
+
+  StringRef getLoopAAName() const { return "scev-loopaa"; }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const;
+
+  /// getAdjustedAnalysisPointer - This method is used when a pass implements
+  /// an analysis interface through multiple inheritance.  If needed, it
+  /// should override this to adjust the this pointer as needed for the
+  /// specified pass info.
+  virtual void *getAdjustedAnalysisPointer(AnalysisID PI) {
+    if (PI == &LoopAA::ID)
+      return (LoopAA *)this;
+    return this;
+  }
+
+private:
+  struct LoopAccesses {
+    LoopAccesses() : SE(nullptr) {}
+
+    // The descriptors are only valid for this instance.
+    ScalarEvolution *SE;
+    std::unordered_map<const Value *, AccessDescriptor> accesses;
+  };
+
+  DenseMap<const Loop *, LoopAccesses> loopAccesses;
+
+  void computeAccessDescriptor(ScalarEvolution *SE, const Value *ptr,
+                               const Loop *L, AccessDescriptor &A);
+};
+
+} // namespace liberty
+
+#endif
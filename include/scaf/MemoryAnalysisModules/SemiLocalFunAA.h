@@ -58,8 +58,6 @@ class SemiLocalFunAA : public ModulePass, public liberty::ClassicLoopAA {
 
   static bool isSemiLocalProp(const Instruction *inst);
 
-  void runOnSCC(const PureFunAA::SCC &scc, PureFunAA &pureFun);
-
   static void initGlobalMod(const Value *v, GlobalSet &mods, GlobalSet &refs,
                             FuncSet &funcs);
   static void initGlobalMod(const Function *fun, GlobalSet &mods,
@@ -1,6 +1,8 @@
 #ifndef LLVM_LIBERTY_TYPEAAPASS
 #define LLVM_LIBERTY_TYPEAAPASS
 
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Module.h"
@@ -29,6 +31,25 @@ private:
   bool runOnFunction(Function &);
   void runOnGlobalVariable(GlobalVariable &gv);
 
+  /// The types which may occupy space within an allocation
+  /// unit of some container type: either every type, or
+  /// the set bits, indexed by getTypeId().
+  struct Containment {
+    Containment() : all(false) {}
+
+    bool all;
+    BitVector contained;
+  };
+
+  // Dense IDs for the types reached while computing containment.
+  // Both are filled in runOnModule(), and lazily for container
+  // types which do not appear in the module.
+  mutable DenseMap<Type *, unsigned> typeIds;
+  mutable DenseMap<Type *, Containment> containment;
+
+  unsigned getTypeId(Type *t) const;
+  const Containment &getContainment(Type *container) const;
+
 public:
   static char ID;
   TypeSanityAnalysis() : ModulePass(ID) {}
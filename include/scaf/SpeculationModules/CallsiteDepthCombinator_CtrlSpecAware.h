@@ -35,21 +35,30 @@ namespace liberty
   {
     typedef DenseMap< IIKey, bool > IICache;
     typedef DenseMap< IIKey, Remedies > IICacheR;
+    typedef DenseMap< IIKey, unsigned > IIConsulted;
 
     IICache iiCache;
     IICacheR iiCacheR;
 
+    // Lowest stack position consulted by each entry.
+    IIConsulted iiConsulted;
+
     bool isEligible(const Instruction *i) const;
 
     KillFlow_CtrlSpecAware *killflow;
 
   protected:
-    virtual void uponStackChange() { iiCache.clear(); iiCacheR.clear();}
+    virtual void uponStackChange() { iiCache.clear(); iiCacheR.clear(); iiConsulted.clear();}
+    virtual void uponStackChange(unsigned changed);
+
+    /// These answers depend on the control speculation for L,
+    /// which changes once its client is done with it.
+    virtual void uponLoopFinished(const Loop *L);
 
   public:
     static char ID;
     CallsiteDepthCombinator_CtrlSpecAware()
-        : ModulePass(ID), iiCache(), iiCacheR() {}
+        : ModulePass(ID), iiCache(), iiCacheR(), iiConsulted() {}
 
     virtual bool runOnModule(Module &M);
 
@@ -79,6 +79,11 @@ struct HeapAssignment : public UpdateOnClone
   const AUSet &getReadOnlyAUs() const;
   const AUToRemeds &getCheapPrivAUs() const;
   const AUToRemeds &getNoWAWRemeds() const;
+
+  /// Changes whenever the cheap private AUs may have changed
+  /// (through getCheapPrivAUs() or renaming), so that clients
+  /// may cache what they derive from them.
+  unsigned getCheapPrivVersion() const { return cheapPrivVersion; }
   const ReduxAUSet &getReductionAUs() const;
   const ReduxDepAUSet &getReduxDepAUs() const;
   const ReduxRegAUSet &getReduxRegAUs() const;
@@ -142,6 +147,8 @@ private:
   /// indexed by loop within this function.
   AUSet shareds, locals, kill_privs, share_privs, privs, ros;
   AUToRemeds cheap_privs, no_waw_remeds;
+  unsigned cheapPrivVersion = 0;
+  static unsigned nextCheapPrivVersion;
   ReduxAUSet reduxs;
   ReduxDepAUSet reduxdeps;
   ReduxRegAUSet reduxregs; // collects all the register reductions
@@ -180,6 +187,11 @@ struct Classify : public ModulePass, public UpdateOnClone
   bool isAssigned(const Loop *) const;
   const HeapAssignment &getAssignmentFor(const Loop *) const;
 
+  /// Was this loop classified, rather than skipped on the
+  /// -target-time-budget or before its assignment was built?
+  /// Clients must check this before getAssignmentFor().
+  bool isClassified(const Loop *) const;
+
   typedef std::map<const BasicBlock *, HeapAssignment> Loop2Assignments;
   typedef Loop2Assignments::const_iterator iterator;
 
@@ -196,12 +208,17 @@ struct Classify : public ModulePass, public UpdateOnClone
 private:
   Loop2Assignments assignments;
 
+  // Headers of the loops classified by runOnModule().
+  std::set<const BasicBlock *> classified;
+
   bool runOnLoop(Loop *loop);
 
   // Look-up all AUs which carry dependences ACROSS loop.
   // Return false only if the set of AUs cannot be determined
   // (it may successfully return an empty set).
-  bool getLoopCarriedAUs(Loop *loop, const Ctx *ctx, AUs &aus,
+  // Only pairs of operations whose profiled footprints share
+  // an object are searched for flows.
+  bool getLoopCarriedAUs(Loop *loop, const Ctx *ctx, HeapAssignment::AUSet &aus,
                          HeapAssignment::AUToRemeds &auToRemeds) const;
 
   // Look-up the AUs which carry flow dependences from src to dst ACROSS loop.
@@ -35,6 +35,8 @@ struct CommutativeLibsAA : public LoopAA, Remediator // Not a pass!
     return SchedulingPreference(Low - 10);
   }
 
+  RemedyRank getMinRemedyRank() const;
+
   RemedResp memdep(const Instruction *A, const Instruction *B, bool loopCarried, DataDepType dataDepTy, const Loop *L) override;
 
 private:
@@ -0,0 +1,173 @@
+#pragma once
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "noelle/core/PDG.hpp"
+
+#include "Assumptions.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace liberty {
+using namespace llvm;
+using namespace arcana::noelle;
+
+/// A remedy restored from a serialized PDG.  It carries the
+/// name and cost of the original remedy, but not its payload.
+/// Its ordinal is its position in the remedies of its edge, which
+/// tells apart remedies of the same name and cost.
+class SerializedRemedy : public Remedy {
+public:
+  SerializedRemedy(StringRef n, unsigned long c, unsigned o)
+      : name(n), ordinal(o) {
+    cost = c;
+  }
+
+  bool compare(const Remedy_ptr rhs) const override;
+  StringRef getRemedyName() const override { return name; }
+
+private:
+  std::string name;
+  unsigned ordinal;
+};
+
+/// A dense representation of the dependences among the instructions
+/// of one loop, used by PDGBuilder while it constructs and annotates
+/// the PDG.
+///
+/// Every instruction of the loop gets a dense index (in block order,
+/// the same order in which the noelle PDG creates its internal nodes).
+/// For each edge kind (mem/reg/ctrl x RAW/WAR/WAW x intra/loop-carried)
+/// only the sources with edges of that kind get a row: the sorted
+/// indices of their destinations.  Remedies are kept in a side table,
+/// only for the edges that have them.  Edges to and from values outside
+/// the loop are implied by the IR and are only materialized by toPDG().
+class CompactPDG {
+public:
+  enum DepType { MemDep = 0, RegDep = 1, CtrlDep = 2 };
+  enum DataType { DataRAW = 0, DataWAR = 1, DataWAW = 2 };
+
+  static const unsigned NumKinds = 3 * 3 * 2;
+
+  /// Encode an edge kind.  Register and control dependences
+  /// only use the DataRAW slot.
+  static unsigned getKind(DepType dep, DataType data, bool loopCarried) {
+    return (dep * 3 + data) * 2 + (loopCarried ? 1 : 0);
+  }
+  static DepType getDepType(unsigned kind) { return DepType(kind / 6); }
+  static DataType getDataType(unsigned kind) {
+    return DataType((kind / 2) % 3);
+  }
+  static bool isLoopCarried(unsigned kind) { return kind & 1; }
+
+  CompactPDG(Loop *loop);
+
+  Loop *getLoop() const { return loop; }
+
+  unsigned getNumInstructions() const { return insts.size(); }
+  Instruction *getInstruction(unsigned idx) const { return insts[idx]; }
+
+  bool hasIndex(const Value *v) const { return index.count(v); }
+  unsigned getIndex(const Value *v) const {
+    auto i = index.find(v);
+    assert(i != index.end() && "Instruction not in this loop");
+    return i->second;
+  }
+
+  void addEdge(unsigned kind, unsigned src, unsigned dst);
+  void removeEdge(unsigned kind, unsigned src, unsigned dst);
+  bool hasEdge(unsigned kind, unsigned src, unsigned dst) const;
+
+  /// Number of edges of this kind
+  unsigned getNumEdges(unsigned kind) const;
+
+  /// Iterate the destinations of edges of this kind leaving src.
+  /// Returns -1 when there are no more.
+  int firstSuccessor(unsigned kind, unsigned src) const;
+  int nextSuccessor(unsigned kind, unsigned src, unsigned prev) const;
+
+  /// Record remedies which render this edge removable.
+  void setRemedies(unsigned kind, unsigned src, unsigned dst, Remedies_ptr R);
+
+  /// Null unless the edge is removable.
+  Remedies_ptr getRemedies(unsigned kind, unsigned src, unsigned dst) const;
+  bool isRemovable(unsigned kind, unsigned src, unsigned dst) const {
+    return getRemedies(kind, src, dst) != nullptr;
+  }
+
+  /// Record that the memory analysis modules answered no more than
+  /// the operations themselves imply, in both directions, for the
+  /// memory dependences from src to dst.  Not serialized.
+  void setConservative(bool loopCarried, unsigned src, unsigned dst);
+  bool isConservative(bool loopCarried, unsigned src, unsigned dst) const;
+
+  /// Total cost of a set of remedies
+  static unsigned long getCost(const Remedies &R);
+
+  /// Build the equivalent noelle PDG, including the register
+  /// dependences to and from values outside of the loop.  Removable
+  /// edges whose remedies cost less than budget are left out, as
+  /// CompactSCCDAG::compute() ignores them.
+  std::unique_ptr<PDG> toPDG(unsigned long budget = 0) const;
+
+  /// Write this PDG as JSON lines: one record naming the loop
+  /// (by the Namer ID of its header), then one record per edge
+  /// (by the Namer IDs of its endpoints) with its kind and the
+  /// names and costs of its remedies.  Returns false, writing
+  /// nothing, if some instruction of the loop is not named.
+  bool serialize(raw_ostream &os) const;
+
+  /// Loop ID of a loop record written by serialize(), or -1
+  /// if the record describes an edge.
+  static int getSerializedLoopId(const json::Object &record);
+
+  /// Check that a loop record written by serialize() describes
+  /// this loop of this module.
+  bool matchesSerializedLoop(const json::Object &record) const;
+
+  /// Add one edge record written by serialize().  Returns
+  /// false if the record is malformed or names instructions
+  /// which are not in this loop.
+  bool deserializeEdge(const json::Object &record);
+
+private:
+  Loop *loop;
+  std::vector<Instruction *> insts;
+  DenseMap<const Value *, unsigned> index;
+
+  /// Per kind, the sorted destinations of each source with an edge
+  /// of that kind.  Rows are never left empty.
+  typedef DenseMap<unsigned, std::vector<unsigned>> Rows;
+  Rows rows[NumKinds];
+  unsigned numEdges[NumKinds] = {};
+
+  DenseMap<uint64_t, Remedies_ptr> remedies;
+
+  /// Marked (loopCarried, src, dst), keyed by conservativeKey()
+  DenseSet<uint64_t> conservative;
+
+  /// Namer ID -> dense index, built on first deserializeEdge()
+  DenseMap<int, unsigned> namerIds;
+
+  uint64_t cell(unsigned src, unsigned dst) const {
+    return (uint64_t)src * insts.size() + dst;
+  }
+  uint64_t remedyKey(unsigned kind, unsigned src, unsigned dst) const {
+    return cell(src, dst) * NumKinds + kind;
+  }
+  uint64_t conservativeKey(bool loopCarried, unsigned src,
+                           unsigned dst) const {
+    return cell(src, dst) * 2 + (loopCarried ? 1 : 0);
+  }
+
+  void addExternalEdges(PDG &pdg) const;
+};
+
+} // namespace liberty
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "llvm/ADT/ArrayRef.h"
+
+#include "scaf/SpeculationModules/CompactPDG.hpp"
+
+#include <vector>
+
+namespace liberty {
+using namespace llvm;
+
+/// The strongly connected components of the dependences of a
+/// CompactPDG, computed without building a noelle PDG.
+///
+/// The edges of the selected kinds are gathered once into an
+/// adjacency array, each with the total cost of its remedies.
+/// compute() then finds the SCCs for a speculation budget: removable
+/// edges whose remedies cost less than the budget are ignored.  It
+/// may be called again with another budget on the same adjacency.
+class CompactSCCDAG {
+public:
+  static const unsigned AllKinds = (1u << CompactPDG::NumKinds) - 1;
+
+  /// The kinds (intra-iteration and loop-carried) of one dependence type
+  static unsigned getKindMask(CompactPDG::DepType dep);
+
+  /// Gather the edges of pdg whose kinds are in the mask.
+  CompactSCCDAG(const CompactPDG &pdg, unsigned kinds = AllKinds);
+
+  /// Find the SCCs, ignoring removable edges which cost less than
+  /// budget.  A budget of 0 keeps every edge.
+  void compute(unsigned long budget = 0);
+
+  unsigned getNumInstructions() const { return offsets.size() - 1; }
+
+  /// SCCs are numbered in topological order: every edge between
+  /// two SCCs goes from a lower to a higher number.
+  unsigned getNumSCCs() const { return sccOffsets.size() - 1; }
+
+  /// The SCC of the instruction with this CompactPDG index
+  unsigned getSCC(unsigned inst) const { return component[inst]; }
+
+  /// CompactPDG indices of the instructions of an SCC, sorted
+  ArrayRef<unsigned> getMembers(unsigned scc) const {
+    return makeArrayRef(members).slice(sccOffsets[scc],
+                                       sccOffsets[scc + 1] - sccOffsets[scc]);
+  }
+
+  /// SCCs with an edge from this one, sorted
+  ArrayRef<unsigned> getSuccessors(unsigned scc) const {
+    return makeArrayRef(successors)
+        .slice(succOffsets[scc], succOffsets[scc + 1] - succOffsets[scc]);
+  }
+
+  /// Does the SCC contain a cycle, i.e. more than one
+  /// instruction or an instruction depending on itself?
+  bool isRecurrent(unsigned scc) const { return recurrent[scc]; }
+
+private:
+  /// Edges leaving instruction i are targets/costs[offsets[i],
+  /// offsets[i+1]), sorted by target.  The cost of an edge is
+  /// NotRemovable if some dependence between its endpoints
+  /// has no remedies, else the most expensive of their remedy
+  /// sets.
+  std::vector<unsigned> offsets;
+  std::vector<unsigned> targets;
+  std::vector<unsigned long> costs;
+
+  static const unsigned long NotRemovable = ~0UL;
+
+  // Results of compute()
+  std::vector<unsigned> component;
+  std::vector<unsigned> sccOffsets, members;
+  std::vector<unsigned> succOffsets, successors;
+  std::vector<bool> recurrent;
+};
+
+} // namespace liberty
@@ -1,6 +1,8 @@
 #ifndef LLVM_LIBERTY_SPEC_PRIV_EDGE_COUNT_ORACLE_REMED_H
 #define LLVM_LIBERTY_SPEC_PRIV_EDGE_COUNT_ORACLE_REMED_H
 
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/IR/Instructions.h"
 
 #include "noelle/core/PDG.hpp"
@@ -52,10 +54,20 @@ public:
 
 private:
   ControlSpeculation *speculator;
-  std::unordered_map<const Instruction *,
-                     std::unordered_set<const Instruction *>>
-      unremovableCtrlDeps;
   Loop *loop;
+
+  // Control dependences which cannot be speculated, per loop.
+  // Blocks are numbered in loop order; the dependences from the
+  // terminator of block i are to every operation of block j if
+  // unremovableBlocks[i*N+j], to the PHIs with several incoming
+  // values of block j if unremovablePHIs[i*N+j], and to every
+  // operation of the loop if unremovableAll[i].
+  DenseMap<const BasicBlock *, unsigned> blockIndex;
+  BitVector unremovableBlocks, unremovablePHIs, unremovableAll;
+
+  void addUnremovable(BitVector &m, const BasicBlock *src,
+                      const BasicBlock *dst);
+  bool isUnremovable(const Instruction *term, const Instruction *inst) const;
 };
 
 } // namespace liberty
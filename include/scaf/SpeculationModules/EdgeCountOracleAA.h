@@ -38,6 +38,8 @@ struct EdgeCountOracle : public LoopAA // Not a pass!
     return SchedulingPreference(Low);
   }
 
+  RemedyRank getMinRemedyRank() const;
+
 private:
   ControlSpeculation *speculator;
 };
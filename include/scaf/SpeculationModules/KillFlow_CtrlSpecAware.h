@@ -42,6 +42,9 @@ using namespace arcana::noelle;
     DenseMap<const BasicBlock *, SmallPtrSet<const Instruction *, 1>>
         loopKillAlongInsts;
 
+    // Lowest stack position consulted by any entry of the caches above.
+    unsigned cachesConsulted;
+
     // Hold reference to this.
     ModuleLoops *mloops;
     const TargetLibraryInfo *tli;
@@ -84,6 +87,13 @@ using namespace arcana::noelle;
 
   protected:
     virtual void uponStackChange();
+    virtual void uponStackChange(unsigned changed);
+
+    void noteCacheHit() const { noteConsulted(cachesConsulted); }
+    void noteCacheFilled()
+    {
+      cachesConsulted = std::min(cachesConsulted, getLowestConsulted());
+    }
 
   public:
     static char ID;
@@ -177,6 +187,21 @@ using namespace arcana::noelle;
         return getNextAA();
     }
 
+    /// As above, counted toward the current scope, for the
+    /// queries made directly rather than through modref().
+    LoopAA *consultEffectiveTopAA() const
+    {
+      LoopAA *top = getEffectiveTopAA();
+      noteConsulted(top);
+      return top;
+    }
+    LoopAA *consultEffectiveNextAA() const
+    {
+      LoopAA *next = getEffectiveNextAA();
+      noteConsulted(next);
+      return next;
+    }
+
     /// getAdjustedAnalysisPointer - This method is used when a pass implements
     /// an analysis interface through multiple inheritance.  If needed, it
     /// should override this to adjust the this pointer as needed for the
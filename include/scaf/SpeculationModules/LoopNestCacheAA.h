@@ -0,0 +1,35 @@
+#ifndef LLVM_LIBERTY_LOOP_NEST_CACHE_AA_H
+#define LLVM_LIBERTY_LOOP_NEST_CACHE_AA_H
+
+#include "scaf/MemoryAnalysisModules/LoopAA.h"
+#include "scaf/SpeculationModules/LoopProf/TargetLoopHierarchy.h"
+
+namespace liberty {
+using namespace llvm;
+
+/// Sits at the top of the stack and answers operation-vs-operation
+/// queries on target loops from the facts the TargetLoopHierarchy
+/// has recorded for the loops nested with them.  Results which
+/// needed no remedies are recorded there in turn, so that facts
+/// established on an outer loop serve its inner loops, and vice
+/// versa, across loops and clients.
+struct LoopNestCacheAA : public LoopAA // Not a pass!
+{
+  LoopNestCacheAA(TargetLoopHierarchy &tlh) : LoopAA(), hierarchy(tlh) {}
+
+  StringRef getLoopAAName() const { return "loop-nest-cache-aa"; }
+
+  ModRefResult modref(const Instruction *A, TemporalRelation rel,
+                      const Instruction *B, const Loop *L, Remedies &R);
+
+  LoopAA::SchedulingPreference getSchedulingPreference() const {
+    return SchedulingPreference(Top + 10);
+  }
+
+private:
+  TargetLoopHierarchy &hierarchy;
+};
+
+} // namespace liberty
+
+#endif
@@ -1,9 +1,16 @@
 #ifndef LLVM_LIBERTY_TARGET_LOOP_HIERARCHY
 #define LLVM_LIBERTY_TARGET_LOOP_HIERARCHY
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+
+#include "scaf/MemoryAnalysisModules/LoopAA.h"
 #include "scaf/SpeculationModules/LoopProf/Targets.h"
 #include "scaf/Utilities/ModuleLoops.h"
 
+#include <utility>
+#include <vector>
+
 namespace liberty
 {
 
@@ -24,7 +31,50 @@ struct TargetLoopHierarchy : public ModulePass
   }
 
   bool runOnModule(Module& m);
+  void print(raw_ostream &os, const Module *m) const;
   bool hasHotSubloop(Loop* l, Targets& targets);
+
+  bool isTarget(const Loop *l) const { return targetHeaders.count(l->getHeader()); }
+
+  /// Record the result of modref(A, rel, B, l) which needed no
+  /// remedies.  Only kept for target loops.  Such facts are
+  /// shared by every client which analyzes the target loops.
+  void recordFact(const Loop *l, const Instruction *A,
+                  LoopAA::TemporalRelation rel, const Instruction *B,
+                  LoopAA::ModRefResult res);
+
+  /// A bound on modref(A, rel, B, l) implied by the facts recorded
+  /// for l and the loops nested with it, or ModRef if none is known.
+  ///
+  /// The Same fact of an outer loop covers A executing before B
+  /// within one of its iterations, and so within one invocation of
+  /// l.  It bounds the Same and Before relations in l, but not After,
+  /// where B executes first.  Conversely, a direct subloop is invoked
+  /// at most once per iteration of l, so if it contains both A and B
+  /// its Same, Before and After facts together bound the Same
+  /// relation in l.
+  LoopAA::ModRefResult getFactBound(const Loop *l, const Instruction *A,
+                                    LoopAA::TemporalRelation rel,
+                                    const Instruction *B) const;
+
+private:
+  std::vector< std::vector<Loop*> > h_vec;
+
+  DenseSet<const BasicBlock *> targetHeaders;
+
+  /// Per pair of operations, the recorded results by relation.
+  struct PairFacts
+  {
+    PairFacts() : known(0) {}
+
+    unsigned char known;
+    LoopAA::ModRefResult results[3];
+  };
+  typedef std::pair<const Instruction *, const Instruction *> OpPair;
+  DenseMap<const Loop *, DenseMap<OpPair, PairFacts> > facts;
+
+  const PairFacts *lookupFacts(const Loop *l, const Instruction *A,
+                               const Instruction *B) const;
 };
 
 }
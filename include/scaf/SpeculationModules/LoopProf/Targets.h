@@ -67,6 +67,14 @@ struct Targets : public ModulePass
   //iterator end_mloops() const { return iterator(Loops.end(),mloops); }
   iterator end(ModuleLoops &mloops) const { return iterator(Loops.end(),mloops); }
 
+  /// False once the -target-time-budget has elapsed for this client.
+  /// Each client has its own clock, started at its first call, so an
+  /// earlier client cannot use up the budget of a later one.  A client
+  /// should check it before each target loop and stop when it fails.
+  /// Since the loops are listed hottest first, the time is spent where
+  /// the execution time is.
+  bool isWithinBudget(const Pass *client);
+
 private:
   void addLoopByName(Module &, const std::string &, const std::string &, unsigned long wt, bool minIterCheck = false);
   bool expectsManyIterations(const Loop *loop) ;
@@ -76,6 +84,11 @@ private:
   ModuleLoops *mloops;
 
   LoopList Loops;
+
+  void sortByTime(LoopProfLoad &load);
+  void limitCoverage(LoopProfLoad &load);
+
+  std::map<const Pass *, double> budgetStarts;
 };
 
 }
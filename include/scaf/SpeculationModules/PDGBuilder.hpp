@@ -9,14 +9,17 @@
 #include "scaf/MemoryAnalysisModules/SimpleAA.h"
 #include "scaf/SpeculationModules/CallsiteDepthCombinator_CtrlSpecAware.h"
 #include "scaf/SpeculationModules/Classify.h"
+#include "scaf/SpeculationModules/CompactPDG.hpp"
 #include "scaf/SpeculationModules/EdgeCountOracleAA.h"
 #include "scaf/SpeculationModules/KillFlow_CtrlSpecAware.h"
+#include "scaf/SpeculationModules/LoopNestCacheAA.h"
 #include "scaf/SpeculationModules/PointsToAA.h"
 #include "scaf/SpeculationModules/PredictionSpeculation.h"
 #include "scaf/SpeculationModules/PredictionSpeculator.h"
 #include "scaf/SpeculationModules/PtrResidueAA.h"
 #include "scaf/SpeculationModules/Read.h"
 #include "scaf/SpeculationModules/ReadOnlyAA.h"
+#include "scaf/SpeculationModules/RetargetableAA.h"
 #include "scaf/SpeculationModules/ShortLivedAA.h"
 #include "scaf/SpeculationModules/SlampOracleAA.h"
 #include "scaf/SpeculationModules/SmtxAA.h"
@@ -31,6 +34,8 @@
 
 #include <unordered_set>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 using namespace llvm;
 using namespace arcana::noelle;
@@ -54,6 +59,7 @@ public:
     callsite_aware = 0;
     txioaa = 0;
     commlibsaa = 0;
+    nestaa = 0;
   }
   virtual ~PDGBuilder() {}
 
@@ -61,49 +67,98 @@ public:
   void getAnalysisUsage(AnalysisUsage &AU) const override;
   bool runOnModule(Module &M) override;
 
+  /// Remove the speculation modules and the loop nest cache from the
+  /// LoopAA stack.
+  void releaseMemory() override;
+
+  /// Null for a loop which Classify skipped, when -enable-specpriv
+  /// needs its heap assignment.
   std::unique_ptr<PDG> getLoopPDG(Loop *loop);
 
+  /// Same dependences and remedies as getLoopPDG(), in the
+  /// compact form used during construction.  CompactSCCDAG finds
+  /// its SCCs without materializing the noelle PDG.  Null where
+  /// getLoopPDG() is.
+  std::unique_ptr<CompactPDG> getLoopCompactPDG(Loop *loop);
+
+  /// Check that CompactSCCDAG::compute(budget) partitions the loop
+  /// into the same SCCs as the noelle SCCDAG of toPDG(budget).
+  /// Reports the first difference.
+  bool verifyCompactSCCDAG(const CompactPDG &pdg, unsigned long budget);
+
+  /// Check TransitiveControlDeps of the loop against a search of
+  /// its intra-iteration control dependences from each operation.
+  /// Reports the first difference.
+  bool verifyTransitiveControlDeps(const CompactPDG &pdg);
+
+  /// Load PDGs serialized by -write-pdg for loops of this module;
+  /// getLoopPDG() then returns them instead of recomputing.
+  void loadPDGs(Module &M, StringRef filename);
+
 private:
   unsigned loopCount = 0;
+  std::unordered_map<const BasicBlock *, std::unique_ptr<CompactPDG>>
+      loadedPDGs;
   const DataLayout *DL;
   NoControlSpeculation noctrlspec;
-  SmtxAA *smtxaa;
-  SlampOracleAA *slampaa;
-  EdgeCountOracle *edgeaa;
-  PredictionAA *predaa;
+
+  // Speculation modules and the loop nest cache are added to the
+  // LoopAA stack once, before the first loop is queried.  The modules
+  // are then retargeted to each loop.
+  std::vector<LoopTarget *> specModules;
+  RetargetableAA<SmtxAA> *smtxaa;
+  RetargetableAA<SlampOracleAA> *slampaa;
+  RetargetableAA<EdgeCountOracle> *edgeaa;
+  RetargetableAA<PredictionAA> *predaa;
   ControlSpeculation *ctrlspec;
   PredictionSpeculation *predspec;
-  PtrResidueAA *ptrresaa;
-  PointsToAA *pointstoaa;
-  ReadOnlyAA *roaa;
-  ShortLivedAA *localaa;
+  RetargetableAA<PtrResidueAA> *ptrresaa;
+  RetargetableAA<PointsToAA> *pointstoaa;
+  RetargetableAA<ReadOnlyAA> *roaa;
+  RetargetableAA<ShortLivedAA> *localaa;
 
-  TXIOAA *txioaa;
-  CommutativeLibsAA *commlibsaa;
+  RetargetableAA<TXIOAA> *txioaa;
+  RetargetableAA<CommutativeLibsAA> *commlibsaa;
 
-  SimpleAA *simpleaa;
+  RetargetableAA<SimpleAA> *simpleaa;
   Read *spresults;
   Classify *classify;
   KillFlow_CtrlSpecAware *killflow_aware;
   CallsiteDepthCombinator_CtrlSpecAware *callsite_aware;
+  LoopNestCacheAA *nestaa;
+
+  template <class AA, typename... Args>
+  RetargetableAA<AA> *addSpecModule(Args &&... args) {
+    auto aa = new RetargetableAA<AA>(std::forward<Args>(args)...);
+    aa->InitializeLoopAA(this, *DL);
+    specModules.push_back(aa);
+    return aa;
+  }
 
-  void addSpecModulesToLoopAA();
+  void addSpecModulesToLoopAA(Loop *loop);
   void specModulesLoopSetup(Loop *loop);
-  void removeSpecModulesFromLoopAA();
-  void constructEdgesFromUseDefs(PDG &pdg, Loop *loop);
-  void constructEdgesFromMemory(PDG &pdg, Loop *loop, LoopAA *aa);
-  void constructEdgesFromControl(PDG &pdg, Loop *loop);
+  void retireSpecModules(Loop *loop);
+  unsigned getSpecModulesPosition() const;
+  LoopAA *getSpecModulesAA(LoopAA *aa) const;
+  void constructEdgesFromUseDefs(CompactPDG &pdg, Loop *loop);
+  void constructEdgesFromMemory(CompactPDG &pdg, Loop *loop, LoopAA *aa);
+  void constructEdgesFromControl(CompactPDG &pdg, Loop *loop);
+
+  void addMemoryDep(Instruction *src, Instruction *dst, bool loopCarried,
+                    LoopAA::ModRefResult forward, LoopAA::ModRefResult reverse,
+                    CompactPDG &pdg, bool dead = false);
 
   void queryMemoryDep(Instruction *src, Instruction *dst,
                       LoopAA::TemporalRelation FW, LoopAA::TemporalRelation RV,
-                      Loop *loop, LoopAA *aa, PDG &pdg);
+                      Loop *loop, LoopAA *aa, CompactPDG &pdg,
+                      bool dead = false);
 
   void queryLoopCarriedMemoryDep(Instruction *src, Instruction *dst, Loop *loop,
-                                 LoopAA *aa, PDG &pdg);
+                                 LoopAA *aa, CompactPDG &pdg);
 
   void queryIntraIterationMemoryDep(Instruction *src, Instruction *dst,
-                                    Loop *loop, LoopAA *aa, PDG &pdg);
+                                    Loop *loop, LoopAA *aa, CompactPDG &pdg);
 
-  void annotateMemDepsWithRemedies(PDG &pdg, Loop *loop, LoopAA *aa);
+  void annotateMemDepsWithRemedies(CompactPDG &pdg, Loop *loop, LoopAA *aa);
 };
 } // namespace llvm
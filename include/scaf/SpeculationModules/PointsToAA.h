@@ -35,6 +35,8 @@ struct PointsToAA : public ClassicLoopAA // Not a pass!
     return SchedulingPreference(Bottom);
   }
 
+  virtual RemedyRank getMinRemedyRank() const;
+
   StringRef getLoopAAName() const { return "spec-priv-points-to-oracle-aa"; }
 
   virtual AliasResult aliasCheck(const Pointer &P1, TemporalRelation rel,
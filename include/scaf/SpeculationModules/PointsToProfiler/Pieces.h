@@ -21,7 +21,7 @@ using namespace llvm;
 enum CtxType { Ctx_Top=0, Ctx_Fcn, Ctx_Loop };
 struct Ctx : FoldingSetNode
 {
-  Ctx(CtxType t = Ctx_Top, const Ctx *p = 0) : type(t), parent(p), fcn(0), header(0), depth(0) {};
+  Ctx(CtxType t = Ctx_Top, const Ctx *p = 0) : type(t), parent(p), fcn(0), header(0), depth(0), numSteps(0), stepMask(0), innermostLoop(0) {};
 
   CtxType type;
   const Ctx *parent;
@@ -29,6 +29,15 @@ struct Ctx : FoldingSetNode
   const BasicBlock *header;
   unsigned depth;
 
+  // A summary of the whole chain from this to the top,
+  // computed once the context is interned by FoldManager.
+  // numSteps == 0 means it has not been computed.
+  unsigned numSteps;
+  uint64_t stepMask;          // union of step_bit() over the chain
+  const Ctx *innermostLoop;   // first Ctx_Loop along the chain, or 0
+
+  void computeEncoding();
+
   virtual void Profile(FoldingSetNodeID &) const;
 
   // Perform a loose test.
@@ -52,6 +61,9 @@ struct Ctx : FoldingSetNode
   // does not recur to parent contexts.
   bool step_equal(const Ctx *other) const;
 
+  // A single bit which is equal for equal steps.
+  uint64_t step_bit() const;
+
   const Function *getFcn() const;
 
   // Find the innermost function invocation which contains
@@ -6,6 +6,9 @@
 #include "scaf/SpeculationModules/Classify.h"
 #include "scaf/SpeculationModules/Read.h"
 
+#include <map>
+#include <utility>
+
 namespace liberty {
 using namespace llvm;
 using namespace arcana::noelle;
@@ -62,7 +65,8 @@ struct PrivAA : public LoopAA // Not a pass!
 {
   PrivAA(const Read &rd, const HeapAssignment &ha, const Ctx *cx,
          KillFlow &kill, ModuleLoops &ml, Loop *L)
-      : LoopAA(), read(rd), asgn(ha), ctx(cx), killFlow(kill), mloops(ml) {
+      : LoopAA(), read(rd), asgn(ha), ctx(cx), killFlow(kill), mloops(ml),
+        verdictsVersion(ha.getCheapPrivVersion()) {
     Function *f = L->getHeader()->getParent();
     pdt = &mloops.getAnalysis_PostDominatorTree(f);
     li = &mloops.getAnalysis_LoopInfo(f);
@@ -89,6 +93,11 @@ struct PrivAA : public LoopAA // Not a pass!
     return SchedulingPreference(Bottom + 6);
   }
 
+protected:
+  /// The verdicts do not consult the stack, but
+  /// those for L are of no use once it is done.
+  void uponLoopFinished(const Loop *L);
+
 private:
   const Read &read;
   const HeapAssignment &asgn;
@@ -105,6 +114,26 @@ private:
   bool isCheapPrivate(const Instruction *I, const Value **ptr, const Loop *L,
                       Remedies &R, Ptrs &aus);
 
+  /// The result of isCheapPrivate(), with its pointer,
+  /// underlying AUs and remedies.
+  struct PrivVerdict {
+    bool cheap;
+    const Value *ptr;
+    Ptrs aus;
+    Remedies_ptr R;
+  };
+
+  /// Verdicts per (operation, loop) and per (pointer, loop),
+  /// computed for the assignment of this version.
+  typedef std::pair<const Value *, const Loop *> VerdictKey;
+  std::map<VerdictKey, PrivVerdict> opVerdicts, ptrVerdicts;
+  unsigned verdictsVersion;
+
+  /// Memoized isCheapPrivate() of the operation I, or if
+  /// null, of ptr.  Dropped when the assignment changes.
+  const PrivVerdict &getPrivVerdict(const Instruction *I, const Value *ptr,
+                                    const Loop *L);
+
   bool hasUsedFullOverlapPrivAUs(const Ptrs &aus);
   BasicBlock *getLoopEntryBB(const Loop *loop);
   bool isTransLoopInvariant(const Value *val, const Loop *L);
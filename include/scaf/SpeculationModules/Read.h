@@ -21,6 +21,7 @@ namespace liberty
 {
 class PureFunAA;
 class SemiLocalFunAA;
+struct UnderlyingObjectsCache;
 
 namespace SpecPriv
 {
@@ -47,6 +48,7 @@ struct Read : public SemanticAction, public UpdateOnClone
   void setPureFunAA(const PureFunAA *pure);
   void setSemiLocalFunAA(const SemiLocalFunAA *semi);
   void setControlSpeculator(ControlSpeculation *ctrl);
+  void setUnderlyingObjectsCache(UnderlyingObjectsCache *cache);
 
   //set DataLayout
   void setDataLayout(const DataLayout *DL) {this->DL = DL;}
@@ -120,6 +122,7 @@ private:
   const PureFunAA *pure;
   const SemiLocalFunAA *semi;
   ControlSpeculation *ctrlspec;
+  UnderlyingObjectsCache *uoc;
 
   //sot
   const DataLayout *DL;
@@ -30,6 +30,13 @@ struct ReadOnlyAA : public LoopAA,
       : LoopAA(), read(rd), asgn(nullptr), readOnlyAUs(roAUs), ctx(cx),
         perf(pf) {}
 
+  /// Move to the heap assignment and context of another loop.
+  void setAssignment(const HeapAssignment &ha, const Ctx *cx) {
+    asgn = &ha;
+    readOnlyAUs = nullptr;
+    ctx = cx;
+  }
+
   virtual SchedulingPreference getSchedulingPreference() const {
     return SchedulingPreference(Bottom + 9);
   }
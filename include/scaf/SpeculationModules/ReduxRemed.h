@@ -1,6 +1,7 @@
 #ifndef LLVM_LIBERTY_REDUX_REMED_H
 #define LLVM_LIBERTY_REDUX_REMED_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/Analysis/ScalarEvolutionExpressions.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/Instructions.h"
@@ -16,6 +17,7 @@
 
 #include "noelle/core/LoopDependenceInfo.hpp"
 
+#include <unordered_map>
 #include <unordered_set>
 
 #define DEFAULT_REDUX_REMED_COST 2
@@ -56,18 +58,11 @@ public:
   void setLoopOfInterest(Loop *l) {
     Function *f = l->getHeader()->getParent();
     se = &mloops->getAnalysis_ScalarEvolution(f);
-    // clear the cached results for the new loop
-    regReductions.clear();
-    memReductions.clear();
-    findMemReductions(l);
-    findMinMaxRegReductions(l);
+    current = &getLoopReductions(l);
   }
 
   StringRef getRemediatorName() const { return "redux-remediator"; }
 
-  void findMemReductions(Loop *l);
-  void findMinMaxRegReductions(Loop *l);
-
   RemedResp regdep(const Instruction *A, const Instruction *B, bool loopCarried,
                    const Loop *L);
 
@@ -79,13 +74,63 @@ public:
   bool isMemReduction(const Instruction *I);
 
 private:
-  std::unordered_set<const Instruction *> regReductions;
-  std::unordered_set<const StoreInst *> memReductions;
+  /// How a reduction removes a loop-carried register dependence.
+  struct RegRedux {
+    enum Kind { None, Sum, MinMax, LLVM, Cond };
+
+    RegRedux()
+        : kind(None), type(Reduction::NotReduction), depInst(nullptr),
+          depType(Reduction::NotReduction), depUpdateInst(nullptr),
+          cmpInst(nullptr) {}
+
+    Kind kind;
+    Reduction::Type type;
+
+    // Min/max only
+    const Instruction *depInst;
+    Reduction::Type depType;
+    const Instruction *depUpdateInst;
+    const CmpInst *cmpInst;
+  };
+
+  typedef std::pair<const Instruction *, const Instruction *> InstPair;
+
+  /// Reduction classification of one loop, with both positive
+  /// and negative answers.  Computed when the loop is first seen;
+  /// regdep()/memdep() are served from here.
+  struct LoopReductions {
+    /// Loop-carried register deps, src -> dst.  Pre-populated for
+    /// every header PHI and each of its incoming values in the loop.
+    DenseMap<InstPair, RegRedux> regDeps;
+
+    /// Header PHIs classified by Reduction::isRegisterReduction.
+    DenseMap<const Instruction *, bool> regReductionPHIs;
+
+    /// Stores which update a reduction accumulator.
+    std::unordered_set<const StoreInst *> memReductions;
+  };
+
+  LoopReductions &getLoopReductions(const Loop *l);
+  const RegRedux &getRegRedux(LoopReductions &redux, const Instruction *A,
+                              const Instruction *B, const Loop *L);
+  RegRedux classifyRegDep(const Instruction *A, const Instruction *B,
+                          const Loop *L);
+
+  void findMemReductions(Loop *l, LoopReductions &redux);
+  void findMinMaxRegReductions(Loop *l);
+
+  std::unordered_map<const Loop *, LoopReductions> loopReductions;
+  LoopReductions *current = nullptr;
+
   ModuleLoops *mloops;
   ScalarEvolution *se;
   //LoopDependenceInfo *loopDepInfo;
   LoopAA *loopAA;
   PDG *pdg;
+
+  // Only declared in this tree; its definitions are linked in from
+  // elsewhere.  Its answers are memoized in LoopReductions above
+  // rather than inside it.
   ReductionDetection reduxdet;
 };
 
@@ -0,0 +1,75 @@
+#ifndef LLVM_LIBERTY_RETARGETABLE_AA_H
+#define LLVM_LIBERTY_RETARGETABLE_AA_H
+
+#include "scaf/MemoryAnalysisModules/LoopAA.h"
+
+#include <utility>
+
+namespace liberty {
+using namespace llvm;
+using namespace arcana::noelle;
+
+/// The loop which a long-lived speculation module works on
+class LoopTarget {
+public:
+  virtual ~LoopTarget() {}
+
+  /// Answer queries while working on L; stop if null.
+  void setLoop(const Loop *L) { loop = L; }
+  const Loop *getLoop() const { return loop; }
+
+  virtual LoopAA *getLoopAA() = 0;
+
+protected:
+  const Loop *loop = nullptr;
+};
+
+/// Keeps a speculation module in the LoopAA stack across the loops
+/// of a client, instead of adding and removing it for each.  The
+/// module only answers while it is set to a loop; otherwise its
+/// queries chain, as if it were not in the stack.
+///
+/// Moving between loops does not change the stack, so it does not
+/// notify the other modules.  A client which relies on their caches
+/// not holding answers from the speculation modules must call
+/// stackHasChanged() itself, with the position of the modules it
+/// moved, and loopHasFinished() when it is done with a loop.
+template <class AA>
+struct RetargetableAA : public AA, public LoopTarget // Not a pass!
+{
+  template <typename... Args>
+  RetargetableAA(Args &&... args) : AA(std::forward<Args>(args)...) {}
+
+  LoopAA *getLoopAA() override { return this; }
+
+  LoopAA::AliasResult
+  alias(const Value *ptrA, unsigned sizeA, LoopAA::TemporalRelation rel,
+        const Value *ptrB, unsigned sizeB, const Loop *L, Remedies &R,
+        LoopAA::DesiredAliasResult dAliasRes = LoopAA::DNoOrMustAlias) override {
+    if (!loop)
+      return LoopAA::alias(ptrA, sizeA, rel, ptrB, sizeB, L, R, dAliasRes);
+    return AA::alias(ptrA, sizeA, rel, ptrB, sizeB, L, R, dAliasRes);
+  }
+
+  LoopAA::ModRefResult modref(const Instruction *A,
+                              LoopAA::TemporalRelation rel, const Value *ptrB,
+                              unsigned sizeB, const Loop *L,
+                              Remedies &R) override {
+    if (!loop)
+      return LoopAA::modref(A, rel, ptrB, sizeB, L, R);
+    return AA::modref(A, rel, ptrB, sizeB, L, R);
+  }
+
+  LoopAA::ModRefResult modref(const Instruction *A,
+                              LoopAA::TemporalRelation rel,
+                              const Instruction *B, const Loop *L,
+                              Remedies &R) override {
+    if (!loop)
+      return LoopAA::modref(A, rel, B, L, R);
+    return AA::modref(A, rel, B, L, R);
+  }
+};
+
+} // namespace liberty
+
+#endif
@@ -30,6 +30,13 @@ struct ShortLivedAA : public LoopAA, Remediator // Not a pass!
       : LoopAA(), read(rd), asgn(nullptr), localAUs(slAUs), ctx(cx),
         perf(pf) {}
 
+  /// Move to the heap assignment and context of another loop.
+  void setAssignment(const HeapAssignment &ha, const Ctx *cx) {
+    asgn = &ha;
+    localAUs = nullptr;
+    ctx = cx;
+  }
+
   virtual SchedulingPreference getSchedulingPreference() const {
     return SchedulingPreference(Bottom + 10);
   }
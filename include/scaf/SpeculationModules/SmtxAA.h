@@ -35,6 +35,8 @@ struct SmtxAA : public LoopAA, public Remediator // Not a pass!
     return SchedulingPreference(Bottom + 1);
   }
 
+  virtual RemedyRank getMinRemedyRank() const;
+
   StringRef getLoopAAName() const { return "smtx-aa"; }
   StringRef getRemediatorName() const override { return "smtx-remed"; }
 
@@ -42,6 +42,8 @@ struct TXIOAA : public LoopAA, Remediator // Not a pass!
     return SchedulingPreference(Low - 9);
   }
 
+  RemedyRank getMinRemedyRank() const override;
+
   RemedResp memdep(const Instruction *A, const Instruction *B, bool loopCarried, DataDepType dataDepTy, const Loop *L) override;
 };
 
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/Analysis/LoopInfo.h"
+
+#include "scaf/SpeculationModules/CompactPDG.hpp"
+#include "scaf/SpeculationModules/CompactSCCDAG.hpp"
+
+#include <vector>
+
+namespace liberty {
+using namespace llvm;
+
+/// The transitive closure of the intra-iteration control
+/// dependences of a loop, over the dense indices of its CompactPDG.
+///
+/// The dependences are condensed into SCCs (a DAG, unless the loop
+/// has subloops) and each SCC with successors gets one bitset of
+/// everything it reaches, computed in reverse topological order.
+/// The result does not refer to the CompactPDG and may be kept for
+/// as long as the loop is unchanged.
+class TransitiveControlDeps {
+public:
+  TransitiveControlDeps(const CompactPDG &pdg);
+
+  Loop *getLoop() const { return loop; }
+
+  /// Is there a chain of one or more intra-iteration control
+  /// dependences from src to dst?
+  bool isControlDependent(unsigned src, unsigned dst) const;
+
+private:
+  Loop *loop;
+  CompactSCCDAG sccs;
+
+  /// Per SCC, its row in reached, or NoRow if it reaches nothing
+  std::vector<unsigned> rows;
+  std::vector<BitVector> reached;
+
+  static const unsigned NoRow = ~0U;
+};
+
+} // namespace liberty
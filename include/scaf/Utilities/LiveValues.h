@@ -3,6 +3,7 @@
 
 #include "llvm/ADT/BitVector.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Value.h"
 
@@ -17,6 +18,7 @@ struct LiveValues {
   typedef DenseMap<const BasicBlock *, BitVector> ValueSets;
 
   typedef std::vector<const Value *> ValueList;
+  typedef SmallPtrSet<const BasicBlock *, 16> BlockSet;
 
   /// Perform dataflow analysis on
   /// fcn to compute live values at
@@ -24,7 +26,17 @@ struct LiveValues {
   /// basic block.  Optionally, exclude
   /// function arguments from this
   /// analysis.
-  LiveValues(const Function &fcn, bool includeFcnArgs = true);
+  ///
+  /// If lazy is set, nothing is computed
+  /// up front.  Instead, each query walks
+  /// the def-use chains of each value
+  /// backwards from its uses towards its
+  /// def.  Memory is then proportional to
+  /// the function, not to values x blocks,
+  /// which is preferable on huge functions
+  /// when only a few points are queried.
+  LiveValues(const Function &fcn, bool includeFcnArgs = true,
+             bool lazy = false);
 
   /// Compute a vector of Value pointers
   /// representing values which are
@@ -59,10 +71,23 @@ struct LiveValues {
                                 ValueList &liveIns) const; // output
 
 private:
+  const Function *function;
+  bool includeFcnArgs;
+  bool lazy;
+
   Value2Num numbers;
   Num2Value revNumbers;
   ValueSets OUT;
 
+  void runDataflow();
+
+  // Lazy mode.
+  bool isCandidate(const Value *v) const;
+  bool isLiveInToAny(const Value *v, const BlockSet &targets) const;
+  bool isLiveOutFromBB(const Value *v, const BasicBlock *bb) const;
+  void collectLiveIn(const BlockSet &targets, const BlockSet &phiPreds,
+                     const BasicBlock *phiBlock, ValueList &liveIns) const;
+
   void assignValueNumber(const Value *v);
   void computeIN(const BasicBlock *bb, BitVector &IN) const;
   void addUsesFromPHI(const BasicBlock *pred, const BasicBlock *succ,
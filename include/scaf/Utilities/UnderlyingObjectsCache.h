@@ -0,0 +1,92 @@
+#ifndef LLVM_LIBERTY_UNDERLYING_OBJECTS_CACHE_H
+#define LLVM_LIBERTY_UNDERLYING_OBJECTS_CACHE_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/ValueHandle.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/Allocator.h"
+
+#include <deque>
+#include <utility>
+
+namespace liberty {
+using namespace llvm;
+
+/// Memoizes GetUnderlyingObjects(), findUnderlyingObjects() and
+/// findAllCaptures() so that the memory analysis modules which ask
+/// the same questions about the same pointers share a single answer.
+///
+/// Results are returned as sorted ArrayRef views into storage owned
+/// by this pass.  They remain valid until the cache is reset.  The
+/// cache resets itself if any value it was queried about, or any value
+/// in one of its results, is deleted or replaced.  Passes which change
+/// the answers without doing so (e.g. by adding a use which captures a
+/// pointer) must call reset().
+struct UnderlyingObjectsCache : public ImmutablePass {
+  static char ID;
+  UnderlyingObjectsCache();
+  ~UnderlyingObjectsCache();
+
+  typedef ArrayRef<const Value *> Objects;
+
+  void getAnalysisUsage(AnalysisUsage &au) const { au.setPreservesAll(); }
+
+  /// Same as GetUnderlyingObjects(ptr, uo, DL).
+  Objects getUnderlyingObjects(const Value *ptr, const DataLayout &DL);
+
+  /// Same as GetUnderlyingObjects(ptr, beforePHI, afterPHI, DL).
+  void getUnderlyingObjects(const Value *ptr, Objects &beforePHI,
+                            Objects &afterPHI, const DataLayout &DL);
+
+  /// Same as findUnderlyingObjects(value, objects).
+  Objects findUnderlyingObjects(const Value *value);
+
+  /// Same as findAllCaptures(v).
+  bool isCaptured(const Value *v);
+
+  /// Same as findAllCaptures(v, &captures).
+  bool findAllCaptures(const Value *v, Objects &captures);
+
+  /// Drop all memoized results.
+  void reset();
+
+private:
+  /// Watches a queried or returned value; marks the cache
+  /// stale if the value is deleted or replaced.
+  struct Watch : public CallbackVH {
+    Watch(Value *v, UnderlyingObjectsCache *c) : CallbackVH(v), cache(c) {}
+
+    void deleted() override;
+    void allUsesReplacedWith(Value *) override;
+
+  private:
+    UnderlyingObjectsCache *cache;
+  };
+
+  typedef DenseMap<const Value *, Objects> Value2Objects;
+  typedef DenseMap<const Value *, std::pair<Objects, Objects>> Value2Split;
+
+  BumpPtrAllocator storage;
+
+  Value2Objects underlying;
+  Value2Split underlyingSplit;
+  Value2Objects found;
+  Value2Objects captureSets;
+  DenseMap<const Value *, bool> captured;
+
+  DenseSet<const Value *> watched;
+  std::deque<Watch> watches;
+  bool stale;
+
+  void checkStale();
+  void watch(const Value *v);
+
+  template <class Collection> Objects intern(const Collection &values);
+};
+
+} // namespace liberty
+
+#endif
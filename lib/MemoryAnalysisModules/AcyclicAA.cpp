@@ -40,6 +40,8 @@ STATISTIC(numQueries, "Number of AA queries given to AcyclicAA");
 STATISTIC(
     numNoAliases,
     "Number of no-alias results given because of acyclic data structures");
+STATISTIC(numChildHits,
+          "Number of isChildOfTransitive queries answered from the cache");
 
 typedef DenseMap<Value *, bool> Val2Bool;
 
@@ -510,9 +512,20 @@ bool AcyclicAA::isChildOfTransitive(const Value *v1, const Value *v2,
 
 bool AcyclicAA::isChildOfTransitive(const Value *v1, const Value *v2,
                                     TemporalRelation rel, const Loop *L) const {
+  // The PHI rule only distinguishes Same from the other relations.
+  const ChildQuery key(std::make_pair(v1, v2),
+                       std::make_pair(L, rel == LoopAA::Same));
+  auto i = childOfTransitive.find(key);
+  if (i != childOfTransitive.end()) {
+    ++numChildHits;
+    return i->second;
+  }
+
   LLVM_DEBUG(errs() << "isChildOfTransitive(" << *v1 << ", " << *v2 << ").\n");
   SmallValueSet noInfiniteLoops;
-  return isChildOfTransitive(v1, v2, rel, L, noInfiniteLoops);
+  const bool child = isChildOfTransitive(v1, v2, rel, L, noInfiniteLoops);
+  childOfTransitive[key] = child;
+  return child;
 }
 
 LoopAA::AliasResult AcyclicAA::aliasCheck(const Pointer &P1,
@@ -10,6 +10,8 @@
 
 #include "scaf/MemoryAnalysisModules/ClassicLoopAA.h"
 
+#include <map>
+
 namespace liberty {
 using namespace llvm;
 using namespace arcana::noelle;
@@ -33,6 +35,14 @@ class AcyclicAA : public ModulePass, public ClassicLoopAA {
   bool isChildOfTransitive(const Value *v1, const Value *v2,
                            TemporalRelation rel, const Loop *L) const;
 
+  // Answers of isChildOfTransitive(v1, v2, rel, L), keyed by
+  // (v1, v2, L, rel == Same).  Only relies on the IR and on
+  // NonCapturedFieldsAnalysis; survives uponStackChange().
+  typedef std::pair<std::pair<const Value *, const Value *>,
+                    std::pair<const Loop *, bool>>
+      ChildQuery;
+  mutable std::map<ChildQuery, bool> childOfTransitive;
+
   Module *currentModule;
 
 public:
@@ -18,6 +18,8 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <vector>
+
 using namespace llvm;
 using namespace arcana::noelle;
 using namespace liberty;
@@ -33,16 +35,90 @@ typedef DenseMap<FcnPtrKey, LoopAA::ModRefResult> FcnPtrCache;
 typedef DenseMap<InstFcnKey, LoopAA::ModRefResult> InstFcnCache;
 typedef DenseMap<FcnInstKey, LoopAA::ModRefResult> FcnInstCache;
 
+/// Drop the entries which consulted the stack at or below changed.
+template <class Key, class Cache>
+static void forgetAffected(Cache &cache, DenseMap<Key, unsigned> &consulted,
+                           unsigned changed) {
+  std::vector<Key> affected;
+  for (auto &entry : consulted)
+    if (LoopAA::isAffected(entry.second, changed))
+      affected.push_back(entry.first);
+
+  for (const Key &key : affected) {
+    cache.erase(key);
+    consulted.erase(key);
+  }
+}
+
 typedef Value::const_user_iterator UseIt;
 typedef DenseSet<const Value *> ValueSet;
 
+/// The operations of a callee which an expansion must visit.
+/// Memory operations on allocas are patently local and are
+/// only counted.
+struct FcnOps {
+  FcnOps() : numLocal(0) {}
+
+  std::vector<const Instruction *> memOps;
+  std::vector<const Instruction *> callsites;
+  unsigned numLocal;
+};
+
+typedef DenseMap<const Function *, FcnOps> FcnOpsMap;
+
 class CallsiteBreadthCombinator : public ModulePass, public liberty::LoopAA {
   InstFcnCache instFcnCache;
   FcnInstCache fcnInstCache;
   FcnPtrCache fcnPtrCache;
 
+  // Lowest stack position consulted by each entry.  Entries
+  // still being computed are ModRef and consulted nothing.
+  DenseMap<InstFcnKey, unsigned> instFcnConsulted;
+  DenseMap<FcnInstKey, unsigned> fcnInstConsulted;
+  DenseMap<FcnPtrKey, unsigned> fcnPtrConsulted;
+
+  // Does not depend on the stack; survives uponStackChange().
+  FcnOpsMap fcnOps;
+
   const DataLayout *DL;
 
+  const FcnOps &getFcnOps(const Function *fcn) {
+    FcnOpsMap::iterator i = fcnOps.find(fcn);
+    if (i != fcnOps.end())
+      return i->second;
+
+    FcnOps &fo = fcnOps[fcn];
+    for (const_inst_iterator i = inst_begin(fcn), e = inst_end(fcn); i != e;
+         ++i) {
+      const Instruction *instFromCallee = &*i;
+      if (!instFromCallee->mayReadFromMemory() &&
+          !instFromCallee->mayWriteToMemory())
+        continue;
+
+      if (isa<CallInst>(instFromCallee) || isa<InvokeInst>(instFromCallee)) {
+        CallSite nested = getCallSite(instFromCallee);
+        if (nested.getInstruction())
+          fo.callsites.push_back(instFromCallee);
+        continue;
+      }
+
+      const Value *ptr = 0;
+      if (const StoreInst *store = dyn_cast<StoreInst>(instFromCallee))
+        ptr = store->getPointerOperand();
+      else if (const LoadInst *load = dyn_cast<LoadInst>(instFromCallee))
+        ptr = load->getPointerOperand();
+
+      if (ptr && isa<AllocaInst>(GetUnderlyingObject(ptr, *DL, 0))) {
+        ++fo.numLocal;
+        continue;
+      }
+
+      fo.memOps.push_back(instFromCallee);
+    }
+
+    return fo;
+  }
+
   unsigned countPtrArgs(const Instruction *inst) {
     CallSite cs = getCallSite(inst);
 
@@ -61,12 +137,12 @@ class CallsiteBreadthCombinator : public ModulePass, public liberty::LoopAA {
 
   ModRefResult recur(const Instruction *op, TemporalRelation Rel,
                      const Value *p2, unsigned s2, const Loop *L, Remedies &R) {
-    return getTopAA()->modref(op, Rel, p2, s2, L, R);
+    return consultTopAA()->modref(op, Rel, p2, s2, L, R);
   }
 
   ModRefResult recur(const Instruction *i1, TemporalRelation Rel,
                      const Instruction *i2, const Loop *L, Remedies &R) {
-    return getTopAA()->modref(i1, Rel, i2, L, R);
+    return consultTopAA()->modref(i1, Rel, i2, L, R);
   }
 
   ModRefResult recurLeft(const Function *fcn, TemporalRelation Rel,
@@ -74,51 +150,34 @@ class CallsiteBreadthCombinator : public ModulePass, public liberty::LoopAA {
     FcnInstKey key(fcn, Rel, i2, L);
     if (fcnInstCache.count(key)) {
       ++numHitsFI;
+      noteConsulted(fcnInstConsulted[key]);
       return fcnInstCache[key];
     }
 
     // Avoid infinite recursion.  We will put in a more precise answer later.
     fcnInstCache[key] = ModRef;
+    fcnInstConsulted[key] = NothingConsulted;
+    ConsultedScope consulted;
 
     ++numRecurs;
     ModRefResult result = NoModRef;
 
+    const FcnOps &fo = getFcnOps(fcn);
+    numOps += fo.numLocal;
+    numKilledOps += fo.numLocal;
+
     // Update the query for non-callsite instructions first.
     // We will visit nested callsites later.
-    for (const_inst_iterator i = inst_begin(fcn), e = inst_end(fcn); i != e;
-         ++i) {
+    for (unsigned i = 0, N = fo.memOps.size(); i < N; ++i) {
       // Possibly break early if it can't get worse.
       if (result == ModRef)
         break;
 
-      const Instruction *instFromCallee = &*i;
-      if (!instFromCallee->mayReadFromMemory() &&
-          !instFromCallee->mayWriteToMemory())
-        continue;
-      if (isa<CallInst>(instFromCallee) || isa<InvokeInst>(instFromCallee))
-        continue;
+      const Instruction *instFromCallee = fo.memOps[i];
 
       // Inst is a memory operation.
       ++numOps;
 
-      if (const StoreInst *store = dyn_cast<StoreInst>(instFromCallee)) {
-        if (isa<AllocaInst>(
-                GetUnderlyingObject(store->getPointerOperand(), *DL, 0))) {
-          // Allocas are patently local
-          ++numKilledOps;
-          continue;
-        }
-      }
-
-      else if (const LoadInst *load = dyn_cast<LoadInst>(instFromCallee)) {
-        if (isa<AllocaInst>(
-                GetUnderlyingObject(load->getPointerOperand(), *DL, 0))) {
-          // Allocas are patently local
-          ++numKilledOps;
-          continue;
-        }
-      }
-
       ModRefResult old = result;
       result = ModRefResult(result | recur(instFromCallee, Rel, i2, L, R));
 
@@ -131,19 +190,12 @@ class CallsiteBreadthCombinator : public ModulePass, public liberty::LoopAA {
     }
 
     // Now the nested callsites.
-    for (const_inst_iterator i = inst_begin(fcn), e = inst_end(fcn); i != e;
-         ++i) {
+    for (unsigned i = 0, N = fo.callsites.size(); i < N; ++i) {
       // possibly break early.
       if (result == ModRef)
         break;
 
-      const Instruction *instFromCallee = &*i;
-      if (!instFromCallee->mayReadFromMemory() &&
-          !instFromCallee->mayWriteToMemory())
-        continue;
-      CallSite nested = getCallSite(instFromCallee);
-      if (!nested.getInstruction())
-        continue;
+      const Instruction *instFromCallee = fo.callsites[i];
 
       ++numOps;
 
@@ -158,6 +210,7 @@ class CallsiteBreadthCombinator : public ModulePass, public liberty::LoopAA {
       });
     }
 
+    fcnInstConsulted[key] = consulted.getLowest();
     return fcnInstCache[key] = result;
   }
 
@@ -167,52 +220,35 @@ class CallsiteBreadthCombinator : public ModulePass, public liberty::LoopAA {
     FcnPtrKey key(fcn, Rel, p2, s2, L);
     if (fcnPtrCache.count(key)) {
       ++numHitsFP;
+      noteConsulted(fcnPtrConsulted[key]);
       return fcnPtrCache[key];
     }
 
     // Avoid infinite recursion.  We'll put in a more precise
     // result later.
     fcnPtrCache[key] = ModRef;
+    fcnPtrConsulted[key] = NothingConsulted;
+    ConsultedScope consulted;
 
     ++numRecurs;
     ModRefResult result = NoModRef;
 
+    const FcnOps &fo = getFcnOps(fcn);
+    numOps += fo.numLocal;
+    numKilledOps += fo.numLocal;
+
     // Update the query for non-callsite instructions first.
     // We will visit nested callsites later.
-    for (const_inst_iterator i = inst_begin(fcn), e = inst_end(fcn); i != e;
-         ++i) {
+    for (unsigned i = 0, N = fo.memOps.size(); i < N; ++i) {
       // Possibly break early if it can't get worse.
       if (result == ModRef)
         break;
 
-      const Instruction *instFromCallee = &*i;
-      if (!instFromCallee->mayReadFromMemory() &&
-          !instFromCallee->mayWriteToMemory())
-        continue;
-      if (isa<CallInst>(instFromCallee) || isa<InvokeInst>(instFromCallee))
-        continue;
+      const Instruction *instFromCallee = fo.memOps[i];
 
       // Inst is a memory operation.
       ++numOps;
 
-      if (const StoreInst *store = dyn_cast<StoreInst>(instFromCallee)) {
-        if (isa<AllocaInst>(
-                GetUnderlyingObject(store->getPointerOperand(), *DL, 0))) {
-          // Allocas are patently local
-          ++numKilledOps;
-          continue;
-        }
-      }
-
-      else if (const LoadInst *load = dyn_cast<LoadInst>(instFromCallee)) {
-        if (isa<AllocaInst>(
-                GetUnderlyingObject(load->getPointerOperand(), *DL, 0))) {
-          // Allocas are patently local
-          ++numKilledOps;
-          continue;
-        }
-      }
-
       ModRefResult old = result;
       result = ModRefResult(result | recur(instFromCallee, Rel, p2, s2, L, R));
 
@@ -225,19 +261,12 @@ class CallsiteBreadthCombinator : public ModulePass, public liberty::LoopAA {
     }
 
     // Now the nested callsites.
-    for (const_inst_iterator i = inst_begin(fcn), e = inst_end(fcn); i != e;
-         ++i) {
+    for (unsigned i = 0, N = fo.callsites.size(); i < N; ++i) {
       // possibly break early.
       if (result == ModRef)
         break;
 
-      const Instruction *instFromCallee = &*i;
-      if (!instFromCallee->mayReadFromMemory() &&
-          !instFromCallee->mayWriteToMemory())
-        continue;
-      CallSite nested = getCallSite(instFromCallee);
-      if (!nested.getInstruction())
-        continue;
+      const Instruction *instFromCallee = fo.callsites[i];
 
       ++numOps;
 
@@ -252,6 +281,7 @@ class CallsiteBreadthCombinator : public ModulePass, public liberty::LoopAA {
       });
     }
 
+    fcnPtrConsulted[key] = consulted.getLowest();
     return fcnPtrCache[key] = result;
   }
 
@@ -260,51 +290,36 @@ class CallsiteBreadthCombinator : public ModulePass, public liberty::LoopAA {
     InstFcnKey key(i1, Rel, fcn, L);
     if (instFcnCache.count(key)) {
       ++numHitsIF;
+      noteConsulted(instFcnConsulted[key]);
       return instFcnCache[key];
     }
 
     // Avoid infinite recursion.  We will put in a more precise answer later.
     instFcnCache[key] = ModRef;
+    instFcnConsulted[key] = NothingConsulted;
+    ConsultedScope consulted;
 
     KillFlow &killFlow = getAnalysis<KillFlow>();
 
     ++numRecurs;
     ModRefResult result = NoModRef;
 
+    const FcnOps &fo = getFcnOps(fcn);
+    numOps += fo.numLocal;
+    numKilledOps += fo.numLocal;
+
     // Update the query for non-callsite instructions first.
     // We will visit nested callsites later.
-    for (const_inst_iterator i = inst_begin(fcn), e = inst_end(fcn); i != e;
-         ++i) {
+    for (unsigned i = 0, N = fo.memOps.size(); i < N; ++i) {
       // Possibly break early if it can't get worse.
       if (result == ModRef)
         break;
 
-      const Instruction *instFromCallee = &*i;
-      if (!instFromCallee->mayReadFromMemory() &&
-          !instFromCallee->mayWriteToMemory())
-        continue;
-      if (isa<CallInst>(instFromCallee) || isa<InvokeInst>(instFromCallee))
-        continue;
+      const Instruction *instFromCallee = fo.memOps[i];
 
       ++numOps;
 
-      if (const StoreInst *store = dyn_cast<StoreInst>(instFromCallee)) {
-        if (isa<AllocaInst>(
-                GetUnderlyingObject(store->getPointerOperand(), *DL, 0))) {
-          // Allocas are patently local
-          ++numKilledOps;
-          continue;
-        }
-      }
-
-      else if (const LoadInst *load = dyn_cast<LoadInst>(instFromCallee)) {
-        if (isa<AllocaInst>(
-                GetUnderlyingObject(load->getPointerOperand(), *DL, 0))) {
-          // Allocas are patently local
-          ++numKilledOps;
-          continue;
-        }
-
+      if (const LoadInst *load = dyn_cast<LoadInst>(instFromCallee)) {
         if (killFlow.pointerKilledBefore(0, load->getPointerOperand(), load)) {
           ++numKilledOps;
           continue;
@@ -324,19 +339,12 @@ class CallsiteBreadthCombinator : public ModulePass, public liberty::LoopAA {
     }
 
     // Now the nested callsites.
-    for (const_inst_iterator i = inst_begin(fcn), e = inst_end(fcn); i != e;
-         ++i) {
+    for (unsigned i = 0, N = fo.callsites.size(); i < N; ++i) {
       // possibly break early.
       if (result == ModRef)
         break;
 
-      const Instruction *instFromCallee = &*i;
-      if (!instFromCallee->mayReadFromMemory() &&
-          !instFromCallee->mayWriteToMemory())
-        continue;
-      CallSite nested = getCallSite(instFromCallee);
-      if (!nested.getInstruction())
-        continue;
+      const Instruction *instFromCallee = fo.callsites[i];
 
       // top-query
       ++numOps;
@@ -351,6 +359,7 @@ class CallsiteBreadthCombinator : public ModulePass, public liberty::LoopAA {
       });
     }
 
+    instFcnConsulted[key] = consulted.getLowest();
     return instFcnCache[key] = result;
   }
 
@@ -374,6 +383,15 @@ protected:
     instFcnCache.clear();
     fcnInstCache.clear();
     fcnPtrCache.clear();
+    instFcnConsulted.clear();
+    fcnInstConsulted.clear();
+    fcnPtrConsulted.clear();
+  }
+
+  virtual void uponStackChange(unsigned changed) {
+    forgetAffected(instFcnCache, instFcnConsulted, changed);
+    forgetAffected(fcnInstCache, fcnInstConsulted, changed);
+    forgetAffected(fcnPtrCache, fcnPtrConsulted, changed);
   }
 
 public:
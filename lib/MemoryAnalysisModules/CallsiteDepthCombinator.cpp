@@ -12,6 +12,9 @@
 #include "scaf/Utilities/CallSiteFactory.h"
 
 #include <ctime>
+#include <memory>
+#include <queue>
+#include <vector>
 
 namespace liberty {
 using namespace llvm;
@@ -20,6 +23,9 @@ using namespace arcana::noelle;
 STATISTIC(numHits, "Num cache hits");
 STATISTIC(numEligible, "Num eligible");
 STATISTIC(numFlowTests, "Num flow tests");
+STATISTIC(numExpanded, "Num deferred callsites expanded by flow search");
+STATISTIC(numDeferredNoFlow,
+          "Num deferred callsites disproved without expansion");
 
 STATISTIC(numKillScalarStoreAfterSrc,
           "Num flows killed: store scalar after src");
@@ -52,6 +58,7 @@ bool CallsiteDepthCombinator::runOnModule(Module &mod) {
     killflow->setEffectiveNextAA(getNextAA());
     killflow->setEffectiveTopAA(getTopAA());
     killflow->setModuleLoops(&getAnalysis<ModuleLoops>());
+    killflow->setUnderlyingObjectsCache(&getAnalysis<UnderlyingObjectsCache>());
     killflow->setDL(&DL);
     // killflow->setProxy(this);
   }
@@ -77,10 +84,26 @@ bool CallsiteDepthCombinator::isEligible(const Instruction *i) const {
 void CallsiteDepthCombinator::getAnalysisUsage(AnalysisUsage &AU) const {
   LoopAA::getAnalysisUsage(AU);
   AU.addRequired<ModuleLoops>();
+  AU.addRequired<UnderlyingObjectsCache>();
   //    AU.addRequired< KillFlow >();
   AU.setPreservesAll(); // Does not transform code
 }
 
+// Keep the entries which did not consult the stack
+// as low as the change.
+void CallsiteDepthCombinator::uponStackChange(unsigned changed) {
+  std::vector<IIKey> affected;
+  for (auto &entry : iiConsulted)
+    if (isAffected(entry.second, changed))
+      affected.push_back(entry.first);
+
+  for (const IIKey &key : affected) {
+    iiCache.erase(key);
+    iiCacheR.erase(key);
+    iiConsulted.erase(key);
+  }
+}
+
 static const Instruction *getToplevelInst(const CtxInst &ci) {
   const Instruction *inst = ci.getInst();
   for (const CallsiteContext *ctx = ci.getContext().front(); ctx;
@@ -110,7 +133,7 @@ bool CallsiteDepthCombinator::mayFlowCrossIter(
     time_t queryStart, unsigned Timeout) {
   ++numFlowTests;
 
-  LoopAA *top = kill.getTopAA();
+  LoopAA *top = kill.consultTopAA();
   INTROSPECT(errs() << "Test flow from " << write << " to " << read << " {\n");
   //      enterIntrospectionRegion(false);
   Remedies tmpR;
@@ -245,7 +268,7 @@ bool CallsiteDepthCombinator::mayFlowIntraIter(
     const Loop *L, const CtxInst &write, const CtxInst &read, Remedies &R) {
   ++numFlowTests;
 
-  LoopAA *top = kill.getTopAA();
+  LoopAA *top = kill.consultTopAA();
   INTROSPECT(errs() << "Test flow from " << write << " to " << read << " {\n");
   //      enterIntrospectionRegion(false);
   Remedies tmpR;
@@ -361,6 +384,7 @@ bool CallsiteDepthCombinator::doFlowSearchCrossIter(
     SemiLocalFunAA *semi) {
 
   ReverseStoreSearch writes(src, kill, queryStart, Timeout, pure, semi);
+  writes.setLazy(true);
   INTROSPECT(errs() << "LiveOuts {\n";
              // List all live-outs and live-ins.
              // This is really inefficient; a normal
@@ -383,6 +407,7 @@ bool CallsiteDepthCombinator::doFlowSearchCrossIter(
     time_t queryStart, unsigned Timeout, CCPairsRemedsMap *remedNoFlows,
     PureFunAA *pure, SemiLocalFunAA *semi) {
   ForwardLoadSearch reads(dst, kill, queryStart, Timeout, pure, semi);
+  reads.setLazy(true);
   INTROSPECT(errs() << "LiveIns {\n";
 
              for (InstSearch::iterator j = reads.begin(), f = reads.end();
@@ -398,6 +423,83 @@ bool CallsiteDepthCombinator::doFlowSearchCrossIter(
                                queryStart, Timeout, remedNoFlows);
 }
 
+namespace {
+/// A hit of the write- or read-side search.  If the hit
+/// is a deferred callsite, it is expanded at most once,
+/// into the hits of a sub-search.
+struct FlowHit {
+  FlowHit(const CtxInst &c, InstSearch *s)
+      : ci(c), search(s), cost(0), deferred(s->isDeferred(c)),
+        expanded(false) {
+    if (deferred)
+      cost = getCallSite(c.getInst()).getCalledFunction()->getInstructionCount();
+  }
+
+  CtxInst ci;
+  InstSearch *search;
+  unsigned cost;
+  bool deferred, expanded;
+  std::vector<unsigned> children;
+};
+
+typedef std::vector<FlowHit> FlowHits;
+
+/// A pair of hits to test, ordered by the cost of
+/// the expansions it may require; cheapest first.
+struct FlowPair {
+  unsigned cost, seq, write, read;
+
+  bool operator<(const FlowPair &other) const {
+    if (cost != other.cost)
+      return cost > other.cost;
+    return seq > other.seq;
+  }
+};
+
+/// Drives the flow search over the hits of the two searches.
+/// Pairs of plain operations are tested first.  A pair involving
+/// a deferred callsite is first tested as a whole, and the
+/// callsite is expanded only if that cannot disprove the flow.
+struct LazyFlowSearch {
+  FlowHits writes, reads;
+  std::vector<std::unique_ptr<InstSearch>> subsearches;
+  std::priority_queue<FlowPair> pairs;
+  unsigned seq;
+
+  LazyFlowSearch() : seq(0) {}
+
+  static void collect(InstSearch &search, FlowHits &hits,
+                      std::vector<unsigned> &added) {
+    for (InstSearch::iterator i = search.begin(), e = search.end(); i != e;
+         ++i) {
+      added.push_back(hits.size());
+      hits.push_back(FlowHit(*i, &search));
+    }
+  }
+
+  void push(unsigned w, unsigned r) {
+    FlowPair p = {writes[w].cost + reads[r].cost, seq++, w, r};
+    pairs.push(p);
+  }
+
+  const std::vector<unsigned> &expand(FlowHits &hits, unsigned n) {
+    if (!hits[n].expanded) {
+      ++numExpanded;
+      std::unique_ptr<InstSearch> sub = hits[n].search->expand(hits[n].ci);
+
+      std::vector<unsigned> added;
+      collect(*sub, hits, added);
+      subsearches.push_back(std::move(sub));
+
+      // collect() may have reallocated hits
+      hits[n].expanded = true;
+      hits[n].children.swap(added);
+    }
+    return hits[n].children;
+  }
+};
+} // namespace
+
 bool CallsiteDepthCombinator::doFlowSearchCrossIter(
     const Instruction *src, const Instruction *dst, const Loop *L,
     InstSearch &writes, InstSearch &reads, KillFlow &kill, Remedies &R,
@@ -406,62 +508,86 @@ bool CallsiteDepthCombinator::doFlowSearchCrossIter(
   const bool stopAfterFirst = (allFlowsOut == 0);
   bool isFlow = false;
 
-  // Not yet in cache.  Look it up.
-  for (InstSearch::iterator i = writes.begin(), e = writes.end(); i != e; ++i) {
-    const CtxInst &write = *i;
-    //        errs() << "Write: " << write << '\n';
+  LazyFlowSearch search;
+  std::vector<unsigned> ws, rs;
+  LazyFlowSearch::collect(writes, search.writes, ws);
+  LazyFlowSearch::collect(reads, search.reads, rs);
+  for (unsigned w : ws)
+    for (unsigned r : rs)
+      search.push(w, r);
 
-    for (InstSearch::iterator j = reads.begin(), f = reads.end(); j != f; ++j) {
-      const CtxInst &read = *j;
-      //          errs() << "  Read: " << read << '\n';
-
-      if (Timeout > 0 && queryStart > 0) {
-        time_t now;
-        time(&now);
-        if ((now - queryStart) > Timeout) {
-          errs() << "CDC::doFlowSearchCrossIter Timeout\n";
-          return true;
-        }
+  // Not yet in cache.  Look it up.
+  for (unsigned numTests = 0; !search.pairs.empty(); ++numTests) {
+    const FlowPair p = search.pairs.top();
+    search.pairs.pop();
+
+    // Checking the clock is not free; do it now and then.
+    if (Timeout > 0 && queryStart > 0 && (numTests % 64) == 0) {
+      time_t now;
+      time(&now);
+      if ((now - queryStart) > Timeout) {
+        errs() << "CDC::doFlowSearchCrossIter Timeout\n";
+        return true;
       }
+    }
 
-      Remedies tmpR;
-      bool flow = mayFlowCrossIter(kill, src, dst, L, write, read, tmpR,
-                                   queryStart, Timeout);
+    const CtxInst write = search.writes[p.write].ci;
+    const CtxInst read = search.reads[p.read].ci;
+    //        errs() << "Write: " << write << '\n';
+    //          errs() << "  Read: " << read << '\n';
+
+    Remedies tmpR;
+    bool flow = mayFlowCrossIter(kill, src, dst, L, write, read, tmpR,
+                                 queryStart, Timeout);
 
-      if (!flow) {
-        for (auto remed : tmpR)
-          R.insert(remed);
-        if (remedNoFlows) {
-          (*remedNoFlows)[CCPair(write, read)] = tmpR;
-        }
+    if (!flow) {
+      for (auto remed : tmpR)
+        R.insert(remed);
+      if (remedNoFlows) {
+        (*remedNoFlows)[CCPair(write, read)] = tmpR;
       }
+      if (search.writes[p.write].deferred || search.reads[p.read].deferred)
+        ++numDeferredNoFlow;
+    }
 
-      if (!flow)
-        continue;
+    if (!flow)
+      continue;
+
+    // Could not disprove the flow from/to a whole callsite;
+    // expand the cheaper of the deferred callsites and
+    // test its operations instead.
+    const bool expandWrite =
+        search.writes[p.write].deferred &&
+        (!search.reads[p.read].deferred ||
+         search.writes[p.write].cost <= search.reads[p.read].cost);
+
+    if (expandWrite) {
+      const std::vector<unsigned> children =
+          search.expand(search.writes, p.write);
+      for (unsigned w : children)
+        search.push(w, p.read);
+      continue;
+    }
 
-      // TODO
-      // Is there some way that the ReverseStoreSearch
-      // and ForwardLoadSearch can (i) first, return
-      // unexpanded callsites, and (ii) allow this loop
-      // to ask them to expand those callsites, if
-      // necessary, but (iii) Leave those callsites
-      // unexpanded for later iterations of the loop?
-
-      INTROSPECT(errs() << "Can't disprove flow\n"
-                        << "\tfrom: " << write << '\n'
-                        << "\t  to: " << read << '\n');
-      LLVM_DEBUG(errs() << "Can't disprove flow\n"
-                        << "\tfrom: " << write << '\n'
-                        << "\t  to: " << read << '\n');
-
-      if (allFlowsOut)
-        allFlowsOut->push_back(CCPair(write, read));
-      isFlow = true;
-
-      if (stopAfterFirst && isFlow)
-        break;
+    if (search.reads[p.read].deferred) {
+      const std::vector<unsigned> children =
+          search.expand(search.reads, p.read);
+      for (unsigned r : children)
+        search.push(p.write, r);
+      continue;
     }
 
+    INTROSPECT(errs() << "Can't disprove flow\n"
+                      << "\tfrom: " << write << '\n'
+                      << "\t  to: " << read << '\n');
+    LLVM_DEBUG(errs() << "Can't disprove flow\n"
+                      << "\tfrom: " << write << '\n'
+                      << "\t  to: " << read << '\n');
+
+    if (allFlowsOut)
+      allFlowsOut->push_back(CCPair(write, read));
+    isFlow = true;
+
     if (stopAfterFirst && isFlow)
       break;
   }
@@ -543,15 +669,18 @@ LoopAA::ModRefResult CallsiteDepthCombinator::modref(const Instruction *inst1,
     isFlow = iiCache[key];
     for (auto remed : iiCacheR[key])
       isFlowTmpR.insert(remed);
+    noteConsulted(iiConsulted[key]);
   }
 
   else {
+    ConsultedScope consulted;
     time_t queryStart = 0;
     if (AnalysisTimeout > 0)
       time(&queryStart);
     isFlow = iiCache[key] = doFlowSearchCrossIter(
         src, dst, L, *killflow, isFlowTmpR, 0, queryStart, AnalysisTimeout);
     iiCacheR[key] = isFlowTmpR;
+    iiConsulted[key] = consulted.getLowest();
     queryStart = 0;
   }
 
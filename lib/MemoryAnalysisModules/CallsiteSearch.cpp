@@ -1,3 +1,6 @@
+#define DEBUG_TYPE "callsite-search"
+
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/IntrinsicInst.h"
@@ -13,6 +16,10 @@
 namespace liberty {
 using namespace llvm;
 
+STATISTIC(numSummaries, "Num callee summaries computed");
+STATISTIC(numSummaryHits, "Num callee summaries reused");
+STATISTIC(numOpsKilledLocally, "Num callee operations killed within callee");
+
 #define INCREF(x)                                                              \
   do {                                                                         \
     if (x)                                                                     \
@@ -95,78 +102,116 @@ bool Context::kills(KillFlow &kill, const Value *ptr,
                PointerIsLocalToContext, queryStart, Timeout);
 }
 
-bool Context::kills(KillFlow &kill, const Value *ptr, const Value *obj,
-                    const Instruction *locInCtx, const CallsiteContext *ctx,
-                    bool Before, bool PointerIsLocalToContext,
-                    time_t queryStart, unsigned Timeout) const {
-  // No more context to kill stuff
-  if (ctx == 0)
-    return false;
+static bool timedOut(time_t queryStart, unsigned Timeout) {
+  if (Timeout > 0 && queryStart > 0) {
+    time_t now;
+    time(&now);
+    if ((now - queryStart) > Timeout) {
+      errs() << "Context::kills Timeout\n";
+      return true;
+    }
+  }
+  return false;
+}
 
+/// Determine if (ptr), whose underlying object is (obj), is killed
+/// within (fcn) (Before) or (!Before) the location (loc).
+static bool killedWithin(KillFlow &kill, const Value *ptr, const Value *obj,
+                         const Instruction *loc, const Function *fcn,
+                         bool Before, time_t queryStart, unsigned Timeout) {
   // If this ptr is a context-private allocation unit, it cannot escape.
   if (const AllocaInst *alloca = dyn_cast<AllocaInst>(ptr))
-    if (alloca->getParent()->getParent() == ctx->getFunction()) {
-      INTROSPECT(errs() << "Context::kills(" << *ptr << ") is an alloca in ";
-                 ctx->print(errs()); errs() << '\n';);
+    if (alloca->getParent()->getParent() == fcn) {
+      INTROSPECT(errs() << "Context::kills(" << *ptr << ") is an alloca in "
+                        << fcn->getName() << '\n');
       return true;
     }
 
   // If this aggregate is a context-private allocation unit, it cannot escape.
-  const Module *M = locInCtx->getParent()->getParent()->getParent();
-  const DataLayout &DL = M->getDataLayout();
-  obj = GetUnderlyingObject(obj, DL, 0);
   if (const AllocaInst *alloca = dyn_cast<AllocaInst>(obj))
-    if (alloca->getParent()->getParent() == ctx->getFunction()) {
+    if (alloca->getParent()->getParent() == fcn) {
       INTROSPECT(errs() << "context::kills(" << *ptr << ") underlying object "
-                        << *obj << " is an alloca in ";
-                 ctx->print(errs()); errs() << '\n';);
+                        << *obj << " is an alloca in " << fcn->getName()
+                        << '\n');
       return true;
     }
 
   // Before recurring, check for timeout.
-  if (Timeout > 0 && queryStart > 0) {
-    time_t now;
-    time(&now);
-    if ((now - queryStart) > Timeout) {
-      errs() << "Context::kills Timeout\n";
-      return false;
-    }
-  }
+  if (timedOut(queryStart, Timeout))
+    return false;
 
   // Determine if there are stores which kill flow to/from this pointer
   if (Before) {
-    if (kill.pointerKilledBefore(0, ptr, locInCtx, false, queryStart,
-                                 Timeout)) {
-      INTROSPECT(errs() << "context::kills(" << *ptr
-                        << ") is killed before in ";
-                 ctx->print(errs()); errs() << '\n';);
+    if (kill.pointerKilledBefore(0, ptr, loc, false, queryStart, Timeout)) {
+      INTROSPECT(errs() << "context::kills(" << *ptr << ") is killed before in "
+                        << fcn->getName() << '\n');
       return true;
     }
 
-    if (kill.aggregateKilledBefore(0, obj, locInCtx, queryStart, Timeout)) {
+    if (kill.aggregateKilledBefore(0, obj, loc, queryStart, Timeout)) {
       INTROSPECT(errs() << "context::kills(" << *ptr << ") underlying object "
-                        << *obj << " is killed before in ";
-                 ctx->print(errs()); errs() << '\n';);
+                        << *obj << " is killed before in " << fcn->getName()
+                        << '\n');
       return true;
     }
   }
 
   else // if after
   {
-    if (kill.pointerKilledAfter(0, ptr, locInCtx, false, queryStart, Timeout)) {
-      INTROSPECT(errs() << "context::kills(" << *ptr << ") is killed after in ";
-                 ctx->print(errs()); errs() << '\n';);
+    if (kill.pointerKilledAfter(0, ptr, loc, false, queryStart, Timeout)) {
+      INTROSPECT(errs() << "context::kills(" << *ptr << ") is killed after in "
+                        << fcn->getName() << '\n');
       return true;
     }
 
-    if (kill.aggregateKilledAfter(0, obj, locInCtx, queryStart, Timeout)) {
+    if (kill.aggregateKilledAfter(0, obj, loc, queryStart, Timeout)) {
       INTROSPECT(errs() << "context::kills(" << *ptr << ") underlying object "
-                        << *obj << " is killed after in ";
-                 ctx->print(errs()); errs() << '\n';);
+                        << *obj << " is killed after in " << fcn->getName()
+                        << '\n');
       return true;
     }
   }
 
+  return false;
+}
+
+bool Context::kills(KillFlow &kill, const Value *ptr, const Value *obj,
+                    const Instruction *locInCtx, const CallsiteContext *ctx,
+                    bool Before, bool PointerIsLocalToContext,
+                    time_t queryStart, unsigned Timeout) const {
+  // No more context to kill stuff
+  if (ctx == 0)
+    return false;
+
+  const Module *M = locInCtx->getParent()->getParent()->getParent();
+  const DataLayout &DL = M->getDataLayout();
+  obj = GetUnderlyingObject(obj, DL, 0);
+
+  if (killedWithin(kill, ptr, obj, locInCtx, ctx->getFunction(), Before,
+                   queryStart, Timeout))
+    return true;
+
+  return killsOutside(kill, ptr, obj, ctx, Before, PointerIsLocalToContext,
+                      queryStart, Timeout);
+}
+
+bool Context::killsOutsideCallee(KillFlow &kill, const Value *ptr,
+                                 bool Before, time_t queryStart,
+                                 unsigned Timeout) const {
+  const CallsiteContext *ctx = front();
+  if (ctx == 0)
+    return false;
+
+  const DataLayout &DL =
+      ctx->getLocationWithinParent()->getModule()->getDataLayout();
+  const Value *obj = GetUnderlyingObject(ptr, DL, 0);
+  return killsOutside(kill, ptr, obj, ctx, Before, true, queryStart, Timeout);
+}
+
+bool Context::killsOutside(KillFlow &kill, const Value *ptr, const Value *obj,
+                           const CallsiteContext *ctx, bool Before,
+                           bool PointerIsLocalToContext, time_t queryStart,
+                           unsigned Timeout) const {
   // Possibly replace formal parameter with actual parameter.
   if (PointerIsLocalToContext) {
     if (const Argument *arg = dyn_cast<Argument>(ptr))
@@ -178,14 +223,8 @@ bool Context::kills(KillFlow &kill, const Value *ptr, const Value *obj,
   }
 
   // Before recurring, check for timeout.
-  if (Timeout > 0 && queryStart > 0) {
-    time_t now;
-    time(&now);
-    if ((now - queryStart) > Timeout) {
-      errs() << "Context::kills Timeout\n";
-      return false;
-    }
-  }
+  if (timedOut(queryStart, Timeout))
+    return false;
 
   return kills(kill, ptr, obj, ctx->getLocationWithinParent(), ctx->getParent(),
                Before, PointerIsLocalToContext, queryStart, Timeout);
@@ -391,11 +430,32 @@ raw_ostream &operator<<(raw_ostream &out, const CtxInst &ci) {
 
 InstSearch::InstSearch(bool read, bool write, time_t start, unsigned t_o,
                        PureFunAA *p, SemiLocalFunAA *s)
-    : fringe(), visited(), hits(), queryStart(start), Timeout(t_o), Reads(read),
-      Writes(write), pure(p), semi(s) {
+    : fringe(), visited(new Visited), hits(), queryStart(start), Timeout(t_o),
+      Reads(read), Writes(write), pure(p), semi(s), lazy(false) {
   assert(Reads || Writes);
 }
 
+InstSearch::InstSearch(const InstSearch *parent)
+    : fringe(), visited(parent->visited), hits(),
+      queryStart(parent->queryStart), Timeout(parent->Timeout),
+      Reads(parent->Reads), Writes(parent->Writes), pure(parent->pure),
+      semi(parent->semi), lazy(true) {}
+
+bool InstSearch::isDeferred(const CtxInst &hit) const {
+  if (!lazy || !hit.getContext().front())
+    return false;
+
+  CallSite cs = getCallSite(hit.getInst());
+  if (!cs.getInstruction())
+    return false;
+
+  const Function *callee = cs.getCalledFunction();
+  if (!callee || callee->isDeclaration())
+    return false;
+
+  return !(pure && pure->isLocal(callee));
+}
+
 InstSearch::iterator InstSearch::begin() { return InstSearchIterator(this); }
 InstSearch::iterator InstSearch::end() { return InstSearchIterator(true); }
 
@@ -482,6 +542,77 @@ bool InstSearch::mayWriteToMemory(const Instruction *inst) const {
   return true;
 }
 
+bool InstSearch::classify(const Instruction *inst,
+                          CalleeSummary::Kind &kind) const {
+  CallSite cs = getCallSite(inst);
+  if (!cs.getInstruction()) {
+    // Any non-callsite which may read or write
+    kind = CalleeSummary::MemOp;
+    return mayReadWrite(inst);
+  }
+
+  const Function *callee = cs.getCalledFunction();
+
+  // indirect calls
+  if (!callee) {
+    kind = CalleeSummary::OpaqueCall;
+    return true;
+  }
+
+  // calls to external functions
+  if (callee->isDeclaration()) {
+    if (!mayReadWrite(inst))
+      return false;
+
+    if (pure && pure->isLocal(callee))
+      kind = CalleeSummary::LocalCall;
+    else if (pure && semi && semi->isSemiLocal(callee, *pure))
+      kind = CalleeSummary::SemiLocalCall;
+    else
+      kind = CalleeSummary::OpaqueCall;
+    return true;
+  }
+
+  // if footprint based on arguments. no need to go inside the function
+  // exclude semis that have hidden state
+  if (pure && pure->isLocal(callee)) {
+    kind = CalleeSummary::LocalCall;
+    return true;
+  }
+
+  // Direct calls to defined functions
+  kind = CalleeSummary::NestedCall;
+  return true;
+}
+
+const CalleeSummary &InstSearch::getSummary(KillFlow &kill,
+                                            const Function *fcn,
+                                            bool forward) const {
+  // Everything which changes the answers of classify() or the
+  // order of the walk.
+  const unsigned flags = (Reads ? 1 : 0) | (Writes ? 2 : 0) |
+                         (forward ? 4 : 0) | (pure ? 8 : 0) | (semi ? 16 : 0);
+
+  CalleeSummaries::Key key(fcn, flags);
+  std::map<CalleeSummaries::Key, CalleeSummary> &summaries =
+      kill.getCalleeSummaries().summaries;
+
+  std::map<CalleeSummaries::Key, CalleeSummary>::iterator i =
+      summaries.find(key);
+  if (i != summaries.end()) {
+    ++numSummaryHits;
+    kill.noteCacheHit();
+    return i->second;
+  }
+
+  ++numSummaries;
+  CalleeSummary &summary = summaries[key];
+  summarize(fcn, summary);
+  kill.noteCacheFilled();
+  numOpsKilledLocally += summary.numKilledLocally;
+  return summary;
+}
+
 const CtxInst &InstSearch::getHit(unsigned n) const { return hits[n]; }
 unsigned InstSearch::getNumHits() const { return hits.size(); }
 
@@ -517,107 +648,116 @@ ForwardSearch::ForwardSearch(const Instruction *start, KillFlow &k, bool read,
   isGoalState(s0);
 }
 
+ForwardSearch::ForwardSearch(const ForwardSearch *parent, const CtxInst &call)
+    : InstSearch(parent), kill(parent->kill) {
+  enterCallee(call);
+}
+
 void ForwardSearch::tryGetMoreHits() { searchSuccessors(); }
 
-bool ForwardSearch::goal(const CtxInst &n) {
-  if (!n.isLiveIn(kill, queryStart, Timeout))
-    return false;
-  hits.push_back(n);
-  return true;
+std::unique_ptr<InstSearch>
+ForwardSearch::expand(const CtxInst &deferred) const {
+  assert(isDeferred(deferred) && "Expanding a hit which was not deferred");
+  return std::unique_ptr<InstSearch>(new ForwardSearch(this, deferred));
 }
 
-bool ForwardSearch::isGoalState(const CtxInst &n) {
-  const Instruction *inst = n.getInst();
-  CallSite cs = getCallSite(inst);
-  if (cs.getInstruction()) {
-    const Function *callee = cs.getCalledFunction();
+void ForwardSearch::enterCallee(const CtxInst &call) {
+  CallSite cs = getCallSite(call.getInst());
+  const Function *callee = cs.getCalledFunction();
 
-    // indirect calls
-    if (!callee)
-      return goal(n);
+  // Visit the operations of the callee, in order.
+  const CalleeSummary &summary = getSummary(kill, callee, true);
+  Context c2 = call.getContext().getSubContext(cs);
+  for (unsigned i = summary.ops.size(); i > 0; --i)
+    fringe.push_back(std::make_pair(summary.ops[i - 1], c2));
+}
 
-    // calls to external functions
-    if (callee->isDeclaration()) {
-      if (mayReadWrite(inst))
-        return goal(n);
-      else
-        return false;
-    }
+bool ForwardSearch::isGoalState(const CtxInst &n) {
+  CalleeSummary::Op op;
+  op.inst = n.getInst();
+  if (!classify(op.inst, op.kind))
+    return false;
 
-    // if footprint based on arguments. no need to go inside the function
-    // exclude semis that have hidden state
-    else if (pure && (pure->isLocal(callee)))
-    // ||
-    //                  (semi && semi->isSemiLocal(callee, *pure)))) {
-    {
-      return goal(n);
-    }
+  return visit(op, n.getContext());
+}
 
-    // Direct calls to defined functions
-    else {
-      // Avoid infinite search
-      if (visited.count(inst))
+bool ForwardSearch::visit(const CalleeSummary::Op &op, const Context &ctx) {
+  switch (op.kind) {
+  case CalleeSummary::MemOp:
+    // The summary already checked for kills within the callee.
+    if (const LoadInst *load = dyn_cast<LoadInst>(op.inst))
+      if (ctx.killsOutsideCallee(kill, load->getPointerOperand(), true,
+                                 queryStart, Timeout))
         return false;
-      visited.insert(inst);
+    break;
 
-      // Find the entry of the callee
-      Context c2 = n.getContext().getSubContext(cs);
-      CtxInst csucc(&callee->front().front(), c2);
+  case CalleeSummary::NestedCall:
+    // Avoid infinite search
+    if (!visited->insert(op.inst).second)
+      return false;
 
-      fringe.push_back(csucc);
+    // Lazy searches report nested callsites unexpanded
+    if (!lazy || !ctx.front()) {
+      enterCallee(CtxInst(op.inst, ctx));
       return false;
     }
-  }
+    break;
 
-  // Any non-callsite which may read or write
-  else if (mayReadWrite(inst))
-    return goal(n);
+  default:
+    break;
+  }
 
-  return false;
+  hits.push_back(CtxInst(op.inst, ctx));
+  return true;
 }
 
 void ForwardSearch::searchSuccessors() {
-  // Search locally for the next goal nodes
+  // Search for the next goal nodes
   while (!fringe.empty()) {
-    const CtxInst n = fringe.back();
+    const Fringe::value_type n = fringe.back();
     fringe.pop_back();
 
-    // Check for goal state
-    const bool foundAtLeastOneMore = isGoalState(n);
-
-    expandSuccessors(n);
-
-    if (foundAtLeastOneMore)
+    if (visit(n.first, n.second))
       break;
   }
 }
 
-void ForwardSearch::expandSuccessors(const CtxInst &ci) {
-  // Either inst is the last in its basic block, or not.
-  const Instruction *inst = ci.getInst();
-  const BasicBlock *bb = inst->getParent();
-  if (inst == bb->getTerminator()) {
+void ForwardSearch::summarize(const Function *fcn,
+                              CalleeSummary &summary) const {
+  const DominatorTree *dt = kill.getDT(fcn);
+  const DataLayout &DL = fcn->getParent()->getDataLayout();
+
+  // Visit instructions in dominator-order
+  std::vector<const Instruction *> stack(1, &fcn->front().front());
+  while (!stack.empty()) {
+    const Instruction *inst = stack.back();
+    stack.pop_back();
+
+    CalleeSummary::Op op;
+    op.inst = inst;
+    if (classify(inst, op.kind)) {
+      const LoadInst *load = dyn_cast<LoadInst>(inst);
+      if (op.kind == CalleeSummary::MemOp && load &&
+          killedWithin(kill, load->getPointerOperand(),
+                       GetUnderlyingObject(load->getPointerOperand(), DL, 0),
+                       load, fcn, true, queryStart, Timeout))
+        ++summary.numKilledLocally;
+      else
+        summary.ops.push_back(op);
+    }
+
+    // Either inst is the last in its basic block, or not.
+    const BasicBlock *bb = inst->getParent();
+    if (inst != bb->getTerminator()) {
+      stack.push_back(inst->getNextNode());
+      continue;
+    }
+
     // Last in block.
     // Find later blocks using the dominator tree.
-    const DominatorTree *dt = kill.getDT(bb->getParent());
     DomTreeNode *nn = dt->getNode(const_cast<BasicBlock *>(bb));
-
-    expandSuccessors(nn, ci.getContext());
-  }
-
-  else {
-    // Not last in block.
-    const Instruction *succ = inst->getNextNode();
-    CtxInst csucc(succ, ci.getContext());
-    fringe.push_back(csucc);
-  }
-}
-
-void ForwardSearch::expandSuccessors(DomTreeNode *nn, const Context &ctx) {
-  for (DomTreeNode::iterator i = nn->begin(), e = nn->end(); i != e; ++i) {
-    const Instruction *succ = &(*i)->getBlock()->front();
-    CtxInst csucc(succ, ctx);
-    fringe.push_back(csucc);
+    for (DomTreeNode::iterator i = nn->begin(), e = nn->end(); i != e; ++i)
+      stack.push_back(&(*i)->getBlock()->front());
   }
 }
 
@@ -630,118 +770,87 @@ ReverseSearch::ReverseSearch(const Instruction *start, KillFlow &k, bool read,
   isGoalState(s0);
 }
 
+ReverseSearch::ReverseSearch(const ReverseSearch *parent, const CtxInst &call)
+    : InstSearch(parent), kill(parent->kill) {
+  enterCallee(call);
+}
+
 void ReverseSearch::tryGetMoreHits() { searchPredecessors(); }
 
-bool ReverseSearch::goal(const CtxInst &n) {
-  if (!n.isLiveOut(kill, queryStart, Timeout))
-    return false;
-  hits.push_back(n);
-  return true;
+std::unique_ptr<InstSearch>
+ReverseSearch::expand(const CtxInst &deferred) const {
+  assert(isDeferred(deferred) && "Expanding a hit which was not deferred");
+  return std::unique_ptr<InstSearch>(new ReverseSearch(this, deferred));
 }
 
-bool ReverseSearch::isGoalState(const CtxInst &n) {
-  const Instruction *inst = n.getInst();
-  CallSite cs = getCallSite(inst);
-  if (cs.getInstruction()) {
-    const Function *callee = cs.getCalledFunction();
+void ReverseSearch::enterCallee(const CtxInst &call) {
+  CallSite cs = getCallSite(call.getInst());
+  const Function *callee = cs.getCalledFunction();
 
-    // indirect calls
-    if (!callee)
-      return goal(n);
+  // Visit the operations of the callee, in reverse order.
+  const CalleeSummary &summary = getSummary(kill, callee, false);
+  const Context c2 = call.getContext().getSubContext(cs);
+  for (unsigned i = summary.ops.size(); i > 0; --i)
+    fringe.push_back(std::make_pair(summary.ops[i - 1], c2));
+}
 
-    // calls to external functions
-    if (callee->isDeclaration()) {
-      if (mayReadWrite(inst))
-        return goal(n);
-      else
-        return false;
-    }
+bool ReverseSearch::isGoalState(const CtxInst &n) {
+  CalleeSummary::Op op;
+  op.inst = n.getInst();
+  if (!classify(op.inst, op.kind))
+    return false;
 
-    // if footprint based on arguments. no need to go inside the function
-    // exclude semis that have hidden state
-    else if (pure && (pure->isLocal(callee)))
-    // ||
-    //                  (semi && semi->isSemiLocal(callee, *pure)))) {
-    {
-      return goal(n);
-    }
+  return visit(op, n.getContext());
+}
 
-    // Direct calls to defined functions
-    else {
-      // Avoid infinite search
-      if (visited.count(inst))
+bool ReverseSearch::visit(const CalleeSummary::Op &op, const Context &ctx) {
+  switch (op.kind) {
+  case CalleeSummary::MemOp:
+    // The summary already checked for kills within the callee.
+    if (const StoreInst *store = dyn_cast<StoreInst>(op.inst))
+      if (ctx.killsOutsideCallee(kill, store->getPointerOperand(), false,
+                                 queryStart, Timeout))
         return false;
-      visited.insert(inst);
+    break;
 
-      // Find the exits of the callee
-      const PostDominatorTree *pdt = kill.getPDT(callee);
-      const Context c2 = n.getContext().getSubContext(cs);
-      expandRoots(pdt, c2);
+  case CalleeSummary::NestedCall:
+    // Avoid infinite search
+    if (!visited->insert(op.inst).second)
+      return false;
 
+    // Lazy searches report nested callsites unexpanded
+    if (!lazy || !ctx.front()) {
+      enterCallee(CtxInst(op.inst, ctx));
       return false;
     }
-  }
+    break;
 
-  // Any non-callsite which may read or write
-  else if (mayReadWrite(inst))
-    return goal(n);
+  default:
+    break;
+  }
 
-  return false;
+  hits.push_back(CtxInst(op.inst, ctx));
+  return true;
 }
 
 void ReverseSearch::searchPredecessors() {
-  // Search locally for the next goal nodes
+  // Search for the next goal nodes
   while (!fringe.empty()) {
-    const CtxInst n = fringe.back();
+    const Fringe::value_type n = fringe.back();
     fringe.pop_back();
 
-    // Check for goal state
-    const bool foundAtLeastOneMore = isGoalState(n);
-
-    expandPredecessors(n);
-
-    if (foundAtLeastOneMore)
+    if (visit(n.first, n.second))
       break;
   }
 }
 
-void ReverseSearch::expandPredecessors(const CtxInst &ci) {
-  // Either inst is the first in its basic block, or not.
-  const Instruction *inst = ci.getInst();
-  const BasicBlock *bb = inst->getParent();
-  if (inst == &bb->front()) {
-    // First in block.
-    // Find earlier blocks using the post-dominator tree.
-    const PostDominatorTree *pdt = kill.getPDT(bb->getParent());
-    DomTreeNode *nn = pdt->getNode(const_cast<BasicBlock *>(bb));
-
-    expandPredecessors(nn, ci.getContext());
-  }
-
-  else {
-    // Not first in block.
-    const Instruction *pred = inst->getPrevNode();
-    // ilist_nextprev_traits<Instruction>::getPrev(inst);
-    CtxInst cpred(pred, ci.getContext());
-    fringe.push_back(cpred);
-  }
-}
+void ReverseSearch::summarize(const Function *fcn,
+                              CalleeSummary &summary) const {
+  const PostDominatorTree *pdt = kill.getPDT(fcn);
+  const DataLayout &DL = fcn->getParent()->getDataLayout();
 
-void ReverseSearch::expandPredecessors(DomTreeNode *nn, const Context &ctx) {
-  for (DomTreeNode::iterator i = nn->begin(), e = nn->end(); i != e; ++i) {
-    const BasicBlock *bbpred = (*i)->getBlock();
-    const Instruction *pred = bbpred->getTerminator();
-
-    if (isa<UnreachableInst>(pred))
-      continue;
-
-    CtxInst cpred(pred, ctx);
-    fringe.push_back(cpred);
-  }
-}
-
-void ReverseSearch::expandRoots(const PostDominatorTree *pdt,
-                                const Context &ctx) {
+  // Visit instructions in post-dominator-order.
+  //
   // When a function has a unique exit,
   // llvm's PDT uses that as a root.
   // Otherwise, it creates a magical
@@ -755,19 +864,53 @@ void ReverseSearch::expandRoots(const PostDominatorTree *pdt,
   // post-dominated by the roots, and thus
   // we would miss some basic blocks if we
   // start from those.
+  std::vector<const Instruction *> stack;
+  std::vector<DomTreeNode *> blocks;
   DomTreeNode *root = (DomTreeNode *)pdt->getRootNode();
-  if (root->getBlock()) {
-    const BasicBlock *bbpred = root->getBlock();
-    const Instruction *pred = bbpred->getTerminator();
-    if (isa<UnreachableInst>(pred))
-      return;
-
-    CtxInst cpred(pred, ctx);
-    fringe.push_back(cpred);
-    return;
-  }
+  if (root->getBlock())
+    blocks.push_back(root);
+  else
+    blocks.insert(blocks.end(), root->begin(), root->end());
+
+  for (;;) {
+    // Enter blocks at their terminators.
+    for (DomTreeNode *nn : blocks) {
+      const Instruction *term = nn->getBlock()->getTerminator();
+      if (!isa<UnreachableInst>(term))
+        stack.push_back(term);
+    }
+    blocks.clear();
+
+    if (stack.empty())
+      break;
 
-  expandPredecessors(root, ctx);
+    const Instruction *inst = stack.back();
+    stack.pop_back();
+
+    CalleeSummary::Op op;
+    op.inst = inst;
+    if (classify(inst, op.kind)) {
+      const StoreInst *store = dyn_cast<StoreInst>(inst);
+      if (op.kind == CalleeSummary::MemOp && store &&
+          killedWithin(kill, store->getPointerOperand(),
+                       GetUnderlyingObject(store->getPointerOperand(), DL, 0),
+                       store, fcn, false, queryStart, Timeout))
+        ++summary.numKilledLocally;
+      else
+        summary.ops.push_back(op);
+    }
+
+    // Either inst is the first in its basic block, or not.
+    const BasicBlock *bb = inst->getParent();
+    if (inst != &bb->front()) {
+      stack.push_back(inst->getPrevNode());
+      continue;
+    }
+
+    // First in block.
+    // Find earlier blocks using the post-dominator tree.
+    DomTreeNode *nn = pdt->getNode(const_cast<BasicBlock *>(bb));
+    blocks.insert(blocks.end(), nn->begin(), nn->end());
+  }
 }
 } // namespace liberty
-
@@ -15,7 +15,7 @@
 #include "scaf/MemoryAnalysisModules/FindSource.h"
 #include "scaf/MemoryAnalysisModules/TypeSanity.h"
 #include "scaf/Utilities/CallSiteFactory.h"
-#include "scaf/Utilities/CaptureUtil.h"
+#include "scaf/Utilities/UnderlyingObjectsCache.h"
 
 #include "scaf/MemoryAnalysisModules/NoEscapeFieldsAA.h"
 
@@ -28,6 +28,7 @@ class DisjointFieldsAA : public ModulePass, public liberty::ClassicLoopAA {
 
   const liberty::TypeSanityAnalysis *TAA;
   const liberty::NonCapturedFieldsAnalysis *NEFAA;
+  liberty::UnderlyingObjectsCache *uoc;
 
   DenseSet<StructType *> jointTypes;
 
@@ -48,6 +49,8 @@ public:
 
     NEFAA = &getAnalysis<liberty::NonCapturedFieldsAnalysis>();
 
+    uoc = &getAnalysis<liberty::UnderlyingObjectsCache>();
+
     typedef Module::iterator ModuleIt;
     for (ModuleIt fun = M.begin(); fun != M.end(); ++fun) {
       if (!fun->isDeclaration())
@@ -194,8 +197,8 @@ public:
       jointTypes.insert(structType);
   }
 
-  static bool isJoint(const GetElementPtrInst *gep, StructType *structType,
-                      const TargetLibraryInfo &tli) {
+  bool isJoint(const GetElementPtrInst *gep, StructType *structType,
+               const TargetLibraryInfo &tli) const {
 
     // If we cannot find all the defs of the pointer, mark the structure joint.
     StoreSet defs;
@@ -213,8 +216,8 @@ public:
         return true;
 
       // If all the captures for the source are not known, mark the type joint.
-      liberty::CaptureSet captures;
-      if (!liberty::findAllCaptures(src, &captures)) {
+      liberty::UnderlyingObjectsCache::Objects captures;
+      if (!uoc->findAllCaptures(src, captures)) {
         LLVM_DEBUG(errs() << structType->getName() << " incomplete capture!\n");
         return true;
       }
@@ -225,7 +228,7 @@ public:
 
         DenseSet<Type *> capturingTypes;
 
-        typedef liberty::CaptureSet::iterator CapSetIt;
+        typedef liberty::UnderlyingObjectsCache::Objects::iterator CapSetIt;
         for (CapSetIt cap = captures.begin(); cap != captures.end(); ++cap) {
 
           const StoreInst *store = dyn_cast<StoreInst>(*cap);
@@ -376,6 +379,7 @@ public:
   void getAnalysisUsage(AnalysisUsage &AU) const {
     AU.addRequired<liberty::TypeSanityAnalysis>();
     AU.addRequired<liberty::NonCapturedFieldsAnalysis>();
+    AU.addRequired<liberty::UnderlyingObjectsCache>();
     LoopAA::getAnalysisUsage(AU);
     AU.setPreservesAll();
   }
@@ -5,8 +5,8 @@
 #include "llvm/IR/Module.h"
 #include "llvm/Pass.h"
 
-#include "scaf/Utilities/CaptureUtil.h"
 #include "scaf/Utilities/FindAllTransUses.h"
+#include "scaf/Utilities/UnderlyingObjectsCache.h"
 
 #include "scaf/MemoryAnalysisModules/TypeSanity.h"
 
@@ -19,6 +19,7 @@ class FieldMallocAA : public ModulePass, public liberty::ClassicLoopAA {
   typedef ValueSet::iterator ValueSetIt;
 
   liberty::TypeSanityAnalysis *TAA;
+  liberty::UnderlyingObjectsCache *uoc;
 
   DenseSet<Type *> badFieldTypes;
 
@@ -40,7 +41,7 @@ class FieldMallocAA : public ModulePass, public liberty::ClassicLoopAA {
     return fun->returnDoesNotAlias();
   }
 
-  static bool isUniqueAllocSrc(const StoreInst *store) {
+  bool isUniqueAllocSrc(const StoreInst *store) const {
 
     const Module *M = store->getParent()->getParent()->getParent();
     const DataLayout &td = M->getDataLayout();
@@ -48,13 +49,13 @@ class FieldMallocAA : public ModulePass, public liberty::ClassicLoopAA {
     if (!isAllocSrc(O))
       return false;
 
-    liberty::CaptureSet captureSet;
-    liberty::findAllCaptures(O, &captureSet);
+    liberty::UnderlyingObjectsCache::Objects captureSet;
+    uoc->findAllCaptures(O, captureSet);
 
     return captureSet.size() == 1;
   }
 
-  static bool isSafelyUsed(ValueSet &uses) {
+  bool isSafelyUsed(ValueSet &uses) const {
     const ValueSetIt B = uses.begin();
     const ValueSetIt E = uses.end();
     for (ValueSetIt use = B; use != E; ++use) {
@@ -75,6 +76,7 @@ public:
     InitializeLoopAA(this, *DL);
 
     TAA = &getAnalysis<liberty::TypeSanityAnalysis>();
+    uoc = &getAnalysis<liberty::UnderlyingObjectsCache>();
 
     typedef Module::iterator ModIt;
     const ModIt B = M.begin();
@@ -175,6 +177,7 @@ public:
   void getAnalysisUsage(AnalysisUsage &AU) const {
     LoopAA::getAnalysisUsage(AU);
     AU.addRequired<liberty::TypeSanityAnalysis>();
+    AU.addRequired<liberty::UnderlyingObjectsCache>();
     AU.setPreservesAll(); // Does not transform code
   }
 
@@ -16,7 +16,7 @@
 #include "scaf/MemoryAnalysisModules/ClassicLoopAA.h"
 #include "scaf/MemoryAnalysisModules/FindSource.h"
 #include "scaf/MemoryAnalysisModules/LoopAA.h"
-#include "scaf/Utilities/CaptureUtil.h"
+#include "scaf/Utilities/UnderlyingObjectsCache.h"
 
 using namespace llvm;
 using namespace arcana::noelle;
@@ -39,31 +39,29 @@ private:
 
   const DataLayout *DL;
   const TargetLibraryInfo *tli;
+  liberty::UnderlyingObjectsCache *uoc;
 
-  static bool isExclusive(const GlobalValue *global, const ValueSet &nonMalloc,
-                          const CISet &sources) {
+  bool isExclusive(const GlobalValue *global, const ValueSet &nonMalloc,
+                   const CISet &sources) const {
 
     if (nonMalloc.count(global))
       return false;
 
-    if (liberty::findAllCaptures(global))
+    if (uoc->isCaptured(global))
       return false;
 
-    liberty::CaptureSet captureSet;
-
     for (CISetIt src = sources.begin(); src != sources.end(); ++src) {
 
-      liberty::findAllCaptures(*src, &captureSet);
+      liberty::UnderlyingObjectsCache::Objects captureSet;
+      uoc->findAllCaptures(*src, captureSet);
       assert(captureSet.size() != 0 && "How can a source not be captured!?");
       if (captureSet.size() > 1) {
         return false;
       }
-
-      captureSet.clear();
     }
 
     for (UseIt use = global->user_begin(); use != global->user_end(); ++use) {
-      if (isa<LoadInst>(*use) && liberty::findAllCaptures(*use)) {
+      if (isa<LoadInst>(*use) && uoc->isCaptured(*use)) {
         return false;
       }
     }
@@ -135,6 +133,7 @@ public:
     InitializeLoopAA(this, *DL);
 
     tli = &getAnalysis<TargetLibraryInfoWrapperPass>().getTLI();
+    uoc = &getAnalysis<liberty::UnderlyingObjectsCache>();
 
     nonMalloc.clear();
     nonMallocSrcs.clear();
@@ -336,6 +335,7 @@ public:
 
   void getAnalysisUsage(AnalysisUsage &AU) const {
     LoopAA::getAnalysisUsage(AU);
+    AU.addRequired<liberty::UnderlyingObjectsCache>();
     AU.setPreservesAll(); // Does not transform code
   }
 
@@ -7,6 +7,7 @@
 #include "llvm/Support/Debug.h"
 
 #include "scaf/MemoryAnalysisModules/AnalysisTimeout.h"
+#include "scaf/MemoryAnalysisModules/CallsiteSearch.h"
 #include "scaf/MemoryAnalysisModules/Introspection.h"
 #include "scaf/MemoryAnalysisModules/KillFlow.h"
 #include "scaf/Utilities/CallSiteFactory.h"
@@ -78,7 +79,7 @@ bool KillFlow::mustAlias(const Value *storeptr, const Value *loadptr) {
   if (storeptr == loadptr && isa<GlobalValue>(storeptr))
     return true;
 
-  LoopAA *top = getEffectiveTopAA();
+  LoopAA *top = consultEffectiveTopAA();
   ++numSubQueries;
 
   // for now no spec provides must alias answer, no the remedies argument does
@@ -91,6 +92,13 @@ bool KillFlow::mustAlias(const Value *storeptr, const Value *loadptr) {
 /// Non-topping case of pointer comparison.
 bool KillFlow::mustAliasFast(const Value *storeptr, const Value *loadptr,
                              const DataLayout &DL) {
+  if (uoc) {
+    UnderlyingObjectsCache::Objects a = uoc->getUnderlyingObjects(storeptr, DL);
+    if (a.size() != 1)
+      return false;
+    return a == uoc->getUnderlyingObjects(loadptr, DL);
+  }
+
   UO a, b;
   GetUnderlyingObjects(storeptr, a, DL);
   if (a.size() != 1)
@@ -138,6 +146,7 @@ bool KillFlow::instMustKill(const Instruction *inst, const Value *ptr,
     FcnPtrPair key(f, ptr);
     if (fcnKills.count(key)) {
       ++numFcnSummaryHits;
+      noteCacheHit();
       return fcnKills[key];
     }
 
@@ -155,6 +164,7 @@ bool KillFlow::instMustKill(const Instruction *inst, const Value *ptr,
       if (blockMustKill(bb, ptr, 0, 0, queryStart, Timeout, L)) {
         // Memoize for later.
         fcnKills[key] = true;
+        noteCacheFilled();
 
         LLVM_DEBUG(errs() << "\t(in block " << *bb << ")\n");
         //          INTROSPECT(errs() << "\tYes\n");
@@ -163,6 +173,7 @@ bool KillFlow::instMustKill(const Instruction *inst, const Value *ptr,
     }
 
     fcnKills[key] = false;
+    noteCacheFilled();
     //      INTROSPECT(errs() << "\tNo\n");
     return false;
   }
@@ -186,6 +197,21 @@ void KillFlow::uponStackChange() {
   fcnKills.clear();
   bbKills.clear();
   noStoresBetween.clear();
+  calleeSummaries.reset();
+  cachesConsulted = NothingConsulted;
+}
+
+// The caches are not tracked per entry; keep them all
+// unless some entry may have consulted the change.
+void KillFlow::uponStackChange(unsigned changed) {
+  if (isAffected(cachesConsulted, changed))
+    uponStackChange();
+}
+
+CalleeSummaries &KillFlow::getCalleeSummaries() {
+  if (!calleeSummaries)
+    calleeSummaries.reset(new CalleeSummaries);
+  return *calleeSummaries;
 }
 
 BasicBlock *KillFlow::getLoopEntryBB(const Loop *loop) {
@@ -494,6 +520,7 @@ bool KillFlow::killAllIdx(const Value *killidx, const Value *basePtr,
         bool noStoreBetween;
         if (noStoresBetween.count(ikey)) {
           noStoreBetween = noStoresBetween[ikey];
+          noteCacheHit();
         } else {
           const Instruction *noExtNumOfElemI =
               dyn_cast<Instruction>(bypassExtInsts(numOfElemI));
@@ -504,6 +531,7 @@ bool KillFlow::killAllIdx(const Value *killidx, const Value *basePtr,
           noStoreBetween =
               noStoreInBetween(noExtNumOfElemI, noExtKillLimitI, srcs, *mloops);
           noStoresBetween[ikey] = noStoreBetween;
+          noteCacheFilled();
         }
         if (!noStoreBetween)
           return false;
@@ -598,11 +626,13 @@ bool KillFlow::blockMustKill(const BasicBlock *bb, const Value *ptr,
   if (bbKills.count(key)) {
     if (!bbKills[key]) {
       ++numBBSummaryHits;
+      noteCacheHit();
       return false;
     }
 
     if (bb != beforebb && bb != afterbb) {
       ++numBBSummaryHits;
+      noteCacheHit();
       return bbKills[key];
     }
   }
@@ -644,6 +674,7 @@ bool KillFlow::blockMustKill(const BasicBlock *bb, const Value *ptr,
     if (iKill) {
       LLVM_DEBUG(errs() << "\t(in inst " << *inst << ")\n");
       bbKills[key] = true;
+      noteCacheFilled();
 
       return true;
     }
@@ -749,8 +780,10 @@ bool KillFlow::blockMustKill(const BasicBlock *bb, const Value *ptr,
     return false;
   }
 
-  if (bb != beforebb && bb != afterbb)
+  if (bb != beforebb && bb != afterbb) {
     bbKills[key] = false;
+    noteCacheFilled();
+  }
 
   return false;
 }
@@ -793,8 +826,9 @@ bool KillFlow::allLoadsAreKilledBefore(const Loop *L, CallSite &cs,
 }
 
 KillFlow::KillFlow()
-    : ModulePass(ID), fcnKills(), bbKills(), noStoresBetween(), mloops(0),
-      effectiveNextAA(0), effectiveTopAA(0) {}
+    : ModulePass(ID), fcnKills(), bbKills(), noStoresBetween(),
+      cachesConsulted(NothingConsulted), mloops(0), uoc(0), effectiveNextAA(0),
+      effectiveTopAA(0) {}
 
 KillFlow::~KillFlow() {}
 
@@ -811,7 +845,7 @@ LoopAA::ModRefResult KillFlow::modref(const Instruction *i1,
   // chain after trying to respond
   /*
 
-  ModRefResult res = getEffectiveNextAA()->modref(i1,Rel,i2,L, R);
+  ModRefResult res = consultEffectiveNextAA()->modref(i1,Rel,i2,L, R);
   INTROSPECT(errs() << "lower in the stack reports res=" << res << '\n');
   //if( res == Ref || res == NoModRef )
   if( res == NoModRef )
@@ -832,7 +866,7 @@ LoopAA::ModRefResult KillFlow::modref(const Instruction *i1,
 
   if (!L) {
     INTROSPECT(EXIT(i1, Rel, i2, L, res));
-    return getEffectiveNextAA()->modref(i1, Rel, i2, L, R);
+    return consultEffectiveNextAA()->modref(i1, Rel, i2, L, R);
   }
 
   // use ptr1 & ptr2 for load/store cases
@@ -911,7 +945,7 @@ LoopAA::ModRefResult KillFlow::modref(const Instruction *i1,
     INTROSPECT(EXIT(i1, Rel, i2, L, res));
     if (res != NoModRef) {
       Remedies tmpR;
-      ModRefResult nextRes = getEffectiveNextAA()->modref(i1, Rel, i2, L, tmpR);
+      ModRefResult nextRes = consultEffectiveNextAA()->modref(i1, Rel, i2, L, tmpR);
       if (ModRefResult(res & nextRes) != res) {
         for (auto remed : tmpR)
           R.insert(remed);
@@ -1028,7 +1062,7 @@ LoopAA::ModRefResult KillFlow::modref(const Instruction *i1,
   INTROSPECT(EXIT(i1, Rel, i2, L, res));
   if (res != NoModRef) {
     Remedies tmpR;
-    ModRefResult nextRes = getEffectiveNextAA()->modref(i1, Rel, i2, L, tmpR);
+    ModRefResult nextRes = consultEffectiveNextAA()->modref(i1, Rel, i2, L, tmpR);
     if (ModRefResult(res & nextRes) != res) {
       for (auto remed : tmpR)
         R.insert(remed);
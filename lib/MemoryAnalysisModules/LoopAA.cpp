@@ -1,5 +1,6 @@
 #define DEBUG_TYPE "loopaa"
 
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/IR/GlobalVariable.h"
 #include "llvm/IR/IntrinsicInst.h"
@@ -10,11 +11,14 @@
 #include "scaf/Utilities/GetMemOper.h"
 
 #include <cstdio>
+#include <limits>
 
 namespace liberty {
 using namespace llvm;
 using namespace arcana::noelle;
 
+STATISTIC(numCutoffs, "Num queries stopped since no LoopAA below is cheaper");
+
 char LoopAA::ID = 0;
 char NoLoopAA::ID = 0;
 char AAToLoopAA::ID = 0;
@@ -47,7 +51,10 @@ static RegisterPass<EvalLoopAA>
 //------------------------------------------------------------------------
 // Methods of the LoopAA interface
 
-LoopAA::LoopAA() : td(0), tli(0), nextAA(0), prevAA(0) {}
+unsigned LoopAA::lowestConsulted = LoopAA::NothingConsulted;
+
+LoopAA::LoopAA()
+    : td(0), tli(0), nextAA(0), prevAA(0), position(NothingConsulted) {}
 
 LoopAA::~LoopAA() {
   if (nextAA)
@@ -55,7 +62,7 @@ LoopAA::~LoopAA() {
   if (prevAA)
     prevAA->nextAA = this->nextAA;
 
-  getRealTopAA()->stackHasChanged();
+  getRealTopAA()->stackHasChanged(position);
 }
 
 void LoopAA::InitializeLoopAA(Pass *P, const DataLayout &t) {
@@ -66,7 +73,7 @@ void LoopAA::InitializeLoopAA(Pass *P, const DataLayout &t) {
 
   InitializeLoopAA(&t, ti, naa);
 
-  getRealTopAA()->stackHasChanged();
+  getRealTopAA()->stackHasChanged(position);
 }
 
 void LoopAA::InitializeLoopAA(const DataLayout *t, TargetLibraryInfo *ti,
@@ -78,11 +85,18 @@ void LoopAA::InitializeLoopAA(const DataLayout *t, TargetLibraryInfo *ti,
   if (prevAA || nextAA)
     return;
 
+  position = getSchedulingPreference();
+
   // Insertion-sort this pass into the LoopAA stack.
   prevAA = 0;
   nextAA = naa;
+  // Among equal preferences, those which may answer
+  // with cheaper remedies go first.
   while (nextAA &&
-         nextAA->getSchedulingPreference() > this->getSchedulingPreference()) {
+         (nextAA->getSchedulingPreference() > this->getSchedulingPreference() ||
+          (nextAA->getSchedulingPreference() ==
+               this->getSchedulingPreference() &&
+           nextAA->getMinRemedyRank() < this->getMinRemedyRank()))) {
     prevAA = nextAA;
     nextAA = nextAA->nextAA;
   }
@@ -128,6 +142,25 @@ LoopAA::SchedulingPreference LoopAA::getSchedulingPreference() const {
   return Normal;
 }
 
+LoopAA::RemedyRank LoopAA::getMinRemedyRank() const {
+  return RemedyRank(false, false, 0);
+}
+
+LoopAA::RemedyRank LoopAA::getRemedyRank(const Remedies &R) {
+  return RemedyRank(containsPointsToRemeds(R), containsExpensiveRemeds(R),
+                    totalRemedCost(R));
+}
+
+bool LoopAA::isCheapestPossible(const Remedies &R) const {
+  const RemedyRank rank = getRemedyRank(R);
+  for (const LoopAA *aa = this; aa; aa = aa->nextAA) {
+    noteConsulted(aa);
+    if (aa->getMinRemedyRank() < rank)
+      return false;
+  }
+  return true;
+}
+
 LoopAA::TemporalRelation LoopAA::Rev(TemporalRelation a) {
   switch (a) {
   case Before:
@@ -148,6 +181,7 @@ LoopAA::AliasResult LoopAA::alias(const Value *ptrA, unsigned sizeA,
                                   DesiredAliasResult dAliasRes) {
   assert(nextAA && "Failure in chaining to next LoopAA; did you remember to "
                    "add -no-loop-aa?");
+  noteConsulted(nextAA);
   return nextAA->alias(ptrA, sizeA, rel, ptrB, sizeB, L, R, dAliasRes);
 }
 
@@ -156,6 +190,7 @@ LoopAA::ModRefResult LoopAA::modref(const Instruction *A, TemporalRelation rel,
                                     const Loop *L, Remedies &R) {
   assert(nextAA && "Failure in chaining to next LoopAA; did you remember to "
                    "add -no-loop-aa?");
+  noteConsulted(nextAA);
   return nextAA->modref(A, rel, ptrB, sizeB, L, R);
 }
 
@@ -164,12 +199,14 @@ LoopAA::ModRefResult LoopAA::modref(const Instruction *A, TemporalRelation rel,
                                     Remedies &R) {
   assert(nextAA && "Failure in chaining to next LoopAA; did you remember to "
                    "add -no-loop-aa?");
+  noteConsulted(nextAA);
   return nextAA->modref(A, rel, B, L, R);
 }
 
 bool LoopAA::pointsToConstantMemory(const Value *P, const Loop *L) {
   assert(nextAA && "Failure in chaining to next LoopAA; did you remember to "
                    "add -no-loop-aa?");
+  noteConsulted(nextAA);
   return nextAA->pointsToConstantMemory(P, L);
 }
 
@@ -254,6 +291,24 @@ void LoopAA::stackHasChanged() {
 
 void LoopAA::uponStackChange() {}
 
+void LoopAA::stackHasChanged(unsigned changed) {
+  uponStackChange(changed);
+
+  if (nextAA)
+    nextAA->stackHasChanged(changed);
+}
+
+void LoopAA::uponStackChange(unsigned changed) { uponStackChange(); }
+
+void LoopAA::loopHasFinished(const Loop *L) {
+  uponLoopFinished(L);
+
+  if (nextAA)
+    nextAA->loopHasFinished(L);
+}
+
+void LoopAA::uponLoopFinished(const Loop *L) {}
+
 bool LoopAA::containsExpensiveRemeds(const Remedies &R) {
   for (auto remed : R) {
     if (remed->isExpensive())
@@ -402,6 +457,12 @@ LoopAA::ModRefResult LoopAA::chain(Remedies &finalRemeds, const Instruction *A,
     appendRemedies(finalRemeds, curRemeds);
     return curRes;
   }
+  // nothing below can find a cheaper answer
+  if (curRes == LoopAA::NoModRef && nextAA->isCheapestPossible(curRemeds)) {
+    ++numCutoffs;
+    appendRemedies(finalRemeds, curRemeds);
+    return curRes;
+  }
   Remedies chainRemeds;
   LoopAA::ModRefResult chainRes = LoopAA::modref(A, rel, B, L, chainRemeds);
 
@@ -420,6 +481,12 @@ LoopAA::ModRefResult LoopAA::chain(Remedies &finalRemeds, const Instruction *A,
     appendRemedies(finalRemeds, curRemeds);
     return curRes;
   }
+  // nothing below can find a cheaper answer
+  if (curRes == LoopAA::NoModRef && nextAA->isCheapestPossible(curRemeds)) {
+    ++numCutoffs;
+    appendRemedies(finalRemeds, curRemeds);
+    return curRes;
+  }
   Remedies chainRemeds;
   LoopAA::ModRefResult chainRes =
       LoopAA::modref(A, rel, ptrB, sizeB, L, chainRemeds);
@@ -442,6 +509,13 @@ LoopAA::AliasResult LoopAA::chain(Remedies &finalRemeds, const Value *V1,
     appendRemedies(finalRemeds, curRemeds);
     return curRes;
   }
+  // nothing below can find a cheaper answer
+  if ((curRes == LoopAA::MustAlias || curRes == LoopAA::NoAlias) &&
+      nextAA->isCheapestPossible(curRemeds)) {
+    ++numCutoffs;
+    appendRemedies(finalRemeds, curRemeds);
+    return curRes;
+  }
   Remedies chainRemeds;
   LoopAA::AliasResult chainRes =
       LoopAA::alias(V1, Size1, Rel, V2, Size2, L, chainRemeds, dAliasRes);
@@ -463,6 +537,11 @@ LoopAA::SchedulingPreference NoLoopAA::getSchedulingPreference() const {
   return SchedulingPreference(Bottom - 1);
 }
 
+LoopAA::RemedyRank NoLoopAA::getMinRemedyRank() const {
+  // Never answers with remedies
+  return RemedyRank(true, true, std::numeric_limits<unsigned long>::max());
+}
+
 bool NoLoopAA::runOnModule(Module &mod) {
   const DataLayout *t = &mod.getDataLayout();
   TargetLibraryInfoWrapperPass *tliWrap =
@@ -9,11 +9,12 @@
 #include "scaf/MemoryAnalysisModules/ClassicLoopAA.h"
 #include "scaf/MemoryAnalysisModules/FindSource.h"
 #include "scaf/MemoryAnalysisModules/LoopAA.h"
-#include "scaf/Utilities/CaptureUtil.h"
-#include "scaf/Utilities/FindUnderlyingObjects.h"
+#include "scaf/Utilities/UnderlyingObjectsCache.h"
 
 #include "scaf/MemoryAnalysisModules/Introspection.h"
 
+#include <algorithm>
+
 using namespace liberty;
 using namespace llvm;
 using namespace arcana::noelle;
@@ -21,7 +22,8 @@ using namespace arcana::noelle;
 STATISTIC(numQueries, "Queries");
 STATISTIC(numNoAlias, "No-alias");
 
-static bool isNonCapturedGlobal(const GlobalValue *G) {
+static bool isNonCapturedGlobal(const GlobalValue *G,
+                                UnderlyingObjectsCache &uoc) {
 
   if (isa<GlobalAlias>(G))
     return false;
@@ -35,11 +37,11 @@ static bool isNonCapturedGlobal(const GlobalValue *G) {
       return false;
   }
 
-  return !liberty::findAllCaptures(G);
+  return !uoc.isCaptured(G);
 }
 
-static bool mayBeCaptured(const GlobalValue *gv) {
-  return !isNonCapturedGlobal(gv);
+static bool mayBeCaptured(const GlobalValue *gv, UnderlyingObjectsCache &uoc) {
+  return !isNonCapturedGlobal(gv, uoc);
 }
 
 template <typename Iterator>
@@ -57,6 +59,7 @@ static bool findLoadedNoCaptureArgument(const Iterator &begin,
 
 class NoCaptureGlobalAA : public ModulePass, public liberty::ClassicLoopAA {
   const DataLayout *DL;
+  UnderlyingObjectsCache *uoc;
 
 public:
   static char ID;
@@ -65,6 +68,7 @@ public:
   bool runOnModule(Module &M) {
     DL = &M.getDataLayout();
     InitializeLoopAA(this, *DL);
+    uoc = &getAnalysis<UnderlyingObjectsCache>();
     return false;
   }
 
@@ -75,9 +79,8 @@ public:
                       << "  P1=" << *P1 << ",\n"
                       << "  P2=" << *P2 << ") ?\n");
     // Does 'P1' refer to a non-capture global variable?
-    UO uo1;
-    GetUnderlyingObjects(P1, uo1, *DL);
-    for (UO::iterator i = uo1.begin(), e = uo1.end(); i != e; ++i) {
+    UnderlyingObjectsCache::Objects uo1 = uoc->getUnderlyingObjects(P1, *DL);
+    for (auto i = uo1.begin(), e = uo1.end(); i != e; ++i) {
       const Value *object = *i;
       const GlobalValue *gv = dyn_cast<GlobalValue>(object);
       if (!gv) {
@@ -86,7 +89,7 @@ public:
         return false;
       }
 
-      if (mayBeCaptured(gv)) {
+      if (mayBeCaptured(gv, *uoc)) {
         LLVM_DEBUG(
             errs()
             << "=> NO: P1 might refer to the may-capture global variable "
@@ -99,9 +102,8 @@ public:
     // globals are disjoint from any pointer loaded from memory.
 
     // Can we say that 'P2' does not refer to a no-capture global?
-    UO uo2;
-    GetUnderlyingObjects(P2, uo2, *DL);
-    for (UO::iterator i = uo2.begin(), e = uo2.end(); i != e; ++i) {
+    UnderlyingObjectsCache::Objects uo2 = uoc->getUnderlyingObjects(P2, *DL);
+    for (auto i = uo2.begin(), e = uo2.end(); i != e; ++i) {
       const Value *object = *i;
 
       if (isa<ConstantPointerNull>(object)) {
@@ -154,8 +156,8 @@ public:
         }
 
         // 'P2' may refer to the global variable 'gv'
-        else if (isNonCapturedGlobal(gv)) {
-          if (uo1.count(gv)) {
+        else if (isNonCapturedGlobal(gv, *uoc)) {
+          if (std::binary_search(uo1.begin(), uo1.end(), gv)) {
             // 'P1' may also refer to 'gv'
             LLVM_DEBUG(errs()
                        << "=> NO: Both P1,P2 may refer to " << *gv << '\n');
@@ -231,7 +233,7 @@ public:
       const GlobalValue *G1 = dyn_cast<GlobalValue>(O1);
       const GlobalValue *G2 = dyn_cast<GlobalValue>(O2);
 
-      if (G1 && isNonCapturedGlobal(G1)) {
+      if (G1 && isNonCapturedGlobal(G1, *uoc)) {
 
         if (isa<LoadInst>(O2) &&
             !liberty::findLoadedNoCaptureArgument(V2, *DL)) {
@@ -241,8 +243,8 @@ public:
         }
 
         if (isa<PHINode>(O2)) {
-          liberty::ObjectSet Objects;
-          liberty::findUnderlyingObjects(O2, Objects);
+          UnderlyingObjectsCache::Objects Objects =
+              uoc->findUnderlyingObjects(O2);
           if (!findLoadedNoCaptureArgument(Objects.begin(), Objects.end(),
                                            *DL)) {
             INTROSPECT(EXIT(P1, Rel, P2, L, NoAlias));
@@ -252,7 +254,7 @@ public:
         }
       }
 
-      if (G2 && isNonCapturedGlobal(G2)) {
+      if (G2 && isNonCapturedGlobal(G2, *uoc)) {
 
         if (isa<LoadInst>(O1) &&
             !liberty::findLoadedNoCaptureArgument(V1, *DL)) {
@@ -262,8 +264,8 @@ public:
         }
 
         if (isa<PHINode>(O1)) {
-          liberty::ObjectSet Objects;
-          liberty::findUnderlyingObjects(O1, Objects);
+          UnderlyingObjectsCache::Objects Objects =
+              uoc->findUnderlyingObjects(O1);
           if (!findLoadedNoCaptureArgument(Objects.begin(), Objects.end(),
                                            *DL)) {
             INTROSPECT(EXIT(P1, Rel, P2, L, NoAlias));
@@ -282,6 +284,7 @@ public:
 
   void getAnalysisUsage(AnalysisUsage &AU) const {
     LoopAA::getAnalysisUsage(AU);
+    AU.addRequired<UnderlyingObjectsCache>();
     AU.setPreservesAll(); // Does not transform code
   }
 
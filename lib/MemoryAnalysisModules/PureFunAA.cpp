@@ -3,6 +3,7 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SCCIterator.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/Passes.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/CallSite.h"
@@ -10,6 +11,7 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/raw_ostream.h"
 
 #include "scaf/MemoryAnalysisModules/PureFunAA.h"
@@ -18,11 +20,16 @@
 
 #include "RefineCFG.h"
 
+#include <algorithm>
+
 using namespace llvm;
 using namespace arcana::noelle;
 
 namespace liberty {
 
+STATISTIC(numSCCs, "Number of call graph SCCs summarized");
+STATISTIC(numLevels, "Number of levels in the SCC summary schedule");
+
 static bool isReadOnlyProp(const Instruction *inst) {
   const DataLayout &td = inst->getModule()->getDataLayout();
   if (const MemIntrinsic *mem = dyn_cast<MemIntrinsic>(inst)) {
@@ -163,19 +170,29 @@ bool PureFunAA::isRecursiveProperty(const Function *fun,
                                     const SCCNumSet &falseSet,
                                     const StringSet &knownFunSet,
                                     Property property) const {
+  auto lookup = [&](SCCNum scc) -> int {
+    if (trueSet.count(scc))
+      return 1;
+    if (falseSet.count(scc))
+      return 0;
+    return -1;
+  };
+  return isRecursiveProperty(fun, lookup, knownFunSet, property);
+}
+
+bool PureFunAA::isRecursiveProperty(const Function *fun, SCCLookup lookup,
+                                    const StringSet &knownFunSet,
+                                    Property property) const {
   /* errs() << "in isRecursiveProperty()\n"; */
   if (!fun) {
     return false;
   }
 
-  FunToSCCMapIt sccId = sccMap.find(fun);
-  if (sccId != sccMap.end()) {
-    if (trueSet.count(sccId->second)) {
-      return true;
-    }
-
-    if (falseSet.count(sccId->second)) {
-      return false;
+  const SCCNum scc = getSCCNum(fun);
+  if (scc != ~0U) {
+    const int known = lookup(scc);
+    if (known >= 0) {
+      return known;
     }
   }
 
@@ -212,9 +229,8 @@ bool PureFunAA::isRecursiveProperty(const Function *fun,
         return false;
       }
 
-      if (getSCCNum(fun) != getSCCNum(callee) &&
-          !isRecursiveProperty(callee, trueSet, falseSet, knownFunSet,
-                               property)) {
+      if (scc != getSCCNum(callee) &&
+          !isRecursiveProperty(callee, lookup, knownFunSet, property)) {
         return false;
       }
     }
@@ -222,42 +238,124 @@ bool PureFunAA::isRecursiveProperty(const Function *fun,
   return true;
 }
 
-void PureFunAA::runOnSCC(const SCC &scc) {
-
-  for (SCCIt it = scc.begin(); it != scc.end(); ++it) {
-    const Function *fun = (*it)->getFunction();
-    if (fun)
-      sccMap[fun] = sccCount;
-  }
+// Group the SCCs into tasks and levels for summarizeSCCs().
+//
+// isRecursiveProperty() follows direct calls, including calls through
+// casts of functions, which are not call graph edges.  So, take the
+// components of the SCC graph under those calls (usually one SCC each)
+// as tasks, and place each task one level above the highest task it
+// calls.
+void PureFunAA::buildSchedule() {
+  std::vector<std::vector<SCCNum>> callees(sccCount);
+  for (SCCNum scc = 0; scc < sccCount; ++scc) {
+    std::vector<SCCNum> &out = callees[scc];
+    for (const Function *fun : sccFunctions[scc])
+      for (const_inst_iterator inst = inst_begin(fun); inst != inst_end(fun);
+           ++inst) {
+        const CallSite call =
+            liberty::getCallSite(const_cast<Instruction *>(&*inst));
+        if (!call.getInstruction())
+          continue;
+
+        const Function *callee =
+            dyn_cast<Function>(call.getCalledValue()->stripPointerCasts());
+        const SCCNum other = callee ? getSCCNum(callee) : ~0U;
+        if (other != ~0U && other != scc)
+          out.push_back(other);
+      }
 
-  for (SCCIt it = scc.begin(); it != scc.end(); ++it) {
-    const Function *fun = (*it)->getFunction();
-    if (fun) {
-      if (!isReadOnly(fun)) {
-        writeSet.insert(sccCount);
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+  }
+
+  // Tarjan's algorithm, without recursion: call chains
+  // may be as deep as the module is large.
+  const unsigned unvisited = ~0U;
+  std::vector<unsigned> index(sccCount, unvisited), lowlink(sccCount);
+  std::vector<unsigned> component(sccCount, unvisited), componentLevel;
+  std::vector<bool> onStack(sccCount, false);
+  std::vector<SCCNum> stack;
+  std::vector<std::pair<SCCNum, unsigned>> dfs;
+  unsigned nextIndex = 0;
+
+  schedule.clear();
+  for (SCCNum root = 0; root < sccCount; ++root) {
+    if (index[root] != unvisited)
+      continue;
+
+    index[root] = lowlink[root] = nextIndex++;
+    stack.push_back(root);
+    onStack[root] = true;
+    dfs.push_back(std::make_pair(root, 0u));
+
+    while (!dfs.empty()) {
+      const SCCNum v = dfs.back().first;
+      if (dfs.back().second < callees[v].size()) {
+        const SCCNum w = callees[v][dfs.back().second++];
+        if (index[w] == unvisited) {
+          index[w] = lowlink[w] = nextIndex++;
+          stack.push_back(w);
+          onStack[w] = true;
+          dfs.push_back(std::make_pair(w, 0u));
+        } else if (onStack[w])
+          lowlink[v] = std::min(lowlink[v], index[w]);
+        continue;
       }
 
-      if (!isLocal(fun)) {
-        globalSet.insert(sccCount);
+      dfs.pop_back();
+      if (!dfs.empty()) {
+        const SCCNum u = dfs.back().first;
+        lowlink[u] = std::min(lowlink[u], lowlink[v]);
       }
-    }
-  }
 
-  if (!writeSet.count(sccCount)) {
-    readOnlySet.insert(sccCount);
-  }
+      if (lowlink[v] != index[v])
+        continue;
 
-  if (!globalSet.count(sccCount)) {
-    localSet.insert(sccCount);
+      // v is the root of a component.  Everything it
+      // calls outside of it has already been placed.
+      const unsigned id = componentLevel.size();
+      SCCTask task;
+      SCCNum w;
+      do {
+        w = stack.back();
+        stack.pop_back();
+        onStack[w] = false;
+        component[w] = id;
+        task.push_back(w);
+      } while (w != v);
+
+      unsigned level = 0;
+      for (SCCNum member : task)
+        for (SCCNum callee : callees[member])
+          if (component[callee] != id)
+            level = std::max(level, componentLevel[component[callee]] + 1);
+      componentLevel.push_back(level);
+
+      std::sort(task.begin(), task.end());
+      if (schedule.size() <= level)
+        schedule.resize(level + 1);
+      schedule[level].push_back(std::move(task));
+    }
   }
 
-  assert((!readOnlySet.count(sccCount) || !writeSet.count(sccCount)) &&
-         "SCC ReadOnly and Writes!");
-
-  assert((!localSet.count(sccCount) || !globalSet.count(sccCount)) &&
-         "SCC Local and Global");
+  numLevels += schedule.size();
+}
 
-  ++sccCount;
+void PureFunAA::summarizeSCCs(SCCSummarizer summarize,
+                              SCCResults &results) const {
+  results.assign(sccCount, 0);
+
+  // Each task writes only its own SCCs, and reads only SCCs
+  // of earlier levels or earlier in the same task.
+  for (const std::vector<SCCTask> &level : schedule)
+    parallelForEachN(0, level.size(), [&](size_t i) {
+      for (SCCNum scc : level[i]) {
+        auto lookup = [&](SCCNum other) -> int {
+          return other < scc ? results[other] : -1;
+        };
+        results[scc] = summarize(scc, lookup);
+      }
+    });
 }
 
 static unsigned getArgSize(const ImmutableCallSite CS) {
@@ -357,10 +455,53 @@ bool PureFunAA::runOnModule(Module &M) {
   const DataLayout &DL = M.getDataLayout();
   InitializeLoopAA(this, DL);
 
+  // Number the SCCs bottom-up
   CallGraph &CG = getAnalysis<CallGraphWrapperPass>().getCallGraph();
   for (scc_iterator<CallGraph *> CGI = scc_begin(&CG), E = scc_end(&CG);
        CGI != E; ++CGI) {
-    runOnSCC(*CGI);
+    sccFunctions.emplace_back();
+    for (SCCIt it = CGI->begin(); it != CGI->end(); ++it)
+      if (const Function *fun = (*it)->getFunction()) {
+        sccMap[fun] = sccCount;
+        sccFunctions.back().push_back(fun);
+      }
+    ++sccCount;
+  }
+  numSCCs += sccCount;
+
+  buildSchedule();
+
+  // An SCC has a property if all of its functions do.
+  SCCResults readOnly, local;
+  summarizeSCCs(
+      [this](SCCNum scc, SCCLookup lookup) {
+        for (const Function *fun : sccFunctions[scc])
+          if (!fun->hasFnAttribute(Attribute::ReadOnly) &&
+              !isRecursiveProperty(fun, lookup, pureFunSet, isReadOnlyProp))
+            return false;
+        return true;
+      },
+      readOnly);
+  summarizeSCCs(
+      [this](SCCNum scc, SCCLookup lookup) {
+        for (const Function *fun : sccFunctions[scc])
+          if (!fun->hasFnAttribute(Attribute::ArgMemOnly) &&
+              !isRecursiveProperty(fun, lookup, localFunSet, isLocalProp))
+            return false;
+        return true;
+      },
+      local);
+
+  for (SCCNum scc = 0; scc < sccCount; ++scc) {
+    if (readOnly[scc])
+      readOnlySet.insert(scc);
+    else
+      writeSet.insert(scc);
+
+    if (local[scc])
+      localSet.insert(scc);
+    else
+      globalSet.insert(scc);
   }
 
   return false;
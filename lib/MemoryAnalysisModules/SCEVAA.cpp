@@ -8,10 +8,14 @@
 #include "llvm/IR/Operator.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/MathExtras.h"
 
-#include "scaf/MemoryAnalysisModules/ClassicLoopAA.h"
+#include "scaf/MemoryAnalysisModules/SCEVAA.h"
 #include "scaf/Utilities/ModuleLoops.h"
 
+#include <algorithm>
+#include <cstdlib>
+
 namespace liberty {
 using namespace llvm;
 using namespace arcana::noelle;
@@ -21,569 +25,880 @@ STATISTIC(numEligible, "Num eligible queries");
 STATISTIC(numNoAlias, "Num no-alias queries");
 STATISTIC(numNoAliasMD, "Num no-alias queries with multi-dim check");
 STATISTIC(numMustAlias, "Num must-alias queries");
+STATISTIC(numNoAliasDep, "Num no-alias queries with dependence tests");
+STATISTIC(numDescriptors, "Num access descriptors computed");
+STATISTIC(numIndependentZIV, "Num independent by ZIV test");
+STATISTIC(numIndependentGCD, "Num independent by GCD test");
+STATISTIC(numIndependentBanerjee, "Num independent by Banerjee test");
+STATISTIC(numIndependentSIV, "Num independent by SIV test");
+
+static bool alwaysGreaterThan(ScalarEvolution *SE, const SCEV *difference,
+                              const Loop *L, const APInt &positive,
+                              const APInt &negative) {
+  const ConstantRange range = SE->getSignedRange(difference);
+
+  //    errs() << "alwaysGreaterThan( " << range << ", " << positive << ", "
+  //    << negative << ")\n";
+
+  //    return   positive.ule( range.getUnsignedMin() )
+  //    &&    (-negative).uge( range.getUnsignedMax() );
+  return positive.sle(range.getSignedMin());
+}
+
+static bool stepGreaterThan(ScalarEvolution *SE, const Loop *L,
+                            const SCEV *ptr1,
+                            const APInt &size1, // (from earlier iteration)
+                            const SCEV *ptr2,
+                            const APInt &size2, // (from later iteration)
+                            bool multiDimArrayEligible) {
+  /*
+      The reasoning works like this:
+            given p1=(base1, step1); p2=(base2, step2)
+            let
+              dbase = base2 - base1
+              dstep = step2 - step1
+                (note: dbase + i*dstep == p2i - p1 == distance between
+     pointers at iteration i) if dbase >= 0 and dstep >= 0 and (dbase +
+     i*dstep) + step2 >= size1 then no-alias.
+
+      Further, since k>=1 and dstep is non-negative, we can simplify:
+        dbase >= 0 and dstep >= 0 and dbase + dstep + step2 >= size1 implies
+     no-alias
+  */
+
+  // Deconstruct each stride into (base1,step1) and (base2,step2) w.r.t. loop
+  // L
+  const unsigned BitWidth = SE->getTypeSizeInBits(ptr1->getType());
+  const APInt ap0(BitWidth, 0);
+  const SCEV *zero = SE->getConstant(ap0);
+
+  const SCEV *base1 = ptr1;
+  const SCEV *step1 = zero;
+  if (const SCEVAddRecExpr *ar1 = dyn_cast<SCEVAddRecExpr>(ptr1))
+    if (ar1->getLoop() == L) {
+      base1 = ar1->getStart();
+      step1 = ar1->getStepRecurrence(*SE);
+    }
 
-/// This analysis compares SCEV expressions to analysis
-/// induction variables.  It is meant to very quickly
-/// handle a common case instead of using ModuleSMTAA
-/// to handle a more general case slowly.
-class SCEVAA : public ModulePass, public liberty::ClassicLoopAA {
-
-public:
-  static char ID;
-  SCEVAA() : ModulePass(ID) {}
+  const SCEV *base2 = ptr2;
+  const SCEV *step2 = zero;
+  if (const SCEVAddRecExpr *ar2 = dyn_cast<SCEVAddRecExpr>(ptr2))
+    if (ar2->getLoop() == L) {
+      base2 = ar2->getStart();
+      step2 = ar2->getStepRecurrence(*SE);
+    }
 
-  bool runOnModule(Module &M) {
-    const DataLayout &DL = M.getDataLayout();
-    InitializeLoopAA(this, DL);
+  // At least one must stride
+  if (step1 == zero && step2 == zero)
     return false;
-  }
 
-  static bool alwaysGreaterThan(ScalarEvolution *SE, const SCEV *difference,
-                                const Loop *L, const APInt &positive,
-                                const APInt &negative) {
-    const ConstantRange range = SE->getSignedRange(difference);
+  //    errs() << "stepGreaterThan:\n"
+  //           << " earlier: " << size1 << " bytes from " << *base1 << " by "
+  //           << *step1 << " byte increments\n"
+  //           << "   later: " << size2 << " bytes from " << *base2 << " by "
+  //           << *step2 << " byte increments\n\n";
 
-    //    errs() << "alwaysGreaterThan( " << range << ", " << positive << ", "
-    //    << negative << ")\n";
-
-    //    return   positive.ule( range.getUnsignedMin() )
-    //    &&    (-negative).uge( range.getUnsignedMax() );
-    return positive.sle(range.getSignedMin());
-  }
-
-  static bool stepGreaterThan(ScalarEvolution *SE, const Loop *L,
-                              const SCEV *ptr1,
-                              const APInt &size1, // (from earlier iteration)
-                              const SCEV *ptr2,
-                              const APInt &size2, // (from later iteration)
-                              bool multiDimArrayEligible) {
-    /*
-        The reasoning works like this:
-              given p1=(base1, step1); p2=(base2, step2)
-              let
-                dbase = base2 - base1
-                dstep = step2 - step1
-                  (note: dbase + i*dstep == p2i - p1 == distance between
-       pointers at iteration i) if dbase >= 0 and dstep >= 0 and (dbase +
-       i*dstep) + step2 >= size1 then no-alias.
-
-        Further, since k>=1 and dstep is non-negative, we can simplify:
-          dbase >= 0 and dstep >= 0 and dbase + dstep + step2 >= size1 implies
-       no-alias
-    */
-
-    // Deconstruct each stride into (base1,step1) and (base2,step2) w.r.t. loop
-    // L
-    const unsigned BitWidth = SE->getTypeSizeInBits(ptr1->getType());
-    const APInt ap0(BitWidth, 0);
-    const SCEV *zero = SE->getConstant(ap0);
-
-    const SCEV *base1 = ptr1;
-    const SCEV *step1 = zero;
-    if (const SCEVAddRecExpr *ar1 = dyn_cast<SCEVAddRecExpr>(ptr1))
-      if (ar1->getLoop() == L) {
-        base1 = ar1->getStart();
-        step1 = ar1->getStepRecurrence(*SE);
-      }
-
-    const SCEV *base2 = ptr2;
-    const SCEV *step2 = zero;
-    if (const SCEVAddRecExpr *ar2 = dyn_cast<SCEVAddRecExpr>(ptr2))
-      if (ar2->getLoop() == L) {
-        base2 = ar2->getStart();
-        step2 = ar2->getStepRecurrence(*SE);
-      }
-
-    // At least one must stride
-    if (step1 == zero && step2 == zero)
-      return false;
+  // Consider the case where ptr2>ptr1:
+  {
+    const SCEV *diffBases = SE->getMinusSCEV(base2, base1);
+    const ConstantRange diffBasesRange = SE->getSignedRange(diffBases);
 
-    //    errs() << "stepGreaterThan:\n"
-    //           << " earlier: " << size1 << " bytes from " << *base1 << " by "
-    //           << *step1 << " byte increments\n"
-    //           << "   later: " << size2 << " bytes from " << *base2 << " by "
-    //           << *step2 << " byte increments\n\n";
-
-    // Consider the case where ptr2>ptr1:
-    {
-      const SCEV *diffBases = SE->getMinusSCEV(base2, base1);
-      const ConstantRange diffBasesRange = SE->getSignedRange(diffBases);
-
-      const SCEV *diffStep = SE->getMinusSCEV(step2, step1);
-      const ConstantRange diffStepRange = SE->getSignedRange(diffStep);
-
-      // If the difference in bases is non-negative
-      //     	errs() << " forward difference in bases: " << diffBasesRange <<
-      //     ' ' << *diffBases << '\n';
-      if (diffBasesRange.getSignedMin().sge(0)) {
-        // and, If the difference in steps is non-negative
-        //        errs() << " forward difference in steps: " << diffStepRange <<
-        //        ' ' << *diffStep << '\n';
-        if (diffStepRange.getSignedMin().sge(0)) {
-          // and, if dbase+dstep >= size1
-          const SCEV *minStep = SE->getAddExpr(diffBases, diffStep, step2);
-          const ConstantRange minStepRange = SE->getSignedRange(minStep);
-          //          errs() << " forward minimum step: " << minStepRange << ' '
-          //          << *minStep << '\n';
-
-          if (minStepRange.getSignedMin().sge(size1)) {
-            //            errs() << "===> Disjoint\n";
-            return true;
-          }
+    const SCEV *diffStep = SE->getMinusSCEV(step2, step1);
+    const ConstantRange diffStepRange = SE->getSignedRange(diffStep);
+
+    // If the difference in bases is non-negative
+    //     	errs() << " forward difference in bases: " << diffBasesRange <<
+    //     ' ' << *diffBases << '\n';
+    if (diffBasesRange.getSignedMin().sge(0)) {
+      // and, If the difference in steps is non-negative
+      //        errs() << " forward difference in steps: " << diffStepRange <<
+      //        ' ' << *diffStep << '\n';
+      if (diffStepRange.getSignedMin().sge(0)) {
+        // and, if dbase+dstep >= size1
+        const SCEV *minStep = SE->getAddExpr(diffBases, diffStep, step2);
+        const ConstantRange minStepRange = SE->getSignedRange(minStep);
+        //          errs() << " forward minimum step: " << minStepRange << ' '
+        //          << *minStep << '\n';
+
+        if (minStepRange.getSignedMin().sge(size1)) {
+          //            errs() << "===> Disjoint\n";
+          return true;
         }
       }
+    }
 
-      // add extra check for pointers with same step and base (seems to
-      // handle SCEVs with different subloops and semantically equivalent but
-      // syntactically hard to process bases). Not applicable for inner most
-      // loop accesses (useful for multi-dim array accesses)
-      // FIXME: should disprove cases such as: A[i][j] and A[i][j-1] for i
-      if (diffStepRange.getSignedMin() == 0 && multiDimArrayEligible) {
-
-        const SCEVUnknown *ptrBase1 =
-            dyn_cast<SCEVUnknown>(SE->getPointerBase(ptr1));
-        if (!ptrBase1)
-          return false;
-        const SCEVUnknown *ptrBase2 =
-            dyn_cast<SCEVUnknown>(SE->getPointerBase(ptr2));
-        if (!ptrBase2)
-          return false;
-        if(ptrBase1 != ptrBase2)
-          return false;
-
-        const SCEV *ptrSCEV1 = SE->getMinusSCEV(ptr1, ptrBase1);
-
-        const SCEVAddRecExpr *sAR1 = dyn_cast<SCEVAddRecExpr>(ptrSCEV1);
+    // add extra check for pointers with same step and base (seems to
+    // handle SCEVs with different subloops and semantically equivalent but
+    // syntactically hard to process bases). Not applicable for inner most
+    // loop accesses (useful for multi-dim array accesses)
+    // FIXME: should disprove cases such as: A[i][j] and A[i][j-1] for i
+    if (diffStepRange.getSignedMin() == 0 && multiDimArrayEligible) {
 
-        const SCEV *ptrSCEV2 = SE->getMinusSCEV(ptr2, ptrBase2);
+      const SCEVUnknown *ptrBase1 =
+          dyn_cast<SCEVUnknown>(SE->getPointerBase(ptr1));
+      if (!ptrBase1)
+        return false;
+      const SCEVUnknown *ptrBase2 =
+          dyn_cast<SCEVUnknown>(SE->getPointerBase(ptr2));
+      if (!ptrBase2)
+        return false;
+      if(ptrBase1 != ptrBase2)
+        return false;
 
-        const SCEVAddRecExpr *sAR2 = dyn_cast<SCEVAddRecExpr>(ptrSCEV2);
+      const SCEV *ptrSCEV1 = SE->getMinusSCEV(ptr1, ptrBase1);
 
-        if (sAR1 && sAR2) {
-          // const SCEV *base = sAR->getStart();
-          const SCEV *step1 = sAR1->getStepRecurrence(*SE);
+      const SCEVAddRecExpr *sAR1 = dyn_cast<SCEVAddRecExpr>(ptrSCEV1);
 
-          const SCEV *ElementSize = SE->getConstant(size1);
-          SmallVector<const SCEV *, 4> Subscripts;
-          SmallVector<const SCEV *, 4> Sizes;
-          SE->delinearize(sAR1, Subscripts, Sizes, ElementSize);
+      const SCEV *ptrSCEV2 = SE->getMinusSCEV(ptr2, ptrBase2);
 
-          const SCEV *ElementSize2 = SE->getConstant(size2);
-          SmallVector<const SCEV *, 4> Subscripts2;
-          SmallVector<const SCEV *, 4> Sizes2;
-          SE->delinearize(sAR2, Subscripts2, Sizes2, ElementSize2);
+      const SCEVAddRecExpr *sAR2 = dyn_cast<SCEVAddRecExpr>(ptrSCEV2);
 
-          if (Sizes.size() < 2)
-            return false;
+      if (sAR1 && sAR2) {
+        // const SCEV *base = sAR->getStart();
+        const SCEV *step1 = sAR1->getStepRecurrence(*SE);
 
-          // relevant size is the second to last size (the last one is equal to
-          // the elementSize). the other sizes refer to outer loops if any
-          unsigned relevantSizeIndex = Sizes.size() - 2;
+        const SCEV *ElementSize = SE->getConstant(size1);
+        SmallVector<const SCEV *, 4> Subscripts;
+        SmallVector<const SCEV *, 4> Sizes;
+        SE->delinearize(sAR1, Subscripts, Sizes, ElementSize);
 
-          // Add check for matching indexes to address the following problem:
-          // Incorrectly marks accesses with different bases and equal stride as noalias
-          // e.g. A[i][j] and A[i-1][j] for i
-          const SCEV *diffIndex = SE->getMinusSCEV(Subscripts[relevantSizeIndex], Subscripts2[relevantSizeIndex]);
-          bool sameIndex = diffIndex->isZero(); 
+        const SCEV *ElementSize2 = SE->getConstant(size2);
+        SmallVector<const SCEV *, 4> Subscripts2;
+        SmallVector<const SCEV *, 4> Sizes2;
+        SE->delinearize(sAR2, Subscripts2, Sizes2, ElementSize2);
 
-          const SCEV *diffSCEV = SE->getMinusSCEV(
-              step1, SE->getMulExpr(ElementSize, Sizes[relevantSizeIndex]));
-          const ConstantRange diffRange = SE->getSignedRange(diffSCEV);
-          bool check = diffRange.getSignedMin().sge(0);
+        if (Sizes.size() < 2)
+          return false;
 
-          if (check && sameIndex) {
-            ++numNoAliasMD;
-            LLVM_DEBUG(errs()
-                       << "stepGreaterThan:\n"
-                       << *ptr1 << " and " << *ptr2 << "\n===> Disjoint\n");
-            return true;
-          }
+        // relevant size is the second to last size (the last one is equal to
+        // the elementSize). the other sizes refer to outer loops if any
+        unsigned relevantSizeIndex = Sizes.size() - 2;
+
+        // Add check for matching indexes to address the following problem:
+        // Incorrectly marks accesses with different bases and equal stride as noalias
+        // e.g. A[i][j] and A[i-1][j] for i
+        const SCEV *diffIndex = SE->getMinusSCEV(Subscripts[relevantSizeIndex], Subscripts2[relevantSizeIndex]);
+        bool sameIndex = diffIndex->isZero(); 
+
+        const SCEV *diffSCEV = SE->getMinusSCEV(
+            step1, SE->getMulExpr(ElementSize, Sizes[relevantSizeIndex]));
+        const ConstantRange diffRange = SE->getSignedRange(diffSCEV);
+        bool check = diffRange.getSignedMin().sge(0);
+
+        if (check && sameIndex) {
+          ++numNoAliasMD;
+          LLVM_DEBUG(errs()
+                     << "stepGreaterThan:\n"
+                     << *ptr1 << " and " << *ptr2 << "\n===> Disjoint\n");
+          return true;
         }
       }
     }
-    return false;
   }
+  return false;
+}
 
-  void delinearize(ScalarEvolution *SE, const Pointer &P, const APInt &size,
-                   SmallVectorImpl<const SCEV *> &Sizes,
-                   const SCEVUnknown **ptrBase) {
-    const SCEV *pSCEV = SE->getSCEV(const_cast<Value *>(P.ptr));
+static void delinearize(ScalarEvolution *SE, const ClassicLoopAA::Pointer &P,
+                        const APInt &size, SmallVectorImpl<const SCEV *> &Sizes,
+                        const SCEVUnknown **ptrBase) {
+  const SCEV *pSCEV = SE->getSCEV(const_cast<Value *>(P.ptr));
 
-    *ptrBase = dyn_cast<SCEVUnknown>(SE->getPointerBase(pSCEV));
-    if (*ptrBase) {
-      const SCEV *spSCEV = SE->getMinusSCEV(pSCEV, *ptrBase);
+  *ptrBase = dyn_cast<SCEVUnknown>(SE->getPointerBase(pSCEV));
+  if (*ptrBase) {
+    const SCEV *spSCEV = SE->getMinusSCEV(pSCEV, *ptrBase);
 
-      const SCEVAddRecExpr *sAR = dyn_cast<SCEVAddRecExpr>(spSCEV);
+    const SCEVAddRecExpr *sAR = dyn_cast<SCEVAddRecExpr>(spSCEV);
 
-      if (sAR) {
-        const SCEV *ElementSize = SE->getConstant(size);
-        SmallVector<const SCEV *, 4> Subscripts;
-        SE->delinearize(sAR, Subscripts, Sizes, ElementSize);
-      }
+    if (sAR) {
+      const SCEV *ElementSize = SE->getConstant(size);
+      SmallVector<const SCEV *, 4> Subscripts;
+      SE->delinearize(sAR, Subscripts, Sizes, ElementSize);
     }
   }
+}
 
-  bool checkMultiDimArrayEligibility(const SCEVUnknown *ptrBase1,
-                                     SmallVectorImpl<const SCEV *> &Sizes1,
-                                     const SCEVUnknown *ptrBase2,
-                                     SmallVectorImpl<const SCEV *> &Sizes2) {
+static bool checkMultiDimArrayEligibility(const SCEVUnknown *ptrBase1,
+                                          SmallVectorImpl<const SCEV *> &Sizes1,
+                                          const SCEVUnknown *ptrBase2,
+                                          SmallVectorImpl<const SCEV *> &Sizes2) {
 
-    // check that both have the same pointer base
-    if (!ptrBase1 && ptrBase1 != ptrBase2)
-      return false;
+  // check that both have the same pointer base
+  if (!ptrBase1 && ptrBase1 != ptrBase2)
+    return false;
 
-    // check that both pointer access arrays of same dimensions
-    if (Sizes1.size() != Sizes2.size() || Sizes1.size() < 2)
+  // check that both pointer access arrays of same dimensions
+  if (Sizes1.size() != Sizes2.size() || Sizes1.size() < 2)
+    return false;
+
+  for (unsigned i = 0; i < Sizes1.size(); i++) {
+    if (Sizes1[i] != Sizes2[i])
       return false;
+  }
 
-    for (unsigned i = 0; i < Sizes1.size(); i++) {
-      if (Sizes1[i] != Sizes2[i])
-        return false;
+  return true;
+}
+
+static bool notOverlappingStrides(ScalarEvolution *SE, const Loop *L,
+                                  const SCEV *ptr1,
+                                  const APInt &size1, // (from earlier iteration)
+                                  const SCEV *ptr2,
+                                  const APInt &size2 // (from later iteration)
+) {
+  // Deconstruct each stride into (base1,step1) and (base2,step2) w.r.t. loop
+  // L
+  const unsigned BitWidth = SE->getTypeSizeInBits(ptr1->getType());
+  const APInt ap0(BitWidth, 0);
+  const SCEV *zero = SE->getConstant(ap0);
+
+  const SCEV *base1 = ptr1;
+  const SCEV *step1 = zero;
+  if (const SCEVAddRecExpr *ar1 = dyn_cast<SCEVAddRecExpr>(ptr1))
+    if (ar1->getLoop() == L) {
+      base1 = ar1->getStart();
+      step1 = ar1->getStepRecurrence(*SE);
+    }
+
+  const SCEV *base2 = ptr2;
+  const SCEV *step2 = zero;
+  if (const SCEVAddRecExpr *ar2 = dyn_cast<SCEVAddRecExpr>(ptr2))
+    if (ar2->getLoop() == L) {
+      base2 = ar2->getStart();
+      step2 = ar2->getStepRecurrence(*SE);
     }
 
+  // At least one must stride
+  if (step1 == zero && step2 == zero)
+    return false;
+
+  // Targets cases where the later iteration ptr (ptr2) starts from a
+  // smaller base compared to the earlier iteration ptr (ptr1) but might
+  // overlap if there are enough iterations in between.
+  // The goal is to prove that they cannot overlap.
+  // Check only for the simple case where the step is the same for both
+  // pointers and it is constant.
+  // Orthogonal case to the one handled by stepGreaterThan function.
+  // The performed check:
+  //    dbase = base1 - base2
+  //    dstep = step1 - step2
+  //    if (dbase > 0 && dstep == 0 &&
+  //        dbase % step >= size2 &&
+  //        dbase % step <= step - size1
+  //      then no-alias
+
+  const SCEV *diffStep = SE->getMinusSCEV(step2, step1);
+  bool stepDiffZero =
+      SE->isKnownNonNegative(diffStep) && SE->isKnownNonPositive(diffStep);
+
+  if (!stepDiffZero)
+    return false;
+
+  const SCEV *step = step1; // both steps the same
+  const ConstantRange stepRange = SE->getSignedRange(step);
+  if (!stepRange.isSingleElement()) // step needs to be constant
+    return false;
+  if (stepRange.getSignedMax().sle(0)) // step assumed to be positive.
+    return false;
+
+  const SCEV *diffBases = SE->getMinusSCEV(base1, base2);
+  const ConstantRange diffBasesRange = SE->getSignedRange(diffBases);
+
+  const SCEV *rem = SE->getURemExpr(diffBases, step);
+  const ConstantRange remRange = SE->getSignedRange(rem);
+
+  const SCEV *tmpS = SE->getMinusSCEV(step, rem);
+  const ConstantRange tmpSRange = SE->getSignedRange(tmpS);
+
+  if (diffBasesRange.getSignedMin().sgt(0) &&
+      remRange.getSignedMin().sge(size2) &&
+      tmpSRange.getSignedMin().sge(size1)) {
     return true;
   }
+  return false;
+}
 
-  bool notOverlappingStrides(ScalarEvolution *SE, const Loop *L,
-                             const SCEV *ptr1,
-                             const APInt &size1, // (from earlier iteration)
-                             const SCEV *ptr2,
-                             const APInt &size2 // (from later iteration)
-  ) {
-    // Deconstruct each stride into (base1,step1) and (base2,step2) w.r.t. loop
-    // L
-    const unsigned BitWidth = SE->getTypeSizeInBits(ptr1->getType());
-    const APInt ap0(BitWidth, 0);
-    const SCEV *zero = SE->getConstant(ap0);
-
-    const SCEV *base1 = ptr1;
-    const SCEV *step1 = zero;
-    if (const SCEVAddRecExpr *ar1 = dyn_cast<SCEVAddRecExpr>(ptr1))
-      if (ar1->getLoop() == L) {
-        base1 = ar1->getStart();
-        step1 = ar1->getStepRecurrence(*SE);
-      }
+static BasicBlock *GetBottom(DominatorTree &DT, const SCEV *S) {
+  struct FindBottom {
+    BasicBlock *Bottom = nullptr;
+    DominatorTree &DT;
+
+    FindBottom(DominatorTree &DT) : DT(DT) {}
 
-    const SCEV *base2 = ptr2;
-    const SCEV *step2 = zero;
-    if (const SCEVAddRecExpr *ar2 = dyn_cast<SCEVAddRecExpr>(ptr2))
-      if (ar2->getLoop() == L) {
-        base2 = ar2->getStart();
-        step2 = ar2->getStepRecurrence(*SE);
+    // Process a BB: if it is dominated by Bottom, it becomes the new Bottom.
+    void CheckBB(BasicBlock *BB) {
+      if (!Bottom) {
+        Bottom = BB;
+        return;
       }
+      if (DT.dominates(Bottom, BB))
+        Bottom = BB;
+      else
+        assert(DT.dominates(BB, Bottom) &&
+               "SCEV expressions always have a dominance relationship");
+    }
 
-    // At least one must stride
-    if (step1 == zero && step2 == zero)
+    bool checkSCEVUnknown(const SCEVUnknown *SU) {
+      if (auto *I = dyn_cast<Instruction>(SU->getValue()))
+        CheckBB(I->getParent());
       return false;
+    }
 
-    // Targets cases where the later iteration ptr (ptr2) starts from a
-    // smaller base compared to the earlier iteration ptr (ptr1) but might
-    // overlap if there are enough iterations in between.
-    // The goal is to prove that they cannot overlap.
-    // Check only for the simple case where the step is the same for both
-    // pointers and it is constant.
-    // Orthogonal case to the one handled by stepGreaterThan function.
-    // The performed check:
-    //    dbase = base1 - base2
-    //    dstep = step1 - step2
-    //    if (dbase > 0 && dstep == 0 &&
-    //        dbase % step >= size2 &&
-    //        dbase % step <= step - size1
-    //      then no-alias
-
-    const SCEV *diffStep = SE->getMinusSCEV(step2, step1);
-    bool stepDiffZero =
-        SE->isKnownNonNegative(diffStep) && SE->isKnownNonPositive(diffStep);
-
-    if (!stepDiffZero)
+    bool checkSCEVAddRecExpr(const SCEVAddRecExpr *AddRec) {
+      // (Note that we don't need to recuse into AddRecs: the operands
+      // always dominate the loop.)
+      CheckBB(AddRec->getLoop()->getHeader());
       return false;
+    }
 
-    const SCEV *step = step1; // both steps the same
-    const ConstantRange stepRange = SE->getSignedRange(step);
-    if (!stepRange.isSingleElement()) // step needs to be constant
-      return false;
-    if (stepRange.getSignedMax().sle(0)) // step assumed to be positive.
+    bool follow(const SCEV *S) {
+      switch (static_cast<SCEVTypes>(S->getSCEVType())) {
+      case scConstant:
+        return false;
+      case scAddRecExpr:
+        return checkSCEVAddRecExpr(cast<SCEVAddRecExpr>(S));
+      case scTruncate:
+      case scZeroExtend:
+      case scSignExtend:
+      case scAddExpr:
+      case scMulExpr:
+      case scUMaxExpr:
+      case scUMinExpr:
+      case scSMaxExpr:
+      case scSMinExpr:
+      case scUDivExpr:
+        return true;
+      case scUnknown:
+        return checkSCEVUnknown(cast<SCEVUnknown>(S));
+      case scCouldNotCompute:
+        llvm_unreachable("Attempt to use a SCEVCouldNotCompute object!");
+      }
       return false;
+    }
+    bool isDone() { return false; }
+  };
+  FindBottom FB(DT);
+  SCEVTraversal<FindBottom> ST(FB);
+  ST.visitAll(S);
+  return FB.Bottom;
+}
+
+static bool HasDominanceRelation(DominatorTree &DT, const SCEV *AS,
+                                 const SCEV *BS) {
+  BasicBlock *BottomA = GetBottom(DT, AS);
+  BasicBlock *BottomB = GetBottom(DT, BS);
+  return !BottomA || !BottomB || DT.dominates(BottomA, BottomB) ||
+         DT.dominates(BottomB, BottomA);
+}
+
+// Access descriptors keep strides, trip counts and base differences
+// small enough that the dependence tests below cannot overflow.
+static const unsigned MaxStrideBits = 21;
+static const int64_t MaxIterations = 1LL << 32;
+static const int64_t MaxBaseDifference = 1LL << 40;
+static const unsigned MaxNestDepth = 4;
+
+namespace {
+/// A closed interval of integers, possibly unbounded on either side.
+struct Bound {
+  bool hasLo, hasHi;
+  int64_t lo, hi;
+
+  static Bound point(int64_t v) { return {true, true, v, v}; }
+  static Bound range(int64_t l, int64_t h) { return {true, true, l, h}; }
+  static Bound atLeast(int64_t l) { return {true, false, l, 0}; }
+  static Bound atMost(int64_t h) { return {false, true, 0, h}; }
+  static Bound all() { return {false, false, 0, 0}; }
+
+  bool isEmpty() const { return hasLo && hasHi && lo > hi; }
+
+  bool isPoint() const { return hasLo && hasHi && lo == hi; }
+
+  Bound operator+(const Bound &other) const {
+    return {hasLo && other.hasLo, hasHi && other.hasHi, lo + other.lo,
+            hi + other.hi};
+  }
 
-    const SCEV *diffBases = SE->getMinusSCEV(base1, base2);
-    const ConstantRange diffBasesRange = SE->getSignedRange(diffBases);
+  Bound operator-(const Bound &other) const {
+    return {hasLo && other.hasHi, hasHi && other.hasLo, lo - other.hi,
+            hi - other.lo};
+  }
+
+  Bound scale(int64_t c) const {
+    if (c == 0)
+      return point(0);
+    if (c > 0)
+      return {hasLo, hasHi, lo * c, hi * c};
+    return {hasHi, hasLo, hi * c, lo * c};
+  }
 
-    const SCEV *rem = SE->getURemExpr(diffBases, step);
-    const ConstantRange remRange = SE->getSignedRange(rem);
+  Bound intersect(const Bound &other) const {
+    Bound r = *this;
+    if (other.hasLo && (!r.hasLo || other.lo > r.lo)) {
+      r.hasLo = true;
+      r.lo = other.lo;
+    }
+    if (other.hasHi && (!r.hasHi || other.hi < r.hi)) {
+      r.hasHi = true;
+      r.hi = other.hi;
+    }
+    return r;
+  }
 
-    const SCEV *tmpS = SE->getMinusSCEV(step, rem);
-    const ConstantRange tmpSRange = SE->getSignedRange(tmpS);
+  /// The values v such that c*v is within this interval, c != 0.
+  Bound divide(int64_t c) const {
+    Bound r = (c > 0 ? *this : scale(-1));
+    if (c < 0)
+      c = -c;
+    // Round inward: ceil the low end, floor the high end.
+    if (r.hasLo)
+      r.lo = r.lo >= 0 ? (r.lo + c - 1) / c : -((-r.lo) / c);
+    if (r.hasHi)
+      r.hi = r.hi >= 0 ? r.hi / c : -((-r.hi + c - 1) / c);
+    return r;
+  }
+};
+} // namespace
+
+/// The values the iteration counter of a loop may take.
+static Bound iterations(int64_t maxIterations) {
+  if (maxIterations < 0)
+    return Bound::atLeast(0);
+  return Bound::range(0, maxIterations);
+}
+
+static unsigned direction(const Bound &distance) {
+  unsigned dir = 0;
+  if (!distance.hasHi || distance.hi > 0)
+    dir |= SCEVDependence::LT;
+  if ((!distance.hasLo || distance.lo <= 0) &&
+      (!distance.hasHi || distance.hi >= 0))
+    dir |= SCEVDependence::EQ;
+  if (!distance.hasLo || distance.lo < 0)
+    dir |= SCEVDependence::GT;
+  return dir;
+}
+
+/// Test for a dependence between (A1, size1) and (A2, size2).
+///
+/// The footprints overlap iff
+///   f = sum_k A1.strides[k]*x_k - sum_k A2.strides[k]*y_k
+/// lies within the window W = [e - size1 + 1, e + size2 - 1], where
+/// e = A2.base - A1.base, and x_k, y_k are the iteration counters
+/// of the loops of the two pointers.  In each loop common to both,
+/// we substitute y_k = x_k + d_k, where the distance d_k is given by
+/// (Rel) in the outermost loop, and unconstrained in the others.
+static SCEVDependence testDependence(ScalarEvolution *SE,
+                                     const AccessDescriptor &A1,
+                                     unsigned size1, LoopAA::TemporalRelation Rel,
+                                     const AccessDescriptor &A2,
+                                     unsigned size2) {
+  SCEVDependence dep;
+  if (!A1.valid || !A2.valid)
+    return dep;
+  if (size1 == 0 || size2 == 0 || size1 > (1u << MaxStrideBits) ||
+      size2 > (1u << MaxStrideBits))
+    return dep;
+  if (SE->getEffectiveSCEVType(A1.base->getType()) !=
+      SE->getEffectiveSCEVType(A2.base->getType()))
+    return dep;
+
+  const SCEVConstant *diffBases =
+      dyn_cast<SCEVConstant>(SE->getMinusSCEV(A2.base, A1.base));
+  if (!diffBases || diffBases->getAPInt().getMinSignedBits() > 64)
+    return dep;
+  const int64_t e = diffBases->getAPInt().getSExtValue();
+  if (e > MaxBaseDifference || e < -MaxBaseDifference)
+    return dep;
+  const Bound W = Bound::range(e - size1 + 1, e + size2 - 1);
+
+  unsigned common = 0;
+  while (common < A1.loops.size() && common < A2.loops.size() &&
+         A1.loops[common] == A2.loops[common])
+    ++common;
+  assert(common > 0 && "Descriptors of different loops");
+
+  // The range of each term of f, and its coefficients (for the GCD test)
+  SmallVector<Bound, 8> terms;
+  SmallVector<Bound, 4> distances;
+  int64_t gcd = 0;
+  for (unsigned k = 0; k < common; ++k) {
+    const int64_t a = A1.strides[k], b = A2.strides[k];
+    const Bound X = iterations(A1.maxIterations[k]);
+
+    Bound D = Bound::all();
+    if (A1.maxIterations[k] >= 0)
+      D = Bound::range(-A1.maxIterations[k], A1.maxIterations[k]);
+    if (k == 0) {
+      if (Rel == LoopAA::Same)
+        D = Bound::point(0);
+      else if (Rel == LoopAA::Before)
+        D = D.intersect(Bound::atLeast(1));
+      else
+        D = D.intersect(Bound::atMost(-1));
+    }
+    distances.push_back(D);
 
-    if (diffBasesRange.getSignedMin().sgt(0) &&
-        remRange.getSignedMin().sge(size2) &&
-        tmpSRange.getSignedMin().sge(size1)) {
-      return true;
+    // a*x - b*(x + d) = (a - b)*x - b*d
+    terms.push_back(X.scale(a - b) + D.scale(-b));
+    gcd = GreatestCommonDivisor64(gcd, std::abs(a - b));
+    if (!D.isPoint())
+      gcd = GreatestCommonDivisor64(gcd, std::abs(b));
+  }
+  for (unsigned k = common; k < A1.loops.size(); ++k) {
+    terms.push_back(iterations(A1.maxIterations[k]).scale(A1.strides[k]));
+    gcd = GreatestCommonDivisor64(gcd, std::abs(A1.strides[k]));
+  }
+  for (unsigned k = common; k < A2.loops.size(); ++k) {
+    terms.push_back(iterations(A2.maxIterations[k]).scale(-A2.strides[k]));
+    gcd = GreatestCommonDivisor64(gcd, std::abs(A2.strides[k]));
+  }
+
+  // ZIV: f is zero.
+  if (gcd == 0) {
+    if (W.lo > 0 || W.hi < 0) {
+      ++numIndependentZIV;
+      dep.independent = true;
+      return dep;
     }
-    return false;
   }
 
-  static BasicBlock *GetBottom(DominatorTree &DT, const SCEV *S) {
-    struct FindBottom {
-      BasicBlock *Bottom = nullptr;
-      DominatorTree &DT;
+  // GCD: f is a multiple of gcd.
+  else {
+    const int64_t first =
+        W.lo >= 0 ? (W.lo + gcd - 1) / gcd * gcd : -((-W.lo) / gcd * gcd);
+    if (first > W.hi) {
+      ++numIndependentGCD;
+      dep.independent = true;
+      return dep;
+    }
+  }
 
-      FindBottom(DominatorTree &DT) : DT(DT) {}
+  // Banerjee: f is within the sum of the ranges of its terms.
+  Bound f = Bound::point(0);
+  for (const Bound &term : terms)
+    f = f + term;
+  if (f.intersect(W).isEmpty()) {
+    ++numIndependentBanerjee;
+    dep.independent = true;
+    return dep;
+  }
 
-      // Process a BB: if it is dominated by Bottom, it becomes the new Bottom.
-      void CheckBB(BasicBlock *BB) {
-        if (!Bottom) {
-          Bottom = BB;
-          return;
-        }
-        if (DT.dominates(Bottom, BB))
-          Bottom = BB;
-        else
-          assert(DT.dominates(BB, Bottom) &&
-                 "SCEV expressions always have a dominance relationship");
+  // SIV: in a common loop where both pointers have the same stride,
+  // f = -b*d_k + (the other terms), which bounds the distance d_k.
+  for (unsigned k = 0; k < common; ++k) {
+    const int64_t b = A2.strides[k];
+    Bound distance = distances[k];
+    if (A1.strides[k] == b && b != 0) {
+      Bound rest = Bound::point(0);
+      for (unsigned j = 0; j < terms.size(); ++j)
+        if (j != k)
+          rest = rest + terms[j];
+
+      // b*d = rest - f, for some f in W
+      distance = distance.intersect((rest - W).divide(b));
+      if (distance.isEmpty()) {
+        ++numIndependentSIV;
+        dep.independent = true;
+        dep.levels.clear();
+        return dep;
       }
+    }
 
-      bool checkSCEVUnknown(const SCEVUnknown *SU) {
-        if (auto *I = dyn_cast<Instruction>(SU->getValue()))
-          CheckBB(I->getParent());
-        return false;
-      }
+    SCEVDependence::Level level;
+    level.loop = A1.loops[k];
+    level.direction = direction(distance);
+    level.hasMinDistance = distance.hasLo;
+    level.hasMaxDistance = distance.hasHi;
+    level.minDistance = distance.lo;
+    level.maxDistance = distance.hi;
+    dep.levels.push_back(level);
+  }
 
-      bool checkSCEVAddRecExpr(const SCEVAddRecExpr *AddRec) {
-        // (Note that we don't need to recuse into AddRecs: the operands
-        // always dominate the loop.)
-        CheckBB(AddRec->getLoop()->getHeader());
-        return false;
-      }
+  return dep;
+}
+
+void SCEVAA::computeAccessDescriptor(ScalarEvolution *SE, const Value *ptr,
+                                     const Loop *L, AccessDescriptor &A) {
+  Value *p = const_cast<Value *>(ptr);
+  A.scoped = SE->getSCEVAtScope(p, const_cast<Loop *>(L));
+
+  // Peel the recurrences of L and its subloops, innermost first.
+  const SCEV *S = SE->getSCEV(p);
+  while (const SCEVAddRecExpr *ar = dyn_cast<SCEVAddRecExpr>(S)) {
+    const Loop *AL = ar->getLoop();
+    if (!L->contains(AL))
+      break;
+    if (!ar->isAffine() || A.loops.size() == MaxNestDepth)
+      return;
+
+    const SCEVConstant *step =
+        dyn_cast<SCEVConstant>(ar->getStepRecurrence(*SE));
+    if (!step || step->getAPInt().getMinSignedBits() > MaxStrideBits)
+      return;
+
+    A.loops.push_back(AL);
+    A.strides.push_back(step->getAPInt().getSExtValue());
+    S = ar->getStart();
+  }
 
-      bool follow(const SCEV *S) {
-        switch (static_cast<SCEVTypes>(S->getSCEVType())) {
-        case scConstant:
-          return false;
-        case scAddRecExpr:
-          return checkSCEVAddRecExpr(cast<SCEVAddRecExpr>(S));
-        case scTruncate:
-        case scZeroExtend:
-        case scSignExtend:
-        case scAddExpr:
-        case scMulExpr:
-        case scUMaxExpr:
-        case scUMinExpr:
-        case scSMaxExpr:
-        case scSMinExpr:
-        case scUDivExpr:
-          return true;
-        case scUnknown:
-          return checkSCEVUnknown(cast<SCEVUnknown>(S));
-        case scCouldNotCompute:
-          llvm_unreachable("Attempt to use a SCEVCouldNotCompute object!");
-        }
-        return false;
-      }
-      bool isDone() { return false; }
-    };
-    FindBottom FB(DT);
-    SCEVTraversal<FindBottom> ST(FB);
-    ST.visitAll(S);
-    return FB.Bottom;
+  if (!SE->isLoopInvariant(S, L))
+    return;
+
+  std::reverse(A.loops.begin(), A.loops.end());
+  std::reverse(A.strides.begin(), A.strides.end());
+  if (A.loops.empty() || A.loops[0] != L) {
+    A.loops.insert(A.loops.begin(), L);
+    A.strides.insert(A.strides.begin(), 0);
   }
 
-  static bool HasDominanceRelation(DominatorTree &DT, const SCEV *AS,
-                                   const SCEV *BS) {
-    BasicBlock *BottomA = GetBottom(DT, AS);
-    BasicBlock *BottomB = GetBottom(DT, BS);
-    return !BottomA || !BottomB || DT.dominates(BottomA, BottomB) ||
-           DT.dominates(BottomB, BottomA);
+  // Each loop must be nested within the previous one.
+  for (unsigned k = 1; k < A.loops.size(); ++k)
+    if (A.loops[k] == A.loops[k - 1] || !A.loops[k - 1]->contains(A.loops[k]))
+      return;
+
+  for (const Loop *AL : A.loops) {
+    int64_t maxIterations = -1;
+    const SCEV *btc = SE->getBackedgeTakenCount(AL);
+    if (const SCEVConstant *c = dyn_cast<SCEVConstant>(btc))
+      if (c->getAPInt().getActiveBits() < 64 &&
+          c->getAPInt().getZExtValue() <= (uint64_t)MaxIterations)
+        maxIterations = c->getAPInt().getZExtValue();
+    A.maxIterations.push_back(maxIterations);
   }
 
-  virtual AliasResult
-  aliasCheck(const Pointer &P1, TemporalRelation Rel, const Pointer &P2,
-             const Loop *L, Remedies &R,
-             DesiredAliasResult dAliasRes = DNoOrMustAlias) {
-
-    ++numQueries;
-
-    if (!L)
-      return MayAlias;
-    if (P1.size == 0)
-      return MayAlias;
-    if (P2.size == 0)
-      return MayAlias;
-
-    BasicBlock *header = L->getHeader();
-    Function *fcn = header->getParent();
-
-    ModuleLoops &mloops = getAnalysis<ModuleLoops>();
-    ScalarEvolution *SE = &mloops.getAnalysis_ScalarEvolution(fcn);
-    DominatorTree &DT = mloops.getAnalysis_DominatorTree(fcn);
-
-    if (!SE->isSCEVable(P1.ptr->getType()))
-      return MayAlias;
-    if (!SE->isSCEVable(P2.ptr->getType()))
-      return MayAlias;
-
-    const SCEV *s1 = SE->getSCEVAtScope(const_cast<Value *>(P1.ptr), L);
-    if (!s1)
-      return MayAlias;
-    const SCEV *s2 = SE->getSCEVAtScope(const_cast<Value *>(P2.ptr), L);
-    if (!s2)
-      return MayAlias;
-
-    const unsigned BitWidth = SE->getTypeSizeInBits(s1->getType());
-    APInt size1(BitWidth, P1.size);
-    APInt size2(BitWidth, P2.size);
-
-    if (Rel == LoopAA::Same) {
-      if (s1 == s2) {
-        ++numMustAlias;
-        return MustAlias; // true within one iteration; not necessarily across
-                          // iterations.
-      }
-    } else {
-      if (Rel == LoopAA::After)
-        std::swap(s1, s2);
-      // s1 is evaluated in an earlier iteration than s2.
-    }
+  A.base = S;
+  A.valid = true;
+}
+
+const AccessDescriptor &SCEVAA::getAccessDescriptor(const Value *ptr,
+                                                    const Loop *L) {
+  Function *fcn = L->getHeader()->getParent();
+  ModuleLoops &mloops = getAnalysis<ModuleLoops>();
+  ScalarEvolution *SE = &mloops.getAnalysis_ScalarEvolution(fcn);
+
+  LoopAccesses &cache = loopAccesses[L];
+  if (cache.SE != SE) {
+    cache.accesses.clear();
+    cache.SE = SE;
+  }
 
-    if (dAliasRes == DMustAlias)
-      return MayAlias;
-
-    // check for this case (seen in 052.alvinn)
-    // for (i=0; i < N; i++)
-    //   a[i] = ...
-    // a[N] = ..
-    // alias query for &a[i], vs &a[N]
-    //
-    // TODO: generalize this scenario (need to handle cases that write [0] and
-    // then [1..N] etc)
-    // TODO: revisit this check and ensure that there are no false positives
-    auto tmpPtr1 = P1.ptr;
-    auto tmpPtr2 = P2.ptr;
-    auto nonScopedS1 = SE->getSCEV(const_cast<Value *>(P1.ptr));
-    auto nonScopedS2 = SE->getSCEV(const_cast<Value *>(P2.ptr));
-    if (isa<SCEVAddRecExpr>(nonScopedS2) && isa<SCEVAddExpr>(nonScopedS1)) {
-      std::swap(tmpPtr1, tmpPtr2);
-      std::swap(nonScopedS1, nonScopedS2);
+  auto i = cache.accesses.find(ptr);
+  if (i != cache.accesses.end())
+    return i->second;
+
+  ++numDescriptors;
+  AccessDescriptor &A = cache.accesses[ptr];
+  computeAccessDescriptor(SE, ptr, L, A);
+  return A;
+}
+
+SCEVDependence SCEVAA::getDependence(const Pointer &P1, TemporalRelation Rel,
+                                     const Pointer &P2, const Loop *L) {
+  if (!L)
+    return SCEVDependence();
+
+  Function *fcn = L->getHeader()->getParent();
+  ScalarEvolution *SE =
+      &getAnalysis<ModuleLoops>().getAnalysis_ScalarEvolution(fcn);
+  if (!SE->isSCEVable(P1.ptr->getType()) ||
+      !SE->isSCEVable(P2.ptr->getType()))
+    return SCEVDependence();
+
+  const AccessDescriptor &A1 = getAccessDescriptor(P1.ptr, L);
+  const AccessDescriptor &A2 = getAccessDescriptor(P2.ptr, L);
+  return testDependence(SE, A1, P1.size, Rel, A2, P2.size);
+}
+
+bool SCEVAA::runOnModule(Module &M) {
+  const DataLayout &DL = M.getDataLayout();
+  InitializeLoopAA(this, DL);
+  return false;
+}
+
+void SCEVAA::getAnalysisUsage(AnalysisUsage &AU) const {
+  LoopAA::getAnalysisUsage(AU);
+  AU.addRequired<ModuleLoops>();
+  AU.setPreservesAll(); // Does not transform code
+}
+
+LoopAA::AliasResult SCEVAA::aliasCheck(const Pointer &P1, TemporalRelation Rel,
+                                       const Pointer &P2, const Loop *L,
+                                       Remedies &R,
+                                       DesiredAliasResult dAliasRes) {
+
+  ++numQueries;
+
+  if (!L)
+    return MayAlias;
+  if (P1.size == 0)
+    return MayAlias;
+  if (P2.size == 0)
+    return MayAlias;
+
+  BasicBlock *header = L->getHeader();
+  Function *fcn = header->getParent();
+
+  ModuleLoops &mloops = getAnalysis<ModuleLoops>();
+  ScalarEvolution *SE = &mloops.getAnalysis_ScalarEvolution(fcn);
+  DominatorTree &DT = mloops.getAnalysis_DominatorTree(fcn);
+
+  if (!SE->isSCEVable(P1.ptr->getType()))
+    return MayAlias;
+  if (!SE->isSCEVable(P2.ptr->getType()))
+    return MayAlias;
+
+  const AccessDescriptor &A1 = getAccessDescriptor(P1.ptr, L);
+  const AccessDescriptor &A2 = getAccessDescriptor(P2.ptr, L);
+
+  const SCEV *s1 = A1.scoped;
+  if (!s1)
+    return MayAlias;
+  const SCEV *s2 = A2.scoped;
+  if (!s2)
+    return MayAlias;
+
+  const unsigned BitWidth = SE->getTypeSizeInBits(s1->getType());
+  APInt size1(BitWidth, P1.size);
+  APInt size2(BitWidth, P2.size);
+
+  if (Rel == LoopAA::Same) {
+    if (s1 == s2) {
+      ++numMustAlias;
+      return MustAlias; // true within one iteration; not necessarily across
+                        // iterations.
     }
-    if (isa<SCEVAddRecExpr>(nonScopedS1) && isa<SCEVAddExpr>(nonScopedS2)) {
-      auto addRecNonScopedS1 = dyn_cast<SCEVAddRecExpr>(nonScopedS1);
-      auto innerLoopAddRec = addRecNonScopedS1->getLoop();
-
-      if (innerLoopAddRec != L && L->contains(innerLoopAddRec) &&
-          innerLoopAddRec->getParentLoop()) {
-        // check if tmpPtr1 is used outside the loop. If not, then just
-        // compare its SCEV value outside its loop and compare it with the
-        // scev of tmpPtr2.
-        //
-        // Check if this pointer is used outside the loop.
-        bool noUseOutsideLoopOfAddRec = true;
-        for (auto user1 : tmpPtr1->users()) {
-          if (auto userI1 = dyn_cast<Instruction>(user1)) {
-            if (!innerLoopAddRec->contains(userI1)) {
-              noUseOutsideLoopOfAddRec = false;
-              break;
-            }
+  } else {
+    if (Rel == LoopAA::After)
+      std::swap(s1, s2);
+    // s1 is evaluated in an earlier iteration than s2.
+  }
+
+  if (dAliasRes == DMustAlias)
+    return MayAlias;
+
+  // check for this case (seen in 052.alvinn)
+  // for (i=0; i < N; i++)
+  //   a[i] = ...
+  // a[N] = ..
+  // alias query for &a[i], vs &a[N]
+  //
+  // TODO: generalize this scenario (need to handle cases that write [0] and
+  // then [1..N] etc)
+  // TODO: revisit this check and ensure that there are no false positives
+  auto tmpPtr1 = P1.ptr;
+  auto tmpPtr2 = P2.ptr;
+  auto nonScopedS1 = SE->getSCEV(const_cast<Value *>(P1.ptr));
+  auto nonScopedS2 = SE->getSCEV(const_cast<Value *>(P2.ptr));
+  if (isa<SCEVAddRecExpr>(nonScopedS2) && isa<SCEVAddExpr>(nonScopedS1)) {
+    std::swap(tmpPtr1, tmpPtr2);
+    std::swap(nonScopedS1, nonScopedS2);
+  }
+  if (isa<SCEVAddRecExpr>(nonScopedS1) && isa<SCEVAddExpr>(nonScopedS2)) {
+    auto addRecNonScopedS1 = dyn_cast<SCEVAddRecExpr>(nonScopedS1);
+    auto innerLoopAddRec = addRecNonScopedS1->getLoop();
+
+    if (innerLoopAddRec != L && L->contains(innerLoopAddRec) &&
+        innerLoopAddRec->getParentLoop()) {
+      // check if tmpPtr1 is used outside the loop. If not, then just
+      // compare its SCEV value outside its loop and compare it with the
+      // scev of tmpPtr2.
+      //
+      // Check if this pointer is used outside the loop.
+      bool noUseOutsideLoopOfAddRec = true;
+      for (auto user1 : tmpPtr1->users()) {
+        if (auto userI1 = dyn_cast<Instruction>(user1)) {
+          if (!innerLoopAddRec->contains(userI1)) {
+            noUseOutsideLoopOfAddRec = false;
+            break;
           }
         }
-        if (noUseOutsideLoopOfAddRec && HasDominanceRelation(DT, s1, s2)) {
-          const SCEV *ptrDiff = SE->getMinusSCEV(s1, s2);
-          if (ptrDiff) {
-            if (auto constantPtrDiff = dyn_cast<SCEVConstant>(ptrDiff)) {
-              if (constantPtrDiff->getAPInt() == 0) {
-                ++numNoAlias;
-                return NoAlias;
-              }
+      }
+      if (noUseOutsideLoopOfAddRec && HasDominanceRelation(DT, s1, s2)) {
+        const SCEV *ptrDiff = SE->getMinusSCEV(s1, s2);
+        if (ptrDiff) {
+          if (auto constantPtrDiff = dyn_cast<SCEVConstant>(ptrDiff)) {
+            if (constantPtrDiff->getAPInt() == 0) {
+              ++numNoAlias;
+              return NoAlias;
             }
           }
         }
       }
     }
+  }
 
-    if (SE->getEffectiveSCEVType(s1->getType()) !=
-        SE->getEffectiveSCEVType(s2->getType()))
-      return MayAlias;
-
-    // fix dominance problem; may introduce more MayAlias
-    if (Rel == LoopAA::Same && !HasDominanceRelation(DT, s1, s2))
-      return MayAlias;
+  if (SE->getEffectiveSCEVType(s1->getType()) !=
+      SE->getEffectiveSCEVType(s2->getType()))
+    return MayAlias;
 
-    ++numEligible;
+  // fix dominance problem; may introduce more MayAlias
+  if (Rel == LoopAA::Same && !HasDominanceRelation(DT, s1, s2))
+    return MayAlias;
 
-    //  We want to subtract these SCEVs to demonstrate that the difference
-    //  in pointers is greater than the access size during any iteration.
-    if (Rel == LoopAA::Same) {
-      const SCEV *diff = SE->getMinusSCEV(s1, s2);
-      if (alwaysGreaterThan(SE, diff, L, size2, size1)) {
-        ++numNoAlias;
-        return NoAlias;
-      }
+  ++numEligible;
 
-      // Try the same in reverse
-      diff = SE->getMinusSCEV(s2, s1);
-      if (alwaysGreaterThan(SE, diff, L, size1, size2)) {
-        ++numNoAlias;
-        return NoAlias;
-      }
-    } else {
-      // We want to subtract these SCEVs to demonstrate that the difference
-      // in pointers must be greater than the access size during any
-      // two iterations I1 < I2.
-
-      bool innerMostLoopAccess =
-          (s1 == SE->getSCEV(const_cast<Value *>(P1.ptr)) &&
-           s2 == SE->getSCEV(const_cast<Value *>(P2.ptr)));
-
-      const SCEVUnknown *ptrBase1;
-      SmallVector<const SCEV *, 4> Sizes1;
-      const SCEVUnknown *ptrBase2;
-      SmallVector<const SCEV *, 4> Sizes2;
-      delinearize(SE, P1, size1, Sizes1, &ptrBase1);
-      delinearize(SE, P2, size2, Sizes2, &ptrBase2);
-
-      bool multiDimArrayEligible =
-          !innerMostLoopAccess &&
-          checkMultiDimArrayEligibility(ptrBase1, Sizes1, ptrBase2, Sizes2);
-
-      if (stepGreaterThan(SE, L, s1, size1, s2, size2, multiDimArrayEligible)) {
-        ++numNoAlias;
-        return NoAlias;
-      } else if (notOverlappingStrides(SE, L, s1, size1, s2, size2)) {
-        ++numNoAlias;
-        return NoAlias;
-      }
+  //  We want to subtract these SCEVs to demonstrate that the difference
+  //  in pointers is greater than the access size during any iteration.
+  if (Rel == LoopAA::Same) {
+    const SCEV *diff = SE->getMinusSCEV(s1, s2);
+    if (alwaysGreaterThan(SE, diff, L, size2, size1)) {
+      ++numNoAlias;
+      return NoAlias;
     }
 
-    // These are the most interesting: eligible queries
-    // for which we can't say anything.
-    LLVM_DEBUG(errs() << "Eligible fallthrough:\n"
-                      << "  size " << size1 << " scev1 " << *s1
-                      << " , ptr1: " << *P1.ptr << ", non-scoped SCEV: "
-                      << *SE->getSCEV(const_cast<Value *>(P1.ptr)) << '\n'
-                      << "(" << Rel << ", " << fcn->getName()
-                      << " :: " << header->getName() << ")\n"
-                      << "  size " << size2 << " scev2 " << *s2
-                      << " , ptr2: " << *P2.ptr << ", non-scoped SCEV: "
-                      << *SE->getSCEV(const_cast<Value *>(P2.ptr)) << '\n');
-    return MayAlias;
+    // Try the same in reverse
+    diff = SE->getMinusSCEV(s2, s1);
+    if (alwaysGreaterThan(SE, diff, L, size1, size2)) {
+      ++numNoAlias;
+      return NoAlias;
+    }
+  } else {
+    // We want to subtract these SCEVs to demonstrate that the difference
+    // in pointers must be greater than the access size during any
+    // two iterations I1 < I2.
+
+    bool innerMostLoopAccess =
+        (s1 == SE->getSCEV(const_cast<Value *>(P1.ptr)) &&
+         s2 == SE->getSCEV(const_cast<Value *>(P2.ptr)));
+
+    const SCEVUnknown *ptrBase1;
+    SmallVector<const SCEV *, 4> Sizes1;
+    const SCEVUnknown *ptrBase2;
+    SmallVector<const SCEV *, 4> Sizes2;
+    delinearize(SE, P1, size1, Sizes1, &ptrBase1);
+    delinearize(SE, P2, size2, Sizes2, &ptrBase2);
+
+    bool multiDimArrayEligible =
+        !innerMostLoopAccess &&
+        checkMultiDimArrayEligibility(ptrBase1, Sizes1, ptrBase2, Sizes2);
+
+    if (stepGreaterThan(SE, L, s1, size1, s2, size2, multiDimArrayEligible)) {
+      ++numNoAlias;
+      return NoAlias;
+    } else if (notOverlappingStrides(SE, L, s1, size1, s2, size2)) {
+      ++numNoAlias;
+      return NoAlias;
+    }
   }
 
-  StringRef getLoopAAName() const { return "scev-loopaa"; }
-
-  void getAnalysisUsage(AnalysisUsage &AU) const {
-    LoopAA::getAnalysisUsage(AU);
-    AU.addRequired<ModuleLoops>();
-    AU.setPreservesAll(); // Does not transform code
+  // Classic dependence tests over the access descriptors
+  if (testDependence(SE, A1, P1.size, Rel, A2, P2.size).independent) {
+    ++numNoAliasDep;
+    return NoAlias;
   }
 
-  /// getAdjustedAnalysisPointer - This method is used when a pass implements
-  /// an analysis interface through multiple inheritance.  If needed, it
-  /// should override this to adjust the this pointer as needed for the
-  /// specified pass info.
-  virtual void *getAdjustedAnalysisPointer(AnalysisID PI) {
-    if (PI == &LoopAA::ID)
-      return (LoopAA *)this;
-    return this;
-  }
-};
+  // These are the most interesting: eligible queries
+  // for which we can't say anything.
+  LLVM_DEBUG(errs() << "Eligible fallthrough:\n"
+                    << "  size " << size1 << " scev1 " << *s1
+                    << " , ptr1: " << *P1.ptr << ", non-scoped SCEV: "
+                    << *SE->getSCEV(const_cast<Value *>(P1.ptr)) << '\n'
+                    << "(" << Rel << ", " << fcn->getName()
+                    << " :: " << header->getName() << ")\n"
+                    << "  size " << size2 << " scev2 " << *s2
+                    << " , ptr2: " << *P2.ptr << ", non-scoped SCEV: "
+                    << *SE->getSCEV(const_cast<Value *>(P2.ptr)) << '\n');
+  return MayAlias;
+}
 
 static RegisterPass<SCEVAA> X("scev-loop-aa",
                               "Reasons about induction variables");
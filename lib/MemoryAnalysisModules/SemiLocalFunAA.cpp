@@ -1,8 +1,8 @@
 #define DEBUG_TYPE "semi-local-fun-aa"
 
-#include "llvm/ADT/SCCIterator.h"
 #include "llvm/IR/InstIterator.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/IR/IntrinsicInst.h"
 
@@ -28,24 +28,6 @@ bool SemiLocalFunAA::isSemiLocal(const Function *fun,
                                      semiLocalFunSet, isSemiLocalProp);
 }
 
-void SemiLocalFunAA::runOnSCC(const PureFunAA::SCC &scc, PureFunAA &pureFun) {
-
-  PureFunAA::SCCNum sccNum = pureFun.getSCCNum(scc);
-  if (sccNum == ~0U)
-    return;
-
-  for (PureFunAA::SCCIt it = scc.begin(); it != scc.end(); ++it) {
-    const Function *fun = (*it)->getFunction();
-    if (fun && !isSemiLocal(fun, pureFun)) {
-      globalSet.insert(sccNum);
-    }
-  }
-
-  if (!globalSet.count(sccNum)) {
-    semiLocalSet.insert(sccNum);
-  }
-}
-
 void SemiLocalFunAA::initGlobalMod(const Value *v, GlobalSet &mods,
                                    GlobalSet &refs, FuncSet &funcs) {
 
@@ -228,38 +210,68 @@ bool SemiLocalFunAA::runOnModule(Module &M) {
 
   PureFunAA &pureFun = getAnalysis<PureFunAA>();
 
-  CallGraph &CG = getAnalysis<CallGraphWrapperPass>().getCallGraph();
-  for (scc_iterator<CallGraph *> CGI = scc_begin(&CG), E = scc_end(&CG);
-       CGI != E; ++CGI) {
-    runOnSCC(*CGI, pureFun);
+  // Reuse the SCCs and the schedule of PureFunAA.
+  PureFunAA::SCCResults semiLocal;
+  pureFun.summarizeSCCs(
+      [&pureFun](PureFunAA::SCCNum scc, PureFunAA::SCCLookup lookup) {
+        for (const Function *fun : pureFun.getSCCFunctions(scc))
+          if (!pureFun.isRecursiveProperty(fun, lookup, semiLocalFunSet,
+                                           isSemiLocalProp))
+            return false;
+        return true;
+      },
+      semiLocal);
+
+  for (PureFunAA::SCCNum scc = 0; scc < semiLocal.size(); ++scc) {
+    // SCCs without functions (i.e. the external node) are neither.
+    if (pureFun.getSCCFunctions(scc).empty())
+      continue;
+
+    if (semiLocal[scc])
+      semiLocalSet.insert(scc);
+    else
+      globalSet.insert(scc);
   }
 
-  FuncSet funcs;
-
+  // The globals each semi-local function may reach are
+  // independent of one another; collect them concurrently.
+  std::vector<const Function *> semiLocalFuns;
   typedef Module::const_iterator ModuleIt;
   for (ModuleIt fun = M.begin(); fun != M.end(); ++fun) {
-    LLVM_DEBUG(errs() << "SemiLocalFunAA: " << fun->getName());
     const Function *funP = &*fun;
-    if (isSemiLocal(funP, pureFun)) {
-      GlobalSet &mods = globalMod[funP];
-      GlobalSet &refs = globalRef[funP];
-      initGlobalMod(funP, mods, refs, funcs);
-      funcs.clear();
-
-      LLVM_DEBUG(errs() << " mods: ";
-                 for (GlobalSet::iterator i = mods.begin(), e = mods.end();
-                      i != e; ++i) errs()
-                 << (*i)->getName() << ", ";
-                 errs() << '\n'; errs() << " refs: ";
-                 for (GlobalSet::iterator i = refs.begin(), e = refs.end();
-                      i != e; ++i) errs()
-                 << (*i)->getName() << ", ";
-                 errs() << '\n';
-
-      );
-    } else {
-      LLVM_DEBUG(errs() << " is not semi-local\n");
-    }
+    if (isSemiLocal(funP, pureFun))
+      semiLocalFuns.push_back(funP);
+    else
+      LLVM_DEBUG(errs() << "SemiLocalFunAA: " << fun->getName()
+                        << " is not semi-local\n");
+  }
+
+  std::vector<std::pair<GlobalSet, GlobalSet>> globals(semiLocalFuns.size());
+  parallelForEachN(0, semiLocalFuns.size(), [&](size_t i) {
+    FuncSet funcs;
+    initGlobalMod(semiLocalFuns[i], globals[i].first, globals[i].second,
+                  funcs);
+  });
+
+  for (unsigned i = 0; i < semiLocalFuns.size(); ++i) {
+    const Function *funP = semiLocalFuns[i];
+    GlobalSet &mods = globalMod[funP];
+    GlobalSet &refs = globalRef[funP];
+    mods = std::move(globals[i].first);
+    refs = std::move(globals[i].second);
+
+    LLVM_DEBUG(errs() << "SemiLocalFunAA: " << funP->getName();
+               errs() << " mods: ";
+               for (GlobalSet::iterator j = mods.begin(), e = mods.end();
+                    j != e; ++j) errs()
+               << (*j)->getName() << ", ";
+               errs() << '\n'; errs() << " refs: ";
+               for (GlobalSet::iterator j = refs.begin(), e = refs.end();
+                    j != e; ++j) errs()
+               << (*j)->getName() << ", ";
+               errs() << '\n';
+
+    );
   }
 
   return false;
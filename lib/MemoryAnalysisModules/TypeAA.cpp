@@ -12,6 +12,7 @@
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/TypeFinder.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/MathExtras.h"
@@ -37,6 +38,21 @@ class TypeAA : public ModulePass, public ClassicLoopAA {
                        ValueSet &noInfiniteLoops);
   static void findDefs(const Value *v, Values &defsOut);
 
+  /// A definition of a pointer: a GEP, and the
+  /// (sane) type of the object it indexes into.
+  struct GEPDef {
+    const GetElementPtrInst *gep;
+    Type *parentTy;
+  };
+  typedef SmallVector<GEPDef, 2> GEPDefs;
+
+  /// Definitions of each pointer queried so far, or an empty
+  /// list if some definition is not a GEP into a sane type.
+  /// Does not depend on the stack; survives uponStackChange().
+  DenseMap<const Value *, GEPDefs> defsCache;
+
+  const GEPDefs &getGEPDefs(const Value *v, const TypeSanityAnalysis &tsa);
+
 public:
   static char ID;
   TypeAA() : ModulePass(ID), ClassicLoopAA() {}
@@ -82,6 +98,8 @@ STATISTIC(numInsane, "Number of insane types identified.");
 STATISTIC(numNoAliases,
           "Number of no-alias results given because of sane typing.");
 STATISTIC(numQueries, "Number of AA queries passed to TypeAA.");
+STATISTIC(numContainers, "Number of container types precomputed.");
+STATISTIC(numDefsComputed, "Number of pointers whose definitions were found.");
 
 bool TypeAA::runOnModule(Module &mod) {
   const DataLayout &DL = mod.getDataLayout();
@@ -110,6 +128,14 @@ bool TypeSanityAnalysis::runOnModule(Module &mod) {
     runOnGlobalVariable(gv);
   }
 
+  // Now that the insane types are known, precompute the
+  // containment relation for every structure in the module.
+  TypeFinder structs;
+  structs.run(mod, false);
+  for (StructType *ty : structs)
+    getContainment(ty);
+  numContainers += containment.size();
+
   currentMod = 0;
   LLVM_DEBUG(errs() << "End TypeAA::runOnModule()\n");
   return false;
@@ -539,22 +565,39 @@ static bool definitelySame(const Value *v1, const Value *v2) {
   return false;
 }
 
-// Determine if the type 'element' could possibly
-// occupy space within an allocation unit of type
-// 'container'
-bool TypeSanityAnalysis::typeContainedWithin(Type *container,
-                                             Type *element) const {
-  if (container == element)
-    return true;
+unsigned TypeSanityAnalysis::getTypeId(Type *t) const {
+  auto i = typeIds.find(t);
+  if (i != typeIds.end())
+    return i->second;
 
-  if (!isSane(container))
-    return true; // conservative
+  const unsigned id = typeIds.size();
+  typeIds[t] = id;
+  return id;
+}
+
+// Collect the types which could possibly occupy
+// space within an allocation unit of type 'container'
+const TypeSanityAnalysis::Containment &
+TypeSanityAnalysis::getContainment(Type *container) const {
+  auto i = containment.find(container);
+  if (i != containment.end())
+    return i->second;
+
+  Containment result;
+  if (!isSane(container)) {
+    result.all = true; // conservative
+    return containment[container] = result;
+  }
 
+  const unsigned id = getTypeId(container);
+  result.contained.resize(id + 1);
+  result.contained.set(id);
+
+  SmallVector<Type *, 8> elements;
   StructType *structty = dyn_cast<StructType>(container);
   if (structty)
     for (unsigned i = 0; i < structty->getNumElements(); ++i)
-      if (typeContainedWithin(structty->getElementType(i), element))
-        return true;
+      elements.push_back(structty->getElementType(i));
 
   // Don't need to handle union types, because
   // union types are by definition not sane,
@@ -575,10 +618,39 @@ bool TypeSanityAnalysis::typeContainedWithin(Type *container,
   SequentialType *seqty = dyn_cast<SequentialType>(container);
   if (seqty)
     if (isa<ArrayType>(seqty) || isa<VectorType>(seqty))
-      if (typeContainedWithin(seqty->getElementType(), element))
-        return true;
+      elements.push_back(seqty->getElementType());
+
+  // Elements are laid out by value, so this cannot recur
+  // on the container itself.
+  for (Type *element : elements) {
+    const Containment &inner = getContainment(element);
+    if (inner.all) {
+      result.all = true;
+      result.contained.clear();
+      break;
+    }
+    result.contained |= inner.contained;
+  }
 
-  return false;
+  return containment[container] = std::move(result);
+}
+
+// Determine if the type 'element' could possibly
+// occupy space within an allocation unit of type
+// 'container'
+bool TypeSanityAnalysis::typeContainedWithin(Type *container,
+                                             Type *element) const {
+  if (container == element)
+    return true;
+
+  const Containment &c = getContainment(container);
+  if (c.all)
+    return true;
+
+  // Types without an ID were never reached from a container.
+  auto i = typeIds.find(element);
+  return i != typeIds.end() && i->second < c.contained.size() &&
+         c.contained.test(i->second);
 }
 
 void TypeAA::findDefs(const Value *v, Values &defsOut,
@@ -600,6 +672,37 @@ void TypeAA::findDefs(const Value *v, Values &defsOut) {
   findDefs(v, defsOut, visited);
 }
 
+const TypeAA::GEPDefs &TypeAA::getGEPDefs(const Value *v,
+                                          const TypeSanityAnalysis &tsa) {
+  auto i = defsCache.find(v);
+  if (i != defsCache.end())
+    return i->second;
+
+  ++numDefsComputed;
+  Values defs;
+  findDefs(v, defs);
+
+  GEPDefs result;
+  for (const Value *def : defs) {
+    const GetElementPtrInst *gep = dyn_cast<GetElementPtrInst>(def);
+    if (!gep) {
+      result.clear();
+      break;
+    }
+
+    const Value *parent = gep->getPointerOperand();
+    Type *parentty = dyn_cast<PointerType>(parent->getType())->getElementType();
+    if (!parentty || !tsa.isSane(parentty)) {
+      result.clear();
+      break;
+    }
+
+    result.push_back({gep, parentty});
+  }
+
+  return defsCache[v] = result;
+}
+
 LoopAA::AliasResult TypeAA::aliasCheck(const Pointer &P1, TemporalRelation rel,
                                        const Pointer &P2, const Loop *L,
                                        Remedies &R,
@@ -654,34 +757,24 @@ LoopAA::AliasResult TypeAA::aliasCheck(const Pointer &P1, TemporalRelation rel,
 
   // Specifically, we look for pointers
   // which are GEP instructions.
-  Values def1, def2;
-  findDefs(V1, def1);
-  findDefs(V2, def2);
+  // (Copies: the recursive queries below may grow the cache.)
+  const GEPDefs def1 = getGEPDefs(V1, tsa);
+  if (def1.empty())
+    return MayAlias;
+  const GEPDefs def2 = getGEPDefs(V2, tsa);
+  if (def2.empty())
+    return MayAlias;
 
   // For each possible pair (di,dj) of definition of V1, V2
-  for (Values::iterator i = def1.begin(), e = def1.end(); i != e; ++i) {
-    const Value *di = *i;
-    const GetElementPtrInst *gep_i = dyn_cast<GetElementPtrInst>(di);
-    if (!gep_i)
-      return MayAlias;
-
+  for (const GEPDef &di : def1) {
+    const GetElementPtrInst *gep_i = di.gep;
     const Value *parent_i = gep_i->getPointerOperand();
-    Type *parentty_i =
-        dyn_cast<PointerType>(parent_i->getType())->getElementType();
-    if (!parentty_i || !tsa.isSane(parentty_i))
-      return MayAlias;
-
-    for (Values::iterator j = def2.begin(), f = def2.end(); j != f; ++j) {
-      const Value *dj = *j;
-      const GetElementPtrInst *gep_j = dyn_cast<GetElementPtrInst>(dj);
-      if (!gep_j)
-        return MayAlias;
+    Type *parentty_i = di.parentTy;
 
+    for (const GEPDef &dj : def2) {
+      const GetElementPtrInst *gep_j = dj.gep;
       const Value *parent_j = gep_j->getPointerOperand();
-      Type *parentty_j =
-          dyn_cast<PointerType>(parent_j->getType())->getElementType();
-      if (!parentty_j || !tsa.isSane(parentty_j))
-        return MayAlias;
+      Type *parentty_j = dj.parentTy;
 
       // Cool, both definitions are GEPs into sane types.
       // Either they are the same type, or different type.
@@ -27,6 +27,7 @@
 
 #include <ctime>
 #include <set>
+#include <vector>
 
 using namespace llvm;
 using namespace arcana::noelle;
@@ -107,6 +108,7 @@ private:
   typedef generic_gep_type_iterator<User::const_op_iterator> GepTyIt;
   typedef DenseMap<PtrPtrKey, AliasResult> Cache;
   typedef DenseMap<PtrPtrKey, Remedies> CacheR;
+  typedef DenseMap<PtrPtrKey, unsigned> CacheConsulted;
 
   // Which functions have we already analyzed?
   ValueSet alreadyAnalyzed;
@@ -121,9 +123,27 @@ private:
   Cache cache;
   CacheR cacheR;
 
+  // Lowest stack position consulted by each entry.  Entries
+  // still being computed are MayAlias and consulted nothing.
+  CacheConsulted cacheConsulted;
+
   void uponStackChange() {
     cache.clear();
     cacheR.clear();
+    cacheConsulted.clear();
+  }
+
+  void uponStackChange(unsigned changed) {
+    std::vector<PtrPtrKey> affected;
+    for (auto &entry : cacheConsulted)
+      if (isAffected(entry.second, changed))
+        affected.push_back(entry.first);
+
+    for (const PtrPtrKey &key : affected) {
+      cache.erase(key);
+      cacheR.erase(key);
+      cacheConsulted.erase(key);
+    }
   }
 
   AccessPath *Unique(AccessPath *ap) {
@@ -506,7 +526,7 @@ public:
                        const Value *obj2, const Loop *L, Remedies &R,
                        time_t queryStart, unsigned Timeout,
                        DesiredAliasResult dAliasRes) {
-    LoopAA *top = getTopAA();
+    LoopAA *top = consultTopAA();
 
     AccessPath *ap1 = findPathForLoad(obj1);
     AccessPath *ap2 = findPathForLoad(obj2);
@@ -811,6 +831,7 @@ public:
       AliasResult result = cache[key];
       for (auto remed : cacheR[key])
         R.insert(remed);
+      noteConsulted(cacheConsulted[key]);
       INTROSPECT(EXIT(P1, Rel, P2, L, result));
       return result;
     }
@@ -824,6 +845,8 @@ public:
     // this will be fixed before we return.
     cache[key] = MayAlias;
     cacheR[key] = tmpR;
+    cacheConsulted[key] = NothingConsulted;
+    ConsultedScope consulted;
 
     analyzeParent(P1.ptr);
     analyzeParent(P2.ptr);
@@ -882,6 +905,7 @@ public:
     INTROSPECT(EXIT(P1, Rel, P2, L, result));
     cache[key] = result; // fix the cache.
     cacheR[key] = tmpR;
+    cacheConsulted[key] = consulted.getLowest();
 
     if (result == NoAlias || result == MustAlias) {
       for (auto remed : tmpR)
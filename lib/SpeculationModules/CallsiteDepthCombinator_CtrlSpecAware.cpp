@@ -11,6 +11,7 @@
 #include "scaf/Utilities/CallSiteFactory.h"
 
 #include <ctime>
+#include <vector>
 
 namespace liberty
 {
@@ -82,6 +83,38 @@ namespace liberty
     AU.setPreservesAll();        // Does not transform code
   }
 
+  // Keep the entries which did not consult the stack
+  // as low as the change.
+  void CallsiteDepthCombinator_CtrlSpecAware::uponStackChange(unsigned changed)
+  {
+    std::vector<IIKey> affected;
+    for(auto &entry : iiConsulted)
+      if( isAffected(entry.second, changed) )
+        affected.push_back(entry.first);
+
+    for(const IIKey &key : affected)
+    {
+      iiCache.erase(key);
+      iiCacheR.erase(key);
+      iiConsulted.erase(key);
+    }
+  }
+
+  void CallsiteDepthCombinator_CtrlSpecAware::uponLoopFinished(const Loop *L)
+  {
+    std::vector<IIKey> finished;
+    for(auto &entry : iiConsulted)
+      if( entry.first.L == L )
+        finished.push_back(entry.first);
+
+    for(const IIKey &key : finished)
+    {
+      iiCache.erase(key);
+      iiCacheR.erase(key);
+      iiConsulted.erase(key);
+    }
+  }
+
   static const Instruction *getToplevelInst(const CtxInst_CtrlSpecAware &ci)
   {
     const Instruction *inst = ci.getInst();
@@ -116,7 +149,7 @@ namespace liberty
   {
     ++numFlowTests;
 
-    LoopAA *top = kill.getTopAA();
+    LoopAA *top = kill.consultTopAA();
     INTROSPECT(errs() << "Test flow from " << write << " to " << read << " {\n");
 //      enterIntrospectionRegion(false);
     Remedies tmpR;
@@ -279,7 +312,7 @@ namespace liberty
   {
     ++numFlowTests;
 
-    LoopAA *top = kill.getTopAA();
+    LoopAA *top = kill.consultTopAA();
     INTROSPECT(errs() << "Test flow from " << write << " to " << read << " {\n");
 //      enterIntrospectionRegion(false);
     Remedies tmpR;
@@ -609,16 +642,19 @@ namespace liberty
       isFlow = iiCache[key];
       for (auto remed : iiCacheR[key])
         isFlowTmpR.insert(remed);
+      noteConsulted(iiConsulted[key]);
     }
 
     else
     {
+      ConsultedScope consulted;
       time_t queryStart=0;
       if( AnalysisTimeout > 0 )
         time(&queryStart);
       isFlow = iiCache[key] = doFlowSearchCrossIter(
           src, dst, L, *killflow, isFlowTmpR, 0, queryStart, AnalysisTimeout);
       iiCacheR[key] = isFlowTmpR;
+      iiConsulted[key] = consulted.getLowest();
       queryStart = 0;
     }
 
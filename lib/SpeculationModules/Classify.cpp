@@ -11,6 +11,7 @@
 #include "scaf/MemoryAnalysisModules/SimpleAA.h"
 //#include "scaf/SpeculationModules/LAMPLoadProfile.h"
 //#include "scaf/SpeculationModules/LampOracleAA.h"
+#include "scaf/SpeculationModules/LoopProf/TargetLoopHierarchy.h"
 #include "scaf/SpeculationModules/LoopProf/Targets.h"
 //#include "scaf/SpeculationModules/CommutativeLibsAA.h"
 #include "scaf/SpeculationModules/EdgeCountOracleAA.h"
@@ -24,6 +25,7 @@
 #include "scaf/SpeculationModules/Classify.h"
 #include "scaf/SpeculationModules/ControlSpeculator.h"
 #include "scaf/SpeculationModules/KillFlow_CtrlSpecAware.h"
+#include "scaf/SpeculationModules/LoopNestCacheAA.h"
 #include "scaf/SpeculationModules/PredictionSpeculator.h"
 #include "scaf/SpeculationModules/Read.h"
 #include "scaf/SpeculationModules/ProfilePerformanceEstimator.h"
@@ -36,6 +38,9 @@
 #include "scaf/Utilities/Timer.h"
 #include "scaf/Utilities/ReportDump.h"
 
+#include <algorithm>
+#include <iterator>
+#include <map>
 #include <set>
 
 namespace liberty
@@ -84,6 +89,7 @@ void Classify::getAnalysisUsage(AnalysisUsage &au) const
   au.addRequired<KillFlow_CtrlSpecAware>();
   au.addRequired<CallsiteDepthCombinator_CtrlSpecAware>();
   au.addRequired< Targets >();
+  au.addRequired< TargetLoopHierarchy >();
   au.addRequired< ProfilePerformanceEstimator >();
   au.setPreservesAll();
 }
@@ -141,6 +147,10 @@ bool Classify::runOnModule(Module &mod)
     SimpleAA simpleaa;
     simpleaa.InitializeLoopAA(this, mod.getDataLayout());
 
+    // Reuse facts between nested target loops
+    LoopNestCacheAA nestaa(getAnalysis< TargetLoopHierarchy >());
+    nestaa.InitializeLoopAA(this, mod.getDataLayout());
+
     KillFlow_CtrlSpecAware *killflow_aware =
         &getAnalysis<KillFlow_CtrlSpecAware>();
     CallsiteDepthCombinator_CtrlSpecAware *callsite_aware =
@@ -149,11 +159,19 @@ bool Classify::runOnModule(Module &mod)
     // Run on each loop.
     for(Targets::iterator i=targets.begin(mloops), e=targets.end(mloops); i!=e; ++i) {
       Loop *loop = *i;
+      if( !targets.isWithinBudget(this) )
+      {
+        errs() << "Time budget exhausted; not classifying loop "
+               << loop->getHeader()->getParent()->getName()
+               << "::" << loop->getHeader()->getName() << " or colder loops\n";
+        break;
+      }
       ctrlspec->setLoopOfInterest(loop->getHeader());
       predaa.setLoopOfInterest(loop);
       killflow_aware->setLoopOfInterest(ctrlspec, loop);
       callsite_aware->setLoopOfInterest(ctrlspec, loop);
       TIME("Classify loop", runOnLoop(loop));
+      classified.insert( loop->getHeader() );
     }
 
     // All the added AAs remove themselves from
@@ -284,45 +302,156 @@ static void strip_undefined_objects(HeapAssignment::ReduxAUSet &out)
   }
 }
 
-bool Classify::getLoopCarriedAUs(Loop *loop, const Ctx *ctx, AUs &aus,
+// One side (reads or writes) of the footprint of inst, without
+// NULL or UNDEFINED objects, sorted.  A callsite's footprint
+// covers every operation in its callees.
+static bool getFootprintAUs(const Read &spresults, const Instruction *inst,
+                            const Ctx *ctx, bool writes, AUs &out)
+{
+  AUs r, w;
+  ReduxAUs x;
+  if( !spresults.getFootprint(inst,ctx,r,w,x) )
+    return false;
+
+  out = writes ? w : r;
+  union_into(x, out);
+  strip_undefined_objects(out);
+  out.erase( std::remove_if(out.begin(), out.end(),
+                            [](AU *au) { return au->type == AU_Null; }),
+             out.end() );
+
+  std::sort(out.begin(), out.end());
+  out.erase( std::unique(out.begin(), out.end()), out.end() );
+  return true;
+}
+
+namespace
+{
+// Instructions grouped by one side of their footprint.
+// Those whose footprint cannot be determined share a
+// group whose footprint is unknown.
+struct FootprintGroups
+{
+  std::vector<AUs> footprints;
+  std::vector<bool> known;
+  std::vector< std::vector<Instruction*> > insts;
+
+  void add(Instruction *inst, bool success, AUs &aus)
+  {
+    std::pair<bool,AUs> key(success, AUs());
+    if( success )
+      key.second.swap(aus);
+
+    auto res = index.insert( std::make_pair(key, footprints.size()) );
+    if( res.second )
+    {
+      footprints.push_back(key.second);
+      known.push_back(success);
+      insts.emplace_back();
+    }
+    insts[ res.first->second ].push_back(inst);
+  }
+
+private:
+  std::map<std::pair<bool,AUs>, unsigned> index;
+};
+}
+
+bool Classify::getLoopCarriedAUs(Loop *loop, const Ctx *ctx,
+                                 HeapAssignment::AUSet &aus,
                                  HeapAssignment::AUToRemeds &auToRemeds) const {
   KillFlow &kill = getAnalysis< KillFlow >();
   PureFunAA &pure = getAnalysis< PureFunAA >();
   SemiLocalFunAA &semi = getAnalysis< SemiLocalFunAA >();
+  const Read &spresults = getAnalysis< ReadPass >().getProfileInfo();
   ControlSpeculation *ctrlspec = getAnalysis< ProfileGuidedControlSpeculator >().getControlSpecPtr();
   ctrlspec->setLoopOfInterest(loop->getHeader());
 
+  // Group the writes and the reads of the loop by their
+  // footprints, so that only pairs which touch a common
+  // object are searched for flows.
+  FootprintGroups writers, readers;
   for(Loop::block_iterator i=loop->block_begin(), e=loop->block_end(); i!=e; ++i)
   {
-    BasicBlock *srcbb = *i;
-    if( ctrlspec->isSpeculativelyDead(srcbb) )
+    BasicBlock *bb = *i;
+    if( ctrlspec->isSpeculativelyDead(bb) )
       continue;
 
-    for(BasicBlock::iterator j=srcbb->begin(), f=srcbb->end(); j!=f; ++j)
+    for(BasicBlock::iterator j=bb->begin(), f=bb->end(); j!=f; ++j)
     {
-      Instruction *src = &*j;
-      if( !src->mayWriteToMemory() )
+      Instruction *inst = &*j;
+      if( inst->mayWriteToMemory() )
+      {
+        AUs fp;
+        const bool success = getFootprintAUs(spresults, inst, ctx, true, fp);
+        if( !success || !fp.empty() )
+          writers.add(inst, success, fp);
+      }
+
+      if( inst->mayReadFromMemory() )
+      {
+        AUs fp;
+        const bool success = getFootprintAUs(spresults, inst, ctx, false, fp);
+        if( !success || !fp.empty() )
+          readers.add(inst, success, fp);
+      }
+    }
+  }
+
+  const unsigned numReaders = readers.footprints.size();
+  for(unsigned wg=0, numWriters=writers.footprints.size(); wg<numWriters; ++wg)
+  {
+    // The objects through which this group may flow to each reader
+    // group.  Once all of them are known to be loop-carried, there
+    // is nothing more to learn from those pairs.
+    std::vector<AUs> common(numReaders);
+    std::vector<bool> meets(numReaders, false);
+    for(unsigned rg=0; rg<numReaders; ++rg)
+    {
+      if( !writers.known[wg] || !readers.known[rg] )
+      {
+        meets[rg] = true;
         continue;
+      }
+
+      const AUs &w = writers.footprints[wg], &r = readers.footprints[rg];
+      std::set_intersection(w.begin(), w.end(), r.begin(), r.end(),
+                            std::back_inserter(common[rg]));
+      meets[rg] = !common[rg].empty();
+    }
+    if( std::find(meets.begin(), meets.end(), true) == meets.end() )
+      continue;
+
+    auto allFound = [&](unsigned rg) {
+      if( !writers.known[wg] || !readers.known[rg] )
+        return false;
+      for(AU *au : common[rg])
+        if( !aus.count(au) )
+          return false;
+      return true;
+    };
 
+    for(Instruction *src : writers.insts[wg])
+    {
       // Re-use this to speed it all up.
       ReverseStoreSearch search_src(src, kill, 0, 0, &pure, &semi);
 
-      for(Loop::block_iterator k=loop->block_begin(); k!=e; ++k)
+      for(unsigned rg=0; rg<numReaders; ++rg)
       {
-        BasicBlock *dstbb = *k;
-        if( ctrlspec->isSpeculativelyDead(dstbb) )
+        if( !meets[rg] )
           continue;
 
-        for(BasicBlock::iterator l=dstbb->begin(), h=dstbb->end(); l!=h; ++l)
+        for(Instruction *dst : readers.insts[rg])
         {
-          Instruction *dst = &*l;
-          if( !dst->mayReadFromMemory() )
-            continue;
+          if( allFound(rg) )
+            break;
 
           // There may be a cross-iteration flow from src to dst.
-          if (!getUnderlyingAUs(loop, search_src, src, ctx, dst, ctx, aus,
+          AUs found;
+          if (!getUnderlyingAUs(loop, search_src, src, ctx, dst, ctx, found,
                                 auToRemeds))
             return false;
+          aus.insert(found.begin(), found.end());
         }
       }
     }
@@ -1196,7 +1325,7 @@ bool Classify::runOnLoop(Loop *loop)
   localaa.InitializeLoopAA(this, fcn->getParent()->getDataLayout());
 
   // For each pair (write, read) in the loop.
-  AUs loopCarried;
+  HeapAssignment::AUSet loopCarried;
   HeapAssignment::AUToRemeds auToRemeds;
   if( !getLoopCarriedAUs(loop, ctx, loopCarried, auToRemeds) )
   {
@@ -1204,7 +1333,7 @@ bool Classify::runOnLoop(Loop *loop)
     return false;
   }
 
-  for(AUs::const_iterator i=loopCarried.begin(), e=loopCarried.end(); i!=e; ++i)
+  for(HeapAssignment::AUSet::const_iterator i=loopCarried.begin(), e=loopCarried.end(); i!=e; ++i)
     if( !localAUs.count( *i ) )
       if( !reductionAUs.count( *i ) )
         sharedAUs.insert( *i );
@@ -1413,6 +1542,11 @@ bool Classify::isAssigned(const Loop *L) const
   return assignments.count( L->getHeader() );
 }
 
+bool Classify::isClassified(const Loop *L) const
+{
+  return classified.count( L->getHeader() ) && isAssigned(L);
+}
+
 const HeapAssignment &Classify::getAssignmentFor(const Loop *L) const
 {
   Loop2Assignments::const_iterator i = assignments.find( L->getHeader() );
@@ -1885,6 +2019,8 @@ bool HeapAssignment::subOfAUSet(Ptrs &aus, const AUToRemeds &ausR) {
   return true;
 }
 
+unsigned HeapAssignment::nextCheapPrivVersion = 0;
+
 Remedies HeapAssignment::getRemedForPrivAUs(Ptrs &aus) const {
   Remedies allR;
   for (unsigned i = 0; i < aus.size(); ++i) {
@@ -1921,7 +2057,10 @@ HeapAssignment::AUSet &HeapAssignment::getPrivateAUs() { return privs; }
 HeapAssignment::AUSet &HeapAssignment::getKillPrivAUs() { return kill_privs; }
 HeapAssignment::AUSet &HeapAssignment::getSharePrivAUs() { return share_privs; }
 HeapAssignment::AUSet &HeapAssignment::getReadOnlyAUs() { return ros; }
-HeapAssignment::AUToRemeds &HeapAssignment::getCheapPrivAUs() { return cheap_privs; }
+HeapAssignment::AUToRemeds &HeapAssignment::getCheapPrivAUs() {
+  cheapPrivVersion = ++nextCheapPrivVersion;
+  return cheap_privs;
+}
 HeapAssignment::AUToRemeds &HeapAssignment::getNoWAWRemeds() { return no_waw_remeds; }
 HeapAssignment::ReduxAUSet &HeapAssignment::getReductionAUs() { return reduxs; }
 HeapAssignment::ReduxDepAUSet &HeapAssignment::getReduxDepAUs() { return reduxdeps; }
@@ -2092,6 +2231,7 @@ void HeapAssignment::contextRenamedViaClone(
   const AuToAuMap &amap)
 {
 //  errs() << "  . . - HeapAssignment::contextRenamedViaClone: " << *changedContext << '\n';
+  cheapPrivVersion = ++nextCheapPrivVersion;
 
   const ValueToValueMapTy::const_iterator vmap_end = vmap.end();
 
@@ -2175,6 +2315,8 @@ void Classify::contextRenamedViaClone(
     {
       const BasicBlock *new_header = cast< BasicBlock >( &*( j->second ) );
       new_asgns[ new_header ] = i->second;
+      if( classified.count(header) )
+        classified.insert(new_header);
     }
   }
 
@@ -55,6 +55,10 @@ Function *CommutativeLibsAA::getCalledFun(const Instruction *A) {
   return FunA;
 }
 
+LoopAA::RemedyRank CommutativeLibsAA::getMinRemedyRank() const {
+  return RemedyRank(false, false, DEFAULT_COMM_LIBS_REMED_COST);
+}
+
 LoopAA::ModRefResult CommutativeLibsAA::modref(const Instruction *A,
                                                TemporalRelation rel,
                                                const Value *ptrB,
@@ -0,0 +1,324 @@
+#define DEBUG_TYPE "compact-pdg"
+
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Instructions.h"
+
+#include "scaf/SpeculationModules/CompactPDG.hpp"
+#include "scaf/Utilities/Metadata.h"
+
+#include <algorithm>
+
+namespace liberty {
+using namespace llvm;
+using namespace arcana::noelle;
+
+bool SerializedRemedy::compare(const Remedy_ptr rhs) const {
+  std::shared_ptr<SerializedRemedy> serializedRhs =
+      std::static_pointer_cast<SerializedRemedy>(rhs);
+  if (cost != serializedRhs->cost)
+    return cost < serializedRhs->cost;
+  return ordinal < serializedRhs->ordinal;
+}
+
+CompactPDG::CompactPDG(Loop *L) : loop(L) {
+  for (BasicBlock *bb : loop->getBlocks())
+    for (Instruction &inst : *bb) {
+      index[&inst] = insts.size();
+      insts.push_back(&inst);
+    }
+}
+
+void CompactPDG::addEdge(unsigned kind, unsigned src, unsigned dst) {
+  assert(kind < NumKinds);
+  std::vector<unsigned> &row = rows[kind][src];
+  auto i = std::lower_bound(row.begin(), row.end(), dst);
+  if (i != row.end() && *i == dst)
+    return;
+  row.insert(i, dst);
+  ++numEdges[kind];
+}
+
+void CompactPDG::removeEdge(unsigned kind, unsigned src, unsigned dst) {
+  assert(kind < NumKinds);
+  auto r = rows[kind].find(src);
+  if (r == rows[kind].end())
+    return;
+
+  std::vector<unsigned> &row = r->second;
+  auto i = std::lower_bound(row.begin(), row.end(), dst);
+  if (i == row.end() || *i != dst)
+    return;
+
+  row.erase(i);
+  if (row.empty())
+    rows[kind].erase(r);
+  --numEdges[kind];
+  remedies.erase(remedyKey(kind, src, dst));
+}
+
+bool CompactPDG::hasEdge(unsigned kind, unsigned src, unsigned dst) const {
+  assert(kind < NumKinds);
+  auto r = rows[kind].find(src);
+  return r != rows[kind].end() &&
+         std::binary_search(r->second.begin(), r->second.end(), dst);
+}
+
+unsigned CompactPDG::getNumEdges(unsigned kind) const {
+  assert(kind < NumKinds);
+  return numEdges[kind];
+}
+
+int CompactPDG::firstSuccessor(unsigned kind, unsigned src) const {
+  auto r = rows[kind].find(src);
+  if (r == rows[kind].end())
+    return -1;
+  return r->second.front();
+}
+
+int CompactPDG::nextSuccessor(unsigned kind, unsigned src,
+                              unsigned prev) const {
+  auto r = rows[kind].find(src);
+  if (r == rows[kind].end())
+    return -1;
+
+  const std::vector<unsigned> &row = r->second;
+  auto i = std::upper_bound(row.begin(), row.end(), prev);
+  return i == row.end() ? -1 : *i;
+}
+
+void CompactPDG::setConservative(bool loopCarried, unsigned src,
+                                 unsigned dst) {
+  conservative.insert(conservativeKey(loopCarried, src, dst));
+}
+
+bool CompactPDG::isConservative(bool loopCarried, unsigned src,
+                                unsigned dst) const {
+  return conservative.count(conservativeKey(loopCarried, src, dst));
+}
+
+void CompactPDG::setRemedies(unsigned kind, unsigned src, unsigned dst,
+                             Remedies_ptr R) {
+  assert(hasEdge(kind, src, dst) && "Remedies for a non-existent edge");
+  remedies[remedyKey(kind, src, dst)] = R;
+}
+
+Remedies_ptr CompactPDG::getRemedies(unsigned kind, unsigned src,
+                                     unsigned dst) const {
+  auto i = remedies.find(remedyKey(kind, src, dst));
+  if (i == remedies.end())
+    return nullptr;
+  return i->second;
+}
+
+unsigned long CompactPDG::getCost(const Remedies &R) {
+  unsigned long cost = 0;
+  for (const Remedy_ptr &r : R)
+    cost += r->cost;
+  return cost;
+}
+
+std::unique_ptr<PDG> CompactPDG::toPDG(unsigned long budget) const {
+  auto pdg = std::make_unique<PDG>(loop);
+
+  for (unsigned kind = 0; kind < NumKinds; ++kind) {
+    if (rows[kind].empty())
+      continue;
+
+    const DepType dep = getDepType(kind);
+    const bool loopCarried = isLoopCarried(kind);
+
+    DataDependenceType data = DG_DATA_RAW;
+    if (getDataType(kind) == DataWAR)
+      data = DG_DATA_WAR;
+    else if (getDataType(kind) == DataWAW)
+      data = DG_DATA_WAW;
+
+    for (unsigned src = 0, N = insts.size(); src < N; ++src)
+      for (int dst = firstSuccessor(kind, src); dst >= 0;
+           dst = nextSuccessor(kind, src, dst)) {
+        Remedies_ptr R = getRemedies(kind, src, dst);
+        if (R && getCost(*R) < budget)
+          continue;
+
+        auto edge = pdg->addEdge((Value *)insts[src], (Value *)insts[dst]);
+
+        if (dep == CtrlDep)
+          edge->setControl(true);
+        else
+          edge->setMemMustType(dep == MemDep, dep == RegDep, data);
+        edge->setLoopCarried(loopCarried);
+
+        if (R) {
+          edge->addRemedies(R);
+          edge->setRemovable(true);
+        }
+      }
+  }
+
+  addExternalEdges(*pdg);
+  return pdg;
+}
+
+// Register dependences to live-outs and from live-ins.  These add the
+// external nodes of the PDG.
+void CompactPDG::addExternalEdges(PDG &pdg) const {
+  for (Instruction *inst : insts) {
+    for (auto &U : inst->uses()) {
+      auto user = U.getUser();
+      if (hasIndex(user))
+        continue;
+
+      if (isa<Instruction>(user) || isa<Argument>(user)) {
+        pdg.fetchOrAddNode(user, /*internal=*/false);
+
+        auto edge = pdg.addEdge((Value *)inst, (Value *)user);
+        edge->setMemMustType(false, true, DG_DATA_RAW);
+        edge->setLoopCarried(false);
+      }
+    }
+
+    for (User::op_iterator j = inst->op_begin(), z = inst->op_end(); j != z;
+         ++j) {
+      Value *operand = *j;
+
+      if (!hasIndex(operand) &&
+          (isa<Instruction>(operand) || isa<Argument>(operand))) {
+        pdg.fetchOrAddNode(operand, /*internal=*/false);
+
+        auto edge = pdg.addEdge(operand, (Value *)inst);
+        edge->setMemMustType(false, true, DG_DATA_RAW);
+      }
+    }
+  }
+}
+
+static const char *DepNames[] = {"mem", "reg", "ctrl"};
+static const char *DataNames[] = {"RAW", "WAR", "WAW"};
+
+bool CompactPDG::serialize(raw_ostream &os) const {
+  std::vector<int> ids;
+  ids.reserve(insts.size());
+  for (Instruction *inst : insts) {
+    int id = Namer::getInstrId(inst);
+    if (id < 0)
+      return false;
+    ids.push_back(id);
+  }
+
+  BasicBlock *header = loop->getHeader();
+  json::Object loopRecord{
+      {"loop", Namer::getBlkId(header)},
+      {"function", header->getParent()->getName()},
+      {"header", header->getName()},
+      {"insts", (int64_t)insts.size()},
+  };
+  os << json::Value(std::move(loopRecord)) << '\n';
+
+  for (unsigned kind = 0; kind < NumKinds; ++kind) {
+    if (rows[kind].empty())
+      continue;
+
+    const DepType dep = getDepType(kind);
+    for (unsigned src = 0, N = insts.size(); src < N; ++src)
+      for (int dst = firstSuccessor(kind, src); dst >= 0;
+           dst = nextSuccessor(kind, src, dst)) {
+        json::Object edge{
+            {"src", ids[src]},
+            {"dst", ids[dst]},
+            {"dep", DepNames[dep]},
+            {"lc", isLoopCarried(kind)},
+        };
+        if (dep == MemDep)
+          edge["type"] = DataNames[getDataType(kind)];
+
+        if (Remedies_ptr R = getRemedies(kind, src, dst)) {
+          json::Array remeds;
+          for (const Remedy_ptr &r : *R)
+            remeds.push_back(json::Object{
+                {"name", r->getRemedyName()},
+                {"cost", (int64_t)r->cost},
+            });
+          edge["remedies"] = std::move(remeds);
+        }
+
+        os << json::Value(std::move(edge)) << '\n';
+      }
+  }
+
+  return true;
+}
+
+int CompactPDG::getSerializedLoopId(const json::Object &record) {
+  if (auto id = record.getInteger("loop"))
+    return *id;
+  return -1;
+}
+
+bool CompactPDG::matchesSerializedLoop(const json::Object &record) const {
+  BasicBlock *header = loop->getHeader();
+  auto id = record.getInteger("loop");
+  auto n = record.getInteger("insts");
+  auto fcn = record.getString("function");
+  return id && *id == Namer::getBlkId(header) && n &&
+         *n == (int64_t)insts.size() && fcn &&
+         *fcn == header->getParent()->getName();
+}
+
+bool CompactPDG::deserializeEdge(const json::Object &record) {
+  if (namerIds.empty())
+    for (unsigned i = 0, N = insts.size(); i < N; ++i) {
+      int id = Namer::getInstrId(insts[i]);
+      if (id >= 0)
+        namerIds[id] = i;
+    }
+
+  auto srcId = record.getInteger("src");
+  auto dstId = record.getInteger("dst");
+  auto depName = record.getString("dep");
+  auto lc = record.getBoolean("lc");
+  if (!srcId || !dstId || !depName || !lc || *srcId < 0 || *dstId < 0)
+    return false;
+
+  auto src = namerIds.find(*srcId), dst = namerIds.find(*dstId);
+  if (src == namerIds.end() || dst == namerIds.end())
+    return false;
+
+  unsigned dep = 0;
+  while (dep < 3 && *depName != DepNames[dep])
+    ++dep;
+  if (dep == 3)
+    return false;
+
+  unsigned data = DataRAW;
+  if (dep == MemDep) {
+    auto dataName = record.getString("type");
+    if (!dataName)
+      return false;
+    while (data < 3 && *dataName != DataNames[data])
+      ++data;
+    if (data == 3)
+      return false;
+  }
+
+  const unsigned kind = getKind(DepType(dep), DataType(data), *lc);
+  addEdge(kind, src->second, dst->second);
+
+  if (const json::Array *remeds = record.getArray("remedies")) {
+    Remedies_ptr R = std::make_shared<Remedies>();
+    for (const json::Value &v : *remeds) {
+      const json::Object *remed = v.getAsObject();
+      if (!remed)
+        return false;
+      auto name = remed->getString("name");
+      auto cost = remed->getInteger("cost");
+      if (!name || !cost)
+        return false;
+      R->insert(std::make_shared<SerializedRemedy>(*name, *cost, R->size()));
+    }
+    setRemedies(kind, src->second, dst->second, R);
+  }
+
+  return true;
+}
+
+} // namespace liberty
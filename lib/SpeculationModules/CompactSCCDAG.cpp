@@ -0,0 +1,166 @@
+#define DEBUG_TYPE "compact-sccdag"
+
+#include "llvm/ADT/Statistic.h"
+
+#include "scaf/SpeculationModules/CompactSCCDAG.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace liberty {
+using namespace llvm;
+
+STATISTIC(numComputed, "Num SCCDAGs computed from compact PDGs");
+
+unsigned CompactSCCDAG::getKindMask(CompactPDG::DepType dep) {
+  unsigned mask = 0;
+  for (unsigned kind = 0; kind < CompactPDG::NumKinds; ++kind)
+    if (CompactPDG::getDepType(kind) == dep)
+      mask |= 1u << kind;
+  return mask;
+}
+
+CompactSCCDAG::CompactSCCDAG(const CompactPDG &pdg, unsigned kinds)
+    : sccOffsets(1, 0), succOffsets(1, 0) {
+  const unsigned N = pdg.getNumInstructions();
+  offsets.reserve(N + 1);
+  offsets.push_back(0);
+
+  std::vector<std::pair<unsigned, unsigned long>> out;
+  for (unsigned src = 0; src < N; ++src) {
+    out.clear();
+    for (unsigned kind = 0; kind < CompactPDG::NumKinds; ++kind) {
+      if (!(kinds & (1u << kind)))
+        continue;
+
+      for (int dst = pdg.firstSuccessor(kind, src); dst >= 0;
+           dst = pdg.nextSuccessor(kind, src, dst)) {
+        Remedies_ptr R = pdg.getRemedies(kind, src, dst);
+        out.push_back(
+            std::make_pair(dst, R ? CompactPDG::getCost(*R) : NotRemovable));
+      }
+    }
+
+    // One edge per destination; it is ignored only
+    // once every dependence it stands for is.
+    std::sort(out.begin(), out.end());
+    for (unsigned i = 0, M = out.size(); i < M; ++i) {
+      if (i + 1 < M && out[i + 1].first == out[i].first)
+        continue;
+      targets.push_back(out[i].first);
+      costs.push_back(out[i].second);
+    }
+    offsets.push_back(targets.size());
+  }
+}
+
+void CompactSCCDAG::compute(unsigned long budget) {
+  ++numComputed;
+  const unsigned N = getNumInstructions();
+
+  auto isKept = [&](unsigned edge) { return costs[edge] >= budget; };
+
+  // Tarjan's algorithm, without recursion.  Components are found
+  // in reverse topological order and renumbered at the end.
+  const unsigned unvisited = ~0U;
+  std::vector<unsigned> index(N, unvisited), lowlink(N);
+  std::vector<bool> onStack(N, false);
+  std::vector<unsigned> stack;
+  std::vector<std::pair<unsigned, unsigned>> dfs;
+  unsigned nextIndex = 0;
+
+  component.assign(N, unvisited);
+  members.clear();
+  sccOffsets.assign(1, 0);
+  recurrent.clear();
+
+  for (unsigned root = 0; root < N; ++root) {
+    if (index[root] != unvisited)
+      continue;
+
+    index[root] = lowlink[root] = nextIndex++;
+    stack.push_back(root);
+    onStack[root] = true;
+    dfs.push_back(std::make_pair(root, offsets[root]));
+
+    while (!dfs.empty()) {
+      const unsigned v = dfs.back().first;
+      if (dfs.back().second < offsets[v + 1]) {
+        const unsigned edge = dfs.back().second++;
+        if (!isKept(edge))
+          continue;
+
+        const unsigned w = targets[edge];
+        if (index[w] == unvisited) {
+          index[w] = lowlink[w] = nextIndex++;
+          stack.push_back(w);
+          onStack[w] = true;
+          dfs.push_back(std::make_pair(w, offsets[w]));
+        } else if (onStack[w])
+          lowlink[v] = std::min(lowlink[v], index[w]);
+        continue;
+      }
+
+      dfs.pop_back();
+      if (!dfs.empty()) {
+        const unsigned u = dfs.back().first;
+        lowlink[u] = std::min(lowlink[u], lowlink[v]);
+      }
+
+      if (lowlink[v] != index[v])
+        continue;
+
+      const unsigned id = recurrent.size();
+      const unsigned first = members.size();
+      unsigned w;
+      do {
+        w = stack.back();
+        stack.pop_back();
+        onStack[w] = false;
+        component[w] = id;
+        members.push_back(w);
+      } while (w != v);
+      sccOffsets.push_back(members.size());
+
+      bool cycle = members.size() - first > 1;
+      for (unsigned edge = offsets[v]; !cycle && edge < offsets[v + 1]; ++edge)
+        cycle = targets[edge] == v && isKept(edge);
+      recurrent.push_back(cycle);
+    }
+  }
+
+  // Reverse the numbering, so that it is topological.
+  const unsigned numSCCs = recurrent.size();
+  for (unsigned &c : component)
+    c = numSCCs - 1 - c;
+  std::reverse(recurrent.begin(), recurrent.end());
+
+  std::vector<unsigned> found(std::move(members)), foundOffsets(sccOffsets);
+  members.clear();
+  members.reserve(N);
+  sccOffsets.assign(1, 0);
+  for (unsigned scc = numSCCs; scc-- > 0;) {
+    auto begin = found.begin() + foundOffsets[scc];
+    auto end = found.begin() + foundOffsets[scc + 1];
+    std::sort(begin, end);
+    members.insert(members.end(), begin, end);
+    sccOffsets.push_back(members.size());
+  }
+
+  successors.clear();
+  succOffsets.assign(1, 0);
+  for (unsigned scc = 0; scc < numSCCs; ++scc) {
+    const unsigned first = successors.size();
+    for (unsigned inst : getMembers(scc))
+      for (unsigned edge = offsets[inst]; edge < offsets[inst + 1]; ++edge)
+        if (isKept(edge) && component[targets[edge]] != scc)
+          successors.push_back(component[targets[edge]]);
+
+    std::sort(successors.begin() + first, successors.end());
+    successors.erase(std::unique(successors.begin() + first, successors.end()),
+                     successors.end());
+    succOffsets.push_back(successors.size());
+  }
+}
+
+} // namespace liberty
@@ -36,17 +36,52 @@ bool ControlSpecRemedy::compare(const Remedy_ptr rhs) const {
   return this->brI < ctrlSpecRhs->brI;
 }
 
-// discover all the ctrl edges that cannot be speculated and populate
-// the unremovableCtrlDeps set
+void ControlSpecRemediator::addUnremovable(BitVector &m, const BasicBlock *src,
+                                           const BasicBlock *dst) {
+  auto i = blockIndex.find(src), j = blockIndex.find(dst);
+  assert(i != blockIndex.end() && j != blockIndex.end());
+  m.set(i->second * blockIndex.size() + j->second);
+}
+
+bool ControlSpecRemediator::isUnremovable(const Instruction *term,
+                                          const Instruction *inst) const {
+  const BasicBlock *src = term->getParent();
+  if (term != src->getTerminator())
+    return false;
+
+  auto i = blockIndex.find(src), j = blockIndex.find(inst->getParent());
+  if (i == blockIndex.end() || j == blockIndex.end())
+    return false;
+
+  if (unremovableAll.test(i->second))
+    return true;
+
+  const unsigned cell = i->second * blockIndex.size() + j->second;
+  if (unremovableBlocks.test(cell))
+    return true;
+
+  const PHINode *phi = dyn_cast<PHINode>(inst);
+  return phi && phi->getNumIncomingValues() != 1 && unremovablePHIs.test(cell);
+}
+
+// discover all the ctrl edges that cannot be speculated and record
+// them, per pair of blocks, in the unremovable tables
 // This code is almost identical to PDG::computeControlDeps
 void ControlSpecRemediator::processLoopOfInterest(Loop *l) {
   loop = l;
 
-  // clean up the unremovableCtrlDeps set from a previous loop
-  unremovableCtrlDeps.clear();
+  // clean up the tables from a previous loop
+  blockIndex.clear();
+  const unsigned N = loop->getNumBlocks();
+  for (unsigned i = 0; i < N; ++i)
+    blockIndex[loop->getBlocks()[i]] = i;
 
-  // build a partialEdgeSet that holds transitive II-ctrl dependence info
-  //EdgeSet IICtrlCache;
+  unremovableBlocks.clear();
+  unremovableBlocks.resize(N * N);
+  unremovablePHIs.clear();
+  unremovablePHIs.resize(N * N);
+  unremovableAll.clear();
+  unremovableAll.resize(N);
 
   // Detect intra-iteration control dependences that cannot be speculated
   LoopPostDom pdt(*speculator, loop);
@@ -59,28 +94,12 @@ void ControlSpecRemediator::processLoopOfInterest(Loop *l) {
     {
       ControlSpeculation::LoopBlock src = *j;
 
-      Instruction *term = src.getBlock()->getTerminator();
-      assert( !speculator->isSpeculativelyUnconditional(term)
+      assert( !speculator->isSpeculativelyUnconditional(src.getBlock()->getTerminator())
       && "Unconditional branches do not source control deps (ii)");
 
-      //Vertices::ID t = V.get(term);
-      for(BasicBlock::iterator k=dst.getBlock()->begin(), f=dst.getBlock()->end(); k!=f; ++k)
-      {
-        Instruction *idst = &*k;
-
-        /*
-        // Draw ctrl deps to:
-        //  (1) Operations with side-effects
-        //  (2) Conditional branches.
-        if( isSafeToSpeculativelyExecute(idst,td) )
-          continue;
-        */
-
-        //Vertices::ID s = V.get( idst );
-        //E.addIICtrl(t, s);
-        unremovableCtrlDeps[term].insert(idst);
-        //IICtrlCache.addIICtrl(t, s);
-      }
+      // Every operation of dst, including those that are
+      // safe to speculatively execute.
+      addUnremovable(unremovableBlocks, src.getBlock(), dst.getBlock());
     }
   }
 
@@ -94,7 +113,6 @@ void ControlSpecRemediator::processLoopOfInterest(Loop *l) {
   {
     BasicBlock *bb = *i;
     Instruction *term = bb->getTerminator();
-    //Vertices::ID t = V.get(term);
 
     // no control dependence can be formulated around unconditional branches
 
@@ -107,33 +125,11 @@ void ControlSpecRemediator::processLoopOfInterest(Loop *l) {
       if( !loop->contains(succ) )
         continue;
 
-      const bool loop_carried = (succ == loop->getHeader());
-
-      for(BasicBlock::iterator k=succ->begin(); k!=succ->end(); ++k)
-      {
-        PHINode *phi = dyn_cast<PHINode>(&*k);
-        if( !phi )
-          break;
-        if( phi->getNumIncomingValues() == 1 )
-          continue;
-        //Vertices::ID p = V.get(phi);
-
-        unremovableCtrlDeps[term].insert(phi);
-        //if( loop_carried )
-          //E.addLCCtrl(t,p);
-        //else
-          //E.addIICtrl(t,p);
-        //if ( !loop_carried )
-        //  IICtrlCache.addIICtrl(t, p);
-
-        //LLVM_DEBUG(errs() << "Unremovable ctrl dep between term " << *term << " and phi " << *phi << '\n' );
-      }
+      // The PHIs of succ with more than one incoming value
+      addUnremovable(unremovablePHIs, bb, succ);
     }
   }
 
-  // build a partialEdgeSet that holds transitive II-ctrl dependence info
-  //buildTransitiveIntraIterationControlDependenceCache(IICtrlCache, V);
-
   // Add loop-carried control dependences.
   // Foreach loop-exit.
   typedef ControlSpeculation::ExitingBlocks Exitings;
@@ -143,49 +139,11 @@ void ControlSpecRemediator::processLoopOfInterest(Loop *l) {
   for(Exitings::iterator i=exitings.begin(), e=exitings.end(); i!=e; ++i)
   {
     BasicBlock *exiting = *i;
-    Instruction *term = exiting->getTerminator();
-    assert( !speculator->isSpeculativelyUnconditional(term)
+    assert( !speculator->isSpeculativelyUnconditional(exiting->getTerminator())
     && "Unconditional branches do not source control deps (lc)");
 
-    //Vertices::ID t = V.get(term);
-
-    // Draw ctrl deps to:
-    //  (1) Operations with side-effects
-    //  (2) Loop exits.
-    for(Loop::block_iterator j=loop->block_begin(), z=loop->block_end(); j!=z; ++j)
-    {
-      BasicBlock *dst = *j;
-      for(BasicBlock::iterator k=dst->begin(), g=dst->end(); k!=g; ++k)
-      {
-        Instruction *idst = &*k;
-
-        /*
-        // Draw ctrl deps to:
-        //  (1) Operations with side-effects
-        //  (2) Loop exits
-        if( isSafeToSpeculativelyExecute(idst,td) )
-          continue;
-        */
-
-        /*
-        if( idst->isTerminator() )
-          if( ! speculator->mayExit(tt,loop) )
-            continue;
-        */
-
-        //Vertices::ID s = V.get( idst );
-
-        // Draw LC ctrl dep only when there is no (transitive) II ctrl dep from t to s
-
-        //if ( hasTransitiveIntraIterationControlDependence(t, s) )
-        //if ( IICtrlCache.hasEdge(t, s) )
-        //  continue;
-
-        //E.addLCCtrl(t, s);
-        unremovableCtrlDeps[term].insert(idst);
-        //LLVM_DEBUG(errs() << "Unremovable ctrl dep between term " << *term << " and idst " << *idst << '\n' );
-      }
-    }
+    // Draw ctrl deps to every operation of the loop.
+    unremovableAll.set(blockIndex[exiting]);
   }
 }
 
@@ -261,13 +219,10 @@ Remediator::RemedResp ControlSpecRemediator::ctrldep(const Instruction *A,
     // check if the control speculator was able to remove the control
     // dependence when it preprocesed the loop
 
-    if (unremovableCtrlDeps.count(A)) {
-      auto &unremCtrlDepsFromA = unremovableCtrlDeps[A];
-      if (unremCtrlDepsFromA.count(B)) {
-        // unable to remove this ctrl dep
-        remedResp.remedy = remedy;
-        return remedResp;
-      }
+    if (isUnremovable(A, B)) {
+      // unable to remove this ctrl dep
+      remedResp.remedy = remedy;
+      return remedResp;
     }
   }
 
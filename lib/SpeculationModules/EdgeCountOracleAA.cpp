@@ -25,6 +25,11 @@ using namespace arcana::noelle;
 STATISTIC(numQueries,          "Num queries in cntr spec AA");
 STATISTIC(numNoModRef,         "Num no-mod-ref results in cntr spec AA");
 
+LoopAA::RemedyRank EdgeCountOracle::getMinRemedyRank() const
+{
+  return RemedyRank(false, false, DEFAULT_CTRL_REMED_COST);
+}
+
 LoopAA::ModRefResult EdgeCountOracle::modref(
   const Instruction *A,
   TemporalRelation rel,
@@ -31,6 +31,8 @@ Ctx *FoldManager::fold(Ctx *c)
   Ctx *c0 = ctxManager.GetOrInsertNode(c);
   if( c0 != c )
     delete c;
+  else
+    c0->computeEncoding();
 
   return c0;
 }
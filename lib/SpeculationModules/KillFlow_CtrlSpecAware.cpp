@@ -91,7 +91,7 @@ STATISTIC(numBBSummaryHits,                "Number of block summary hits");
 
     Remedies R;
 
-    LoopAA *top = getEffectiveTopAA();
+    LoopAA *top = consultEffectiveTopAA();
     ++numSubQueries;
     return top->alias(storeptr, 1, Same, loadptr, 1, 0, R,
                       LoopAA::DMustAlias) == LoopAA::MustAlias;
@@ -153,6 +153,7 @@ STATISTIC(numBBSummaryHits,                "Number of block summary hits");
       if( fcnKills.count(key) )
       {
         ++numFcnSummaryHits;
+        noteCacheHit();
         return fcnKills[key];
       }
 
@@ -172,6 +173,7 @@ STATISTIC(numBBSummaryHits,                "Number of block summary hits");
         {
           // Memoize for later.
           fcnKills[key] = true;
+          noteCacheFilled();
 
           LLVM_DEBUG(errs() << "\t(in block " << *bb << ")\n");
 //          INTROSPECT(errs() << "\tYes\n");
@@ -180,6 +182,7 @@ STATISTIC(numBBSummaryHits,                "Number of block summary hits");
       }
 
       fcnKills[key] = false;
+      noteCacheFilled();
 //      INTROSPECT(errs() << "\tNo\n");
       return false;
     }
@@ -203,6 +206,15 @@ STATISTIC(numBBSummaryHits,                "Number of block summary hits");
     fcnKills.clear();
     bbKills.clear();
     noStoresBetween.clear();
+    cachesConsulted = NothingConsulted;
+  }
+
+  // The caches are not tracked per entry; keep them all
+  // unless some entry may have consulted the change.
+  void KillFlow_CtrlSpecAware::uponStackChange(unsigned changed)
+  {
+    if( isAffected(cachesConsulted, changed) )
+      uponStackChange();
   }
 
   BasicBlock *KillFlow_CtrlSpecAware::getLoopEntryBB(const Loop *loop) {
@@ -514,6 +526,7 @@ STATISTIC(numBBSummaryHits,                "Number of block summary hits");
           bool noStoreBetween;
           if (noStoresBetween.count(ikey)) {
             noStoreBetween = noStoresBetween[ikey];
+            noteCacheHit();
           } else {
             const Instruction *noExtNumOfElemI =
                 dyn_cast<Instruction>(bypassExtInsts(numOfElemI));
@@ -524,6 +537,7 @@ STATISTIC(numBBSummaryHits,                "Number of block summary hits");
             noStoreBetween = noStoreInBetween(noExtNumOfElemI, noExtKillLimitI,
                                               srcs, *mloops);
             noStoresBetween[ikey] = noStoreBetween;
+            noteCacheFilled();
           }
           if (!noStoreBetween)
             return false;
@@ -636,12 +650,14 @@ STATISTIC(numBBSummaryHits,                "Number of block summary hits");
       if( !bbKills[key] )
       {
         ++numBBSummaryHits;
+        noteCacheHit();
         return false;
       }
 
       if( bb != beforebb && bb != afterbb)
       {
         ++numBBSummaryHits;
+        noteCacheHit();
         return bbKills[key];
       }
     }
@@ -682,6 +698,7 @@ STATISTIC(numBBSummaryHits,                "Number of block summary hits");
       {
         LLVM_DEBUG(errs() << "\t(in inst " << *inst << ")\n");
         bbKills[key] = true;
+        noteCacheFilled();
 
         return true;
       }
@@ -791,7 +808,10 @@ STATISTIC(numBBSummaryHits,                "Number of block summary hits");
     }
 
     if( bb != beforebb && bb != afterbb )
+    {
       bbKills[key] = false;
+      noteCacheFilled();
+    }
 
     return false;
   }
@@ -838,7 +858,8 @@ STATISTIC(numBBSummaryHits,                "Number of block summary hits");
   }
 
   KillFlow_CtrlSpecAware::KillFlow_CtrlSpecAware()
-      : ModulePass(ID), fcnKills(), bbKills(), noStoresBetween(), mloops(0),
+      : ModulePass(ID), fcnKills(), bbKills(), noStoresBetween(),
+        cachesConsulted(NothingConsulted), mloops(0),
         effectiveNextAA(0), effectiveTopAA(0), specDT{nullptr}, specPDT{nullptr}, tgtLoop{nullptr} {}
 
   KillFlow_CtrlSpecAware::~KillFlow_CtrlSpecAware() {}
@@ -856,7 +877,7 @@ STATISTIC(numBBSummaryHits,                "Number of block summary hits");
     // Do not want to pollute remedies with more expensive-to-validate modules
     // chain after trying to respond
     /*
-    ModRefResult res = getEffectiveNextAA()->modref(i1,Rel,i2,L,R);
+    ModRefResult res = consultEffectiveNextAA()->modref(i1,Rel,i2,L,R);
     INTROSPECT(errs() << "lower in the stack reports res=" << res << '\n');
     if( res == Ref || res == NoModRef )
     {
@@ -878,7 +899,7 @@ STATISTIC(numBBSummaryHits,                "Number of block summary hits");
     if( !L )
     {
       INTROSPECT(EXIT(i1,Rel,i2,L,res));
-      return getEffectiveNextAA()->modref(i1,Rel,i2,L,R);
+      return consultEffectiveNextAA()->modref(i1,Rel,i2,L,R);
     }
 
     std::shared_ptr<ControlSpecRemedy> remedy =
@@ -967,7 +988,7 @@ STATISTIC(numBBSummaryHits,                "Number of block summary hits");
       if (res != NoModRef) {
         Remedies tmpR;
         ModRefResult nextRes =
-            getEffectiveNextAA()->modref(i1, Rel, i2, L, tmpR);
+            consultEffectiveNextAA()->modref(i1, Rel, i2, L, tmpR);
         if (ModRefResult(res & nextRes) != res) {
           for (auto remed : tmpR)
             R.insert(remed);
@@ -1140,7 +1161,7 @@ STATISTIC(numBBSummaryHits,                "Number of block summary hits");
     INTROSPECT(EXIT(i1,Rel,i2,L,res));
     if (res != NoModRef) {
       Remedies tmpR;
-      ModRefResult nextRes = getEffectiveNextAA()->modref(i1, Rel, i2, L, tmpR);
+      ModRefResult nextRes = consultEffectiveNextAA()->modref(i1, Rel, i2, L, tmpR);
       if (ModRefResult(res & nextRes) != res) {
         for (auto remed : tmpR)
           R.insert(remed);
@@ -33,6 +33,9 @@
 #include <utility>
 #include <sys/stat.h>
 #include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
 #include <vector>
 
 #include "scaf/SpeculationModules/LAMP/LAMPLoadProfile.h"
@@ -62,6 +65,16 @@ static cl::opt<bool> AssertIfLoadFails(
     cl::init(false),
     cl::Hidden,
     cl::desc("Assert if fail to load LAMP profile"));
+static cl::opt<bool> WriteReports(
+    "lamp-write-reports",
+    cl::init(false),
+    cl::NotHidden,
+    cl::desc("Write human-readable dependence reports (" LCOUTFILE ", " DOUTFILE ", " AUXFILE ")"));
+static cl::opt<std::string> BinaryProfileFileName(
+    "lamp-write-binary-profile",
+    cl::init(""),
+    cl::NotHidden,
+    cl::desc("Save the loaded LAMP profile in binary format to this file"));
 static cl::opt<bool> IgnoreLAMP(
     "lamp-ignore",
     cl::init(false),
@@ -96,10 +109,7 @@ static bool IdInitFlag = false;
 
 inline unsigned int str_to_int(std::string& s)
 {
-  std::istringstream iss(s);
-  unsigned int t;
-  iss >> t;
-  return t;
+  return strtoul(s.c_str(), 0, 10);
 }
 
 namespace {
@@ -264,6 +274,278 @@ namespace { static RegisterPass<LAMPLoadProfile> RP3(
     "lamp-load-profile",
     "(LAMPLoad) Load back profile data and generate dependency information", false, false); }
 
+namespace {
+  /* One dependence observed by the LAMP profiler, keyed by LAMP ids.
+   * This is also the on-disk layout of the binary profile. */
+  struct LAMPRecord
+  {
+    uint32_t i1_id;
+    uint32_t i2_id;
+    uint32_t loop_id;
+    uint32_t cross_iter;
+    uint64_t times;   /* Number of times the dependence manifested */
+    uint64_t iters;   /* Number of iterations of the loop that the dependence manifested */
+  };
+  typedef std::vector<LAMPRecord> LAMPRecords;
+}
+
+static_assert(sizeof(LAMPRecord) == 32, "LAMPRecord must have no padding");
+
+/* Binary profile layout (host byte order):
+ *   magic[8]
+ *   uint32 number of loops, uint32 byte order mark, uint64 number of records
+ *   uint32 iteration count of each loop
+ *   LAMPRecord for each record
+ *
+ * The byte order mark is written as LAMPByteOrderMark; a profile
+ * written on a host of the other byte order is rejected. */
+static const char LAMPBinaryMagic[8] = {'L','A','M','P','B','I','N','1'};
+static const uint32_t LAMPByteOrderMark = 0x01020304;
+
+static Instruction *lookupInst(const std::map<unsigned int, Instruction*> &IdToInstMap, unsigned int id)
+{
+  std::map<unsigned int, Instruction*>::const_iterator i = IdToInstMap.find(id);
+  if (i == IdToInstMap.end())
+    return 0;
+  return i->second;
+}
+
+static bool readTextProfile(std::ifstream &ifs, std::vector<unsigned int> &itercounts, LAMPRecords &records)
+{
+  std::string s;
+
+  // Get rid of the 'worthless' things in the results file
+  while (true)
+  {
+    // To handle dynamic numbers of loops, break out early when we hit the end
+    // of the loop section, clears out the 'BEGIN Memory Profile' line
+    if (ifs >> s) {
+      if(s == "BEGIN")
+      {
+        ifs >> s;
+        ifs >> s;
+        break;
+      }
+      ifs >> s;
+      itercounts.push_back(str_to_int(s));
+    }
+    else
+      return false;
+  }
+
+  unsigned int num_cnt = 0;
+  LAMPRecord rec = {0, 0, 0, 0, 0, 0};
+  while (ifs >> s)
+  {
+    // String Operation
+    // (1) discard string with ")"
+    // (2) erase "(" in the string
+    if (s.find_first_of(")") != std::string::npos) continue;
+
+    size_t found_leftP = s.find_first_of("(");
+    if (found_leftP != std::string::npos){
+      assert(found_leftP == 0);        // "(" always 1st character
+      s.erase(0,1);
+    }
+    if (s.find("END") != std::string::npos) break;
+
+    ++num_cnt;
+    unsigned int num = str_to_int(s);
+
+    switch (num_cnt % 6) { //6  numbers in each line (result.lamp.profile)
+      case 1: rec.i1_id = num;      break;
+      case 2: rec.cross_iter = num; break;
+      case 3: rec.loop_id = num;    break;
+      case 4: rec.i2_id = num;      break;
+      case 5: rec.times = num;      break;
+      case 0:
+        rec.iters = num;
+        records.push_back(rec);
+        break;
+    }
+  }
+
+  return true;
+}
+
+static bool readBinaryProfile(std::ifstream &ifs, std::vector<unsigned int> &itercounts, LAMPRecords &records)
+{
+  // The magic number has already been consumed.
+  uint32_t numLoops = 0, byteOrder = 0;
+  uint64_t numRecords = 0;
+  ifs.read((char*) &numLoops, sizeof(numLoops));
+  ifs.read((char*) &byteOrder, sizeof(byteOrder));
+  ifs.read((char*) &numRecords, sizeof(numRecords));
+  if (!ifs)
+  {
+    errs() << "LAMP binary profile: truncated header\n";
+    return false;
+  }
+
+  if (byteOrder != LAMPByteOrderMark)
+  {
+    errs() << "LAMP binary profile: written with another byte order\n";
+    return false;
+  }
+
+  // Do not trust the counts with an allocation before
+  // checking that the file is long enough to hold them.
+  const std::streampos start = ifs.tellg();
+  ifs.seekg(0, std::ios::end);
+  const uint64_t remaining = ifs.tellg() - start;
+  ifs.seekg(start);
+
+  const uint64_t countsSize = (uint64_t) numLoops * sizeof(uint32_t);
+  if (countsSize > remaining
+      || numRecords > (remaining - countsSize) / sizeof(LAMPRecord))
+  {
+    errs() << "LAMP binary profile: header claims " << numLoops << " loops and "
+           << numRecords << " records, more than the file holds\n";
+    return false;
+  }
+
+  std::vector<uint32_t> counts(numLoops);
+  ifs.read((char*) counts.data(), countsSize);
+  itercounts.assign(counts.begin(), counts.end());
+
+  records.resize(numRecords);
+  ifs.read((char*) records.data(), numRecords * sizeof(LAMPRecord));
+
+  if (!ifs)
+  {
+    errs() << "LAMP binary profile: short read\n";
+    return false;
+  }
+  return true;
+}
+
+static void writeBinaryProfile(const std::string &filename, const std::vector<unsigned int> &itercounts, const LAMPRecords &records)
+{
+  std::ofstream ofs(filename.c_str(), std::ios::out | std::ios::binary);
+  if (!ofs)
+  {
+    errs() << "Cannot write LAMP binary profile " << filename << '\n';
+    return;
+  }
+
+  uint32_t numLoops = itercounts.size(), byteOrder = LAMPByteOrderMark;
+  uint64_t numRecords = records.size();
+  ofs.write(LAMPBinaryMagic, sizeof(LAMPBinaryMagic));
+  ofs.write((const char*) &numLoops, sizeof(numLoops));
+  ofs.write((const char*) &byteOrder, sizeof(byteOrder));
+  ofs.write((const char*) &numRecords, sizeof(numRecords));
+
+  std::vector<uint32_t> counts(itercounts.begin(), itercounts.end());
+  ofs.write((const char*) counts.data(), numLoops * sizeof(uint32_t));
+  ofs.write((const char*) records.data(), numRecords * sizeof(LAMPRecord));
+
+  LLVM_DEBUG(errs() << "Wrote LAMP binary profile " << filename << '\n');
+}
+
+/* Print a name for the address accessed by the load or store 'inst'
+ * into a text report, and remember candidate names for AUXFILE. */
+static void reportOperand(std::ofstream &file, Instruction *inst, int list, unsigned int loop_id, unsigned &line)
+{
+  line = 0;
+  if (!isa<LoadInst>(inst) && !isa<StoreInst>(inst))
+    return;
+
+  std::string fnName = inst->getParent()->getParent()->getName().str();
+  std::string bbName = inst->getParent()->getName().str();
+
+  Value * myV;
+  if (isa<LoadInst>(inst))
+    myV = dyn_cast<LoadInst>(inst)->getPointerOperand();
+  else
+    myV = dyn_cast<StoreInst>(inst)->getPointerOperand();
+  Instruction * myI = inst;
+
+  const DebugLoc & DSI = myI->getDebugLoc();
+  if(DSI)
+    line = DSI.getLine();
+  else
+    LLVM_DEBUG(errs() << "No DSI\n");
+
+  while (myV->getName().str() == "")
+  {
+    if (!myI || myI->getNumOperands() == 0)
+      break;
+
+    if (isa<LoadInst>(myI))
+    {
+      myV = dyn_cast<LoadInst>(myI)->getPointerOperand();
+      myI = dyn_cast<Instruction>(myV);
+    }
+    else if (isa<StoreInst>(myI))
+    {
+      myV = dyn_cast<StoreInst>(myI)->getPointerOperand();
+      myI = dyn_cast<Instruction>(myV);
+    }
+    else if (myI->getNumOperands() == 1)
+    {
+      myV = myI->getOperand(0);  // try it anyway ???
+      myI = dyn_cast<Instruction>(myV);
+    }
+    else
+    {  // should recurse in multiple directions here
+      LLVM_DEBUG(errs() << "attempting recurse\t" << *inst << "\n");
+      globLoop = loop_id;
+      ISet avoidInfiniteRecursion;
+      recurseOperands(myI, fnName, bbName, list, line, avoidInfiniteRecursion);
+      needCheck++;
+      break;
+    }
+  }
+
+  if (myV->getName().str() == "")
+    file << "##ORIG";
+  file << myV->getName().str();
+  addToList(myV->getName().str(), fnName, bbName, list, line);
+}
+
+/* Append one line to LCOUTFILE (lc=1) or DOUTFILE (lc=0):
+ * [var1 @ function * bbname -- var2 @ function * bbname] line1#line2# LAMPdata Loop: LoopID LAMPdata */
+static void reportDependence(std::ofstream &file, int lc, Instruction *temp1, Instruction *temp2,
+    const LAMPRecord &rec, BasicBlock *BB, unsigned int itercount, unsigned int numDepLoops)
+{
+  unsigned ln1, ln2;
+
+  file << "[";
+  reportOperand(file, temp1, 1, rec.loop_id, ln1);
+  file << " @ " << temp1->getParent()->getParent()->getName().str()
+    << " * " << temp1->getParent()->getName().str() << " -- ";
+  reportOperand(file, temp2, 2, rec.loop_id, ln2);
+  file << " @ " << temp2->getParent()->getParent()->getName().str()
+    << " * " << temp2->getParent()->getName().str() << "]\t";
+
+  if (ln1 == 0)
+    file << "UNKNOWN";
+  else
+    file << ln1;
+  file << "#";
+
+  if (ln2 == 0)
+    file << "UNKNOWN";
+  else
+    file << ln2;
+  file << "#\t";
+
+  file << temp1 << " " << temp2 << " ID:" << rec.i1_id << " " << rec.i2_id
+    << " Loop:" << rec.loop_id << " " << "(" << BB << ")";
+
+  file << " T:" << rec.times << " P:" << (double)(rec.times) / itercount
+    << "  " << numDepLoops;
+
+  if (needCheck != 0)
+    dumpListToFile(lc);
+  else
+    purgeList();
+
+  if (rec.iters != 0)
+    file << " Tl:" << rec.iters << " Pl:" << (double)(rec.iters) / itercount;
+  file << '\n';
+}
+
 bool LAMPLoadProfile::runOnModule(Module& M)
 {
   assert(IdInitFlag && "Need to run lamp-map-loop pass first!");
@@ -354,666 +636,114 @@ bool LAMPLoadProfile::runOnModule(Module& M)
     return false;
   }
 
-  ifs.open(ProfileFileName.c_str());
+  ifs.open(ProfileFileName.c_str(), std::ios::in | std::ios::binary);
   LLVM_DEBUG(errs() << "Opened " << ProfileFileName << "\n");
 
-  std::string s;
-
-  // Get rid of the 'worthless' things in the results file
   //unsigned int itercounts[MAX_LOOPS] = {0};
   std::vector<unsigned int> itercounts;
-  unsigned loopCount = 0;
-  while (true)
+  LAMPRecords records;
+
+  // The binary format is recognized by its magic number;
+  // anything else is parsed as the profiler's text output.
+  char magic[sizeof(LAMPBinaryMagic)] = {0};
+  ifs.read(magic, sizeof(magic));
+  bool isBinary = ifs.gcount() == sizeof(magic)
+    && std::equal(magic, magic + sizeof(magic), LAMPBinaryMagic);
+  if (!isBinary)
   {
-    // To handle dynamic numbers of loops, break out early when we hit the end
-    // of the loop section, clears out the 'BEGIN Memory Profile' line
-    if (ifs >> s) {
-      if(s == "BEGIN")
-      {
-        ifs >> s;
-        ifs >> s;
-        break;
-      }
-      ifs >> s;
-      itercounts.push_back(str_to_int(s));
-      loopCount++;
-    }
-    else {
-      LLVM_DEBUG(errs() << "LAMP profile incomplete\n");
-      return false;
-    }
+    ifs.clear();
+    ifs.seekg(0);
   }
 
-  std::ofstream lcfile(LCOUTFILE);
-  std::ofstream dfile(DOUTFILE);
-  auxfile.open(AUXFILE);
-
-  lcfile << "#File produced by LAMP Load Profiling pass\n";
-  lcfile << "#This file contains information on loop-carried dependences\n";
-  lcfile << "#[var1 @ function * bbname -- var2 @ function * bbname] line1#line2# LAMPdata Loop: LoopID LAMPdata\n";
-  lcfile << "#var1 depends on var2\n";
-  dfile << "#File produced by LAMP Load Profiling pass\n";
-  dfile << "#This file contains information on intra-iteration dependences\n";
-  dfile << "#[var1 @ function * bbname -- var2 @ function * bbname] line1#line2# LAMPdata Loop: LoopID LAMPdata\n";
-  dfile << "#var1 depends on var2\n";
-  auxfile << "#File produced by LAMP Load Profiling pass\n";
-  auxfile << "#This file contains information on loop-caried and intra-iteration dependences where recursion worked to find variable names in the LAMP Reader\n";
-  auxfile << "#[var1 @ function * bbname -- var2 @ function * bbname] line1#line2# Loop: LoopID\n";
-  auxfile << "#var1 depends on var2\n";
-
-  int i = 0, j = 0;
-  unsigned int lctotal = 0;
-  unsigned int dtotal = 0;
-  unsigned int num_cnt = 0;
-  unsigned int num, i1_id=0, i2_id=0, cross_iter=0, loop_id=0, times=0;
+  bool loaded = isBinary
+    ? readBinaryProfile(ifs, itercounts, records)
+    : readTextProfile(ifs, itercounts, records);
+  ifs.close();
 
-  BasicBlock* BB = nullptr;
-  std::map<BasicBlock*, InstPairSet >::iterator iter;
-  while (ifs >> s)
+  if (!loaded)
   {
-    size_t found_leftP;   // (
-    size_t found_rightP;  // )
-
-    // String Operation
-    // (1) discard string with ")"
-    // (2) erase "(" in the string
-
-    found_rightP = s.find_first_of(")");
-    if (found_rightP !=  std::string::npos) continue;
-
-    found_leftP = s.find_first_of("(");
-    if (found_leftP !=  std::string::npos){
-      assert(found_leftP == 0);        // "(" always 1st character
-      s.erase(0,1);
-    }
-    if (s.find("END") != std::string::npos) break;
-
-    ++num_cnt;
-    num = str_to_int(s);
-    // LLVM_DEBUG(errs() << "Read: " << num);
-
-    switch (num_cnt % 6) { //6  numbers in each line (result.lamp.profile)
-      case 1:
-        i1_id = num;
-        break;
-      case 2:
-        cross_iter = num;
-        break;
-      case 3:
-        loop_id = num;
-        break;
-      case 4:
-        i2_id = num;
-        break;
-      case 5:
-        times = num;
-        if (cross_iter) {
-          if ( IdToInstMap[i1_id] != NULL && IdToInstMap[i2_id] !=NULL  )
-          {
-            InstPair dep_inst_pair;
-            dep_inst_pair.first  = Namer::getInstrId(IdToInstMap[i1_id]);
-            dep_inst_pair.second = Namer::getInstrId(IdToInstMap[i2_id]);
-
-            /*
-               InstPair* dep_inst_pair_ptr2 = new InstPair;
-               dep_inst_pair_ptr2->first  = IdToInstMap[i1_id];
-               dep_inst_pair_ptr2->second = IdToInstMap[i2_id];
-             */
+    LLVM_DEBUG(errs() << "LAMP profile incomplete\n");
+    return false;
+  }
 
-            BB = IdToLoopMap_global[loop_id];
+  if (!BinaryProfileFileName.empty())
+    writeBinaryProfile(BinaryProfileFileName, itercounts, records);
 
-            // Adding this to see variable names-- TRM
-            Instruction * temp1, * temp2;
-            unsigned ln1, ln2;
+  std::ofstream lcfile;
+  std::ofstream dfile;
 
+  if (WriteReports)
+  {
+    lcfile.open(LCOUTFILE);
+    dfile.open(DOUTFILE);
+    auxfile.open(AUXFILE);
+
+    lcfile << "#File produced by LAMP Load Profiling pass\n";
+    lcfile << "#This file contains information on loop-carried dependences\n";
+    lcfile << "#[var1 @ function * bbname -- var2 @ function * bbname] line1#line2# LAMPdata Loop: LoopID LAMPdata\n";
+    lcfile << "#var1 depends on var2\n";
+    dfile << "#File produced by LAMP Load Profiling pass\n";
+    dfile << "#This file contains information on intra-iteration dependences\n";
+    dfile << "#[var1 @ function * bbname -- var2 @ function * bbname] line1#line2# LAMPdata Loop: LoopID LAMPdata\n";
+    dfile << "#var1 depends on var2\n";
+    auxfile << "#File produced by LAMP Load Profiling pass\n";
+    auxfile << "#This file contains information on loop-caried and intra-iteration dependences where recursion worked to find variable names in the LAMP Reader\n";
+    auxfile << "#[var1 @ function * bbname -- var2 @ function * bbname] line1#line2# Loop: LoopID\n";
+    auxfile << "#var1 depends on var2\n";
+  }
 
-            lcfile << "[";
-            temp1 = IdToInstMap[i1_id]; temp2 = IdToInstMap[i2_id];
+  for (LAMPRecords::const_iterator r = records.begin(), e = records.end(); r != e; ++r)
+  {
+    const LAMPRecord &rec = *r;
 
-            if (isa<LoadInst>(temp1) || isa<StoreInst>(temp1))
-            {
-              Value * myV;
-              if (isa<LoadInst>(temp1))
-                myV = dyn_cast<LoadInst>(temp1)->getPointerOperand();
-              else if (isa<StoreInst>(temp1))
-                myV = dyn_cast<StoreInst>(temp1)->getPointerOperand();
-              else
-                myV = temp1->getOperand(0);  // try it anyway ???
-              int i = 0;
-              Instruction * myI = temp1;
-
-              const DebugLoc & DSI = myI->getDebugLoc();
-
-
-              if(DSI)
-              {
-                ln1 = DSI.getLine();
-                // LLVM_DEBUG(errs() << "\n!!!! Line # is " << ln1 << " inst " << myV->getName().str() << "\n\n");
-              }
-              else
-              {
-                ln1 = 0;
-                LLVM_DEBUG(errs() << "No DSI\n");
-              }
-
-              while (myV->getName().str() == "")
-              {
-                if (myI && (dyn_cast<User>(myI))->getNumOperands() != 0)
-                {
-                  if (isa<LoadInst>(myI))
-                  {
-                    myV = dyn_cast<LoadInst>(myI)->getPointerOperand();
-                    myI = dyn_cast<Instruction>(dyn_cast<LoadInst>(myI)->getPointerOperand());
-                  }
-                  else if (isa<StoreInst>(myI))
-                  {
-                    myV = dyn_cast<StoreInst>(myI)->getPointerOperand();
-                    myI = dyn_cast<Instruction>(dyn_cast<StoreInst>(myI)->getPointerOperand());
-                  }
-                  else
-                  {
-                    if ((dyn_cast<User>(myI))->getNumOperands() == 1)
-                    {
-                      myV = myI->getOperand(0);  // try it anyway ???
-                      myI = dyn_cast<Instruction>(myI->getOperand(0));
-                    }
-                    else
-                    {  // should recurse in multiple directions here
-                      // myV = myI->getOperand(0);  // try it anyway ???
-                      //myI = dyn_cast<Instruction>(myI->getOperand(0));
-                      LLVM_DEBUG(errs() << "attempting zrecurse" << i << "\t" << i1_id << "\n");
-                      needCheck++;
-                      globLoop = loop_id;
-                      ISet avoidInfiniteRecursion;
-                      recurseOperands(myI, temp1->getParent()->getParent()->getName().str(),
-                          temp1->getParent()->getName().str(), 1, ln1, avoidInfiniteRecursion);
-                      break;
-                    }
-                  }
-
-                }
-                else
-                {
-                  //                           lcfile << "##ORIG";
-                  break;
-                }
-                i++;
-
-              }
-
-              lctotal++;
-              if (myV->getName().str() == "")
-                lcfile << "##ORIG";
-              // Printed- [
-              // Print- var1
-              lcfile << myV->getName().str();
-              addToList(myV->getName().str(),
-                  temp1->getParent()->getParent()->getName().str(),
-                  temp1->getParent()->getName().str(), 1, ln1);
-            }
+    Instruction *temp1 = lookupInst(IdToInstMap, rec.i1_id);
+    Instruction *temp2 = lookupInst(IdToInstMap, rec.i2_id);
+    if (!temp1 || !temp2)
+      continue;
 
-            // Printed - [var1
-            // Print - @ fun * bb --
-            lcfile << " @ " << temp1->getParent()->getParent()->getName().str()
-              << " * " << temp1->getParent()->getName().str() << " -- ";
-            if (isa<LoadInst>(temp2) || isa<StoreInst>(temp2))
-            {
-              Value * myV;
-              if (isa<LoadInst>(temp2))
-                myV = dyn_cast<LoadInst>(temp2)->getPointerOperand();
-              else if (isa<StoreInst>(temp2))
-                myV = dyn_cast<StoreInst>(temp2)->getPointerOperand();
-              else
-                myV = temp2->getOperand(0);  // try it anyway ???
-
-              Instruction * myI = temp2;
-
-              const DebugLoc & DSI = myI->getDebugLoc();
-
-
-              if(DSI)
-              {
-                ln2 = DSI.getLine();
-                //  LLVM_DEBUG(errs() << "\n!!!! Line # is " << ln1 << " inst " << myV->getName().str() << "\n\n");
-              }
-              else
-              {
-                ln2 = 0;
-                LLVM_DEBUG(errs() << "No DSI\n");
-              }
-
-              while (myV->getName().str() == "")
-              {
-                if (myI && (dyn_cast<User>(myI))->getNumOperands() != 0)
-                {
-                  if (isa<LoadInst>(myI))
-                  {
-                    myV = dyn_cast<LoadInst>(myI)->getPointerOperand();
-                    myI = dyn_cast<Instruction>(dyn_cast<LoadInst>(myI)->getPointerOperand());
-                  }
-                  else if (isa<StoreInst>(myI))
-                  {
-                    myV = dyn_cast<StoreInst>(myI)->getPointerOperand();
-                    myI = dyn_cast<Instruction>(dyn_cast<StoreInst>(myI)->getPointerOperand());
-                  }
-                  else
-                  {
-                    if ((dyn_cast<User>(myI))->getNumOperands() == 1)
-                    {
-                      myV = myI->getOperand(0);  // try it anyway ???
-                      myI = dyn_cast<Instruction>(myI->getOperand(0));
-                    }
-                    else
-                    {  // should recurse in multiple directions here
-                      //myV = myI->getOperand(0);  // try it anyway ???
-                      //myI = dyn_cast<Instruction>(myI->getOperand(0));
-                      LLVM_DEBUG(errs() << "attempting recurse" << i++ << "\t" << i2_id << "\n");
-                      globLoop = loop_id;
-                      ISet avoidInfiniteRecursion;
-                      recurseOperands(myI, temp2->getParent()->getParent()->getName().str(),
-                          temp2->getParent()->getName().str(), 2, ln2, avoidInfiniteRecursion);
-                      needCheck++;
-                      break;
-                    }
-                  }
-                }
-                else
-                {
-                  //                           lcfile << "##ORIG";
-                  break;
-                }
-
-              }
-              if (myV->getName().str() == "")
-                lcfile << "##ORIG";
-              // Printed- [var1 @ fun * bb --
-              // Print  - var2
-              lcfile << myV->getName().str();
-              addToList(myV->getName().str(),
-                  temp1->getParent()->getParent()->getName().str(),
-                  temp1->getParent()->getName().str(), 2, ln2);
-            }
+    // need true dependences analyzed here as well, not cross iteration
+    if (!rec.cross_iter && rec.loop_id == 0)
+      continue;
 
-            // Printed- [var1 @ fun * bb -- var2
-            // Print  - @ fun * bb]
-            lcfile << " @ " << temp2->getParent()->getParent()->getName().str()
-              << " * " << temp2->getParent()->getName().str() << "]\t";
-
-            if (ln1 == 0)
-              lcfile << "UNKNOWN";
-            else
-              lcfile << ln1;
-            lcfile << "#";
-
-            if (ln2 == 0)
-              lcfile << "UNKNOWN";
-            else
-              lcfile << ln2;
-
-            lcfile << "#\t";
-
-            //                  lcfile << ln1 << " # " << ln2 << "\t";
-
-            // BasicBlock *nickBB = IdToLoopMap_global[loop_id];
-            lcfile << temp1 << " " << temp2 << " ID:" << i1_id << " " << i2_id
-              << " Loop:" << loop_id
-//              << " (" << nickBB->getParent()->getNameStr() << ':'
-//              << nickBB->getNameStr() << ')'
-              << " " << "(" << BB << ")" ;
-//            iter = LoopToDepSetMap.find(BB);
-//            if (iter == LoopToDepSetMap.end() )
-//            {   // newly found loop
-//              LoopToDepSetMap[BB].insert( dep_inst_pair );
-//            }else{                                 // loop already in the map
-              LoopToDepSetMap[BB].insert(dep_inst_pair);
-//            }
-
-            /*
-               if(*dep_inst_pair_ptr == *dep_inst_pair_ptr2) {
-               LLVM_DEBUG(errs() << "~I think the pair pointers are equal\n");
-               } else {
-               LLVM_DEBUG(errs() << "~The pointers are not equal\n");
-               LLVM_DEBUG(errs() << "Ptr 1: " << dep_inst_pair_ptr->first  << " " << dep_inst_pair_ptr->second << "\n");
-               LLVM_DEBUG(errs() << "Ptr 2: " << dep_inst_pair_ptr2->first << " " << dep_inst_pair_ptr2->second << "\n");
-               }
-
-               InstPairSet::iterator siter;
-               siter = LoopToDepSetMap[BB].find(*dep_inst_pair_ptr);
-               if(siter == LoopToDepSetMap[BB].end() ) {
-               LLVM_DEBUG(errs() << "~~~did NOT find instruction pair we just inserted\n");
-
-               } else {
-               LLVM_DEBUG(errs() << "~~~FOUND instruction pair we just inserted\n");
-
-
-               }
-               siter = LoopToDepSetMap[BB].find(*dep_inst_pair_ptr2);
-               if(siter == LoopToDepSetMap[BB].end() ) {
-               LLVM_DEBUG(errs() << "~~~did NOT find duplicate pair\n");
-
-               } else {
-               LLVM_DEBUG(errs() << "~~~FOUND duplicate pair\n");
-
-
-               }
-             */
-
-            // Store the values in the maps with their Namer::id so we can survive changes to IR
-            biikey_t biikey(BB, Namer::getInstrId(IdToInstMap[i1_id]),
-                Namer::getInstrId(IdToInstMap[i2_id]), cross_iter > 0);
-            DepToCountMap[biikey] = times;
-
-            lcfile << " T:" << times << " P:" << (double)(times) / itercounts[loop_id]
-              << "  " << LoopToDepSetMap.size();
-
-            if (needCheck != 0)
-              dumpListToFile(1);
-            else
-              purgeList();
-          }
-        }
-        else {  // need true dependences analyzed here as well, not cross iteration
-          if (loop_id != 0)
-          {
-            if ( IdToInstMap[i1_id] != NULL && IdToInstMap[i2_id] !=NULL  ){
-              InstPair dep_inst_pair(Namer::getInstrId(IdToInstMap[i1_id]),
-                  Namer::getInstrId(IdToInstMap[i2_id]));
-              BB = IdToLoopMap_global[loop_id];
-
-              // Adding this to see variable names-- TRM
-              Instruction * temp1, * temp2;
-              unsigned ln1, ln2;
-
-
-              dfile << "[";
-              temp1 = IdToInstMap[i1_id]; temp2 = IdToInstMap[i2_id];
-
-
-              if (isa<LoadInst>(temp1) || isa<StoreInst>(temp1))
-              {
-                Value * myV;
-                if (isa<LoadInst>(temp1))
-                  myV = dyn_cast<LoadInst>(temp1)->getPointerOperand();
-                else if (isa<StoreInst>(temp1))
-                  myV = dyn_cast<StoreInst>(temp1)->getPointerOperand();
-                else
-                  myV = temp1->getOperand(0);  // try it anyway ???
-                int i = 0;
-                Instruction * myI = temp1;
-
-                const DebugLoc & DSI = myI->getDebugLoc();
-
-
-                if(DSI)
-                {
-                  //                           std::string file;
-                  ln1 = DSI.getLine();
-                  //                           GetConstantStringInfo(DSI->getFileName(), file);
-                  //                           LLVM_DEBUG(errs() << "\n!!!! Line # is " << ln1 << " file " << file << "\n\n");
-                }
-                else
-                {
-                  ln1 = 0;
-                  LLVM_DEBUG(errs() << "No DSI\n");
-                }
-
-                while (myV->getName().str() == "")
-                {
-                  if (myI && (dyn_cast<User>(myI))->getNumOperands() != 0)
-                  {
-                    if (isa<LoadInst>(myI))
-                    {
-                      myV = dyn_cast<LoadInst>(myI)->getPointerOperand();
-                      myI = dyn_cast<Instruction>(dyn_cast<LoadInst>(myI)->getPointerOperand());
-                    }
-                    else if (isa<StoreInst>(myI))
-                    {
-                      myV = dyn_cast<StoreInst>(myI)->getPointerOperand();
-                      myI = dyn_cast<Instruction>(dyn_cast<StoreInst>(myI)->getPointerOperand());
-                    }
-                    else
-                    {
-
-                      if ((dyn_cast<User>(myI))->getNumOperands() == 1)
-                      {
-
-
-                        myV = myI->getOperand(0);  // try it anyway ???
-                        myI = dyn_cast<Instruction>(myI->getOperand(0));
-
-
-
-                        LLVM_DEBUG(errs() << "DDOK" << i << "\t" << i1_id << "\n");
-                      }
-                      else
-                      {  // should recurse in multiple directions here
-                        //myV = myI->getOperand(0);  // try it anyway ???
-                        //myI = dyn_cast<Instruction>(myI->getOperand(0));
-                        //LLVM_DEBUG(errs() << "DDfail" << i << "\t" << i1_id << "\n");
-
-                        LLVM_DEBUG(errs() << "DDattempting recurse" << j++ << "\t" << i1_id << "\n");
-                        globLoop = loop_id;
-                        ISet avoidInfiniteRecursion;
-                        recurseOperands(myI, temp1->getParent()->getParent()->getName().str(),
-                            temp1->getParent()->getName().str(), 1, ln1,avoidInfiniteRecursion);
-                        needCheck++;
-                        break;
-                      }
-                    }
-
-                  }
-                  else
-                  {
-                    //                              dfile << "##ORIG";
-                    break;
-                  }
-
-
-                }
-                dtotal++;
-                if (myV->getName().str() == "")
-                  dfile << "##ORIG";
-                dfile << myV->getName().str();
-                addToList(myV->getName().str(),
-                    temp1->getParent()->getParent()->getName().str(),
-                    temp1->getParent()->getName().str(), 1, ln1);
-              }
-
-              dfile << " @ " << temp1->getParent()->getParent()->getName().str()
-                << " * " << temp1->getParent()->getName().str() << " -- ";
-              if (isa<LoadInst>(temp2) || isa<StoreInst>(temp2))
-              {
-                Value * myV;
-                if (isa<LoadInst>(temp2))
-                  myV = dyn_cast<LoadInst>(temp2)->getPointerOperand();
-                else if (isa<StoreInst>(temp2))
-                  myV = dyn_cast<StoreInst>(temp2)->getPointerOperand();
-                else
-                  myV = temp2->getOperand(0);  // try it anyway ???
-
-                Instruction * myI = temp2;
-
-                const DebugLoc & DSI = myI->getDebugLoc();
-
-
-                if(DSI)
-                {
-                  ln2 = DSI.getLine();
-                  // LLVM_DEBUG(errs() << "\n!!!! Line # is " << ln1 << " inst " << myV->getName().str() << "\n\n");
-                }
-                else
-                {
-                  ln2 = 0;
-                  LLVM_DEBUG(errs() << "No DSI\n");
-                }
-
-                int i = 0;
-                while (myV->getName().str() == "")
-                {
-                  if (myI && (dyn_cast<User>(myI))->getNumOperands() != 0)
-                  {
-                    if (isa<LoadInst>(myI))
-                    {
-                      myV = dyn_cast<LoadInst>(myI)->getPointerOperand();
-                      myI = dyn_cast<Instruction>(dyn_cast<LoadInst>(myI)->getPointerOperand());
-                    }
-                    else if (isa<StoreInst>(myI))
-                    {
-                      myV = dyn_cast<StoreInst>(myI)->getPointerOperand();
-                      myI = dyn_cast<Instruction>(dyn_cast<StoreInst>(myI)->getPointerOperand());
-                    }
-                    else
-                    {
-                      if ((dyn_cast<User>(myI))->getNumOperands() == 1)
-                      {
-                        myV = myI->getOperand(0);  // try it anyway ???
-                        myI = dyn_cast<Instruction>(myI->getOperand(0));
-                        LLVM_DEBUG(errs() << "DDOK" << i << "\t" << i2_id << "\n");
-                      }
-                      else
-                      {  // should recurse in multiple directions here
-                        //myV = myI->getOperand(0);  // try it anyway ???
-                        //myI = dyn_cast<Instruction>(myI->getOperand(0));
-                        //LLVM_DEBUG(errs() << "DDfail" << i << "\t" << i2_id << "\n");
-
-                        LLVM_DEBUG(errs() << "attempting recurse" << j++ << "\t" << i2_id << "\n");
-                        globLoop = loop_id;
-                        ISet avoidInfiniteRecursion;
-                        recurseOperands(myI, temp2->getParent()->getParent()->getName().str(),
-                            temp2->getParent()->getName().str(), 2, ln2,avoidInfiniteRecursion);
-                        needCheck++;
-                        break;
-                      }
-                    }
-                  }
-                  else
-                  {
-                    //                              dfile << "##ORIG";
-                    break;
-                  }
-                  i++;
-                }
-                if (myV->getName().str() == "")
-                  dfile << "##ORIG";
-                dfile << myV->getName().str();
-                addToList(myV->getName().str(),
-                    temp1->getParent()->getParent()->getName().str(),
-                    temp1->getParent()->getName().str(), 2, ln2);
-              }
-
-
-              dfile << " @ " << temp2->getParent()->getParent()->getName().str()
-                << " * " << temp2->getParent()->getName().str() << "]\t";
-
-              // TRM
-              if (ln1 == 0)
-                dfile << "UNKNOWN";
-              else
-                dfile << ln1;
-              dfile << "#";
-
-              if (ln2 == 0)
-                dfile << "UNKNOWN";
-              else
-                dfile << ln2;
-
-              dfile << "#\t";
-
-              dfile << temp1 << " " << temp2 << " ID:" << i1_id << " " << i2_id
-                << " Loop:" << loop_id << " " << "(" << BB << ")" ;
-
-              // Add this dep to the map
-//              iter = LoopToDepSetMap.find(BB);
-//              if (iter == LoopToDepSetMap.end() ) {   // newly found loop
-//                InstPairSet* dep_pair_set_ptr = new InstPairSet;
-//                dep_pair_set_ptr->insert(dep_inst_pair);
-//                LoopToDepSetMap[BB] = *dep_pair_set_ptr;
-//              } else {                                 // loop already in the map
-                LoopToDepSetMap[BB].insert(dep_inst_pair);
-//              }
-
-
-              // Store the values in the maps with their Namer::id so we can survive changes to IR
-              biikey_t biikey(BB, Namer::getInstrId(IdToInstMap[i1_id]),
-                Namer::getInstrId(IdToInstMap[i2_id]), cross_iter > 0);
-              DepToCountMap[biikey] = times;
-
-              dfile << " T:" << times << " P:" << (double)times/itercounts[loop_id]
-                << "  " << LoopToDepSetMap.size();
-
-              if (needCheck != 0)
-                dumpListToFile(0);
-              else
-                purgeList();
-            }
-          }
+    if (rec.loop_id >= itercounts.size())
+    {
+      LLVM_DEBUG(errs() << "LAMP profile names unknown loop " << rec.loop_id << '\n');
+      continue;
+    }
 
-        }
+    BasicBlock *BB = IdToLoopMap_global[rec.loop_id];
 
+    // Store the values in the maps with their Namer::id so we can survive changes to IR
+    InstPair dep_inst_pair(Namer::getInstrId(temp1), Namer::getInstrId(temp2));
+    LoopToDepSetMap[BB].insert(dep_inst_pair);
 
-        break;
-      case 0: /* Number of iterations of the loop that the dependence manifested */
-        {
-          biikey_t biikey(BB, Namer::getInstrId(IdToInstMap[i1_id]), 
-              Namer::getInstrId(IdToInstMap[i2_id]), cross_iter);
+    biikey_t countkey(BB, dep_inst_pair.first, dep_inst_pair.second, rec.cross_iter > 0);
+    DepToCountMap[countkey] = rec.times;
 
-          if(cross_iter)
-          {
-            if( num != 0)
-            {
-              double pl = (double)(num) / itercounts[loop_id];
-              lcfile << " Tl:" << num << " Pl:" << pl;
-              biimap[biikey] = pl;
-            }
-            lcfile << '\n';
-          } else {
-            if( num != 0)
-            {
-              double pl = (double)(num) / itercounts[loop_id];
-              dfile << " Tl:" << num << " Pl:" << pl;
-              biimap[biikey] = pl;
-            }
-            dfile << '\n';
-          }
-        }
-        break;
-      default:
-        break;
+    /* Number of iterations of the loop that the dependence manifested */
+    if (rec.iters != 0)
+    {
+      biikey_t biikey(BB, dep_inst_pair.first, dep_inst_pair.second, rec.cross_iter);
+      biimap[biikey] = (double)(rec.iters) / itercounts[rec.loop_id];
     }
-  } // end of while(ifs >> s)
-
 
-  lcfile.close();
-  dfile.close();
+    if (WriteReports)
+      reportDependence(rec.cross_iter ? lcfile : dfile, rec.cross_iter ? 1 : 0,
+          temp1, temp2, rec, BB, itercounts[rec.loop_id], LoopToDepSetMap.size());
+  }
 
-  std::map<BasicBlock*, InstPairSet > :: iterator  Liter;
-  InstPairSet :: iterator  Siter;
+  if (WriteReports)
+  {
+    lcfile.close();
+    dfile.close();
+    auxfile.close();
+  }
 
   //for (int i = lamp_id+1; i< ;i ++ )
   LLVM_DEBUG(errs() << "Num of cross-dep Loops: "<< LoopToDepSetMap.size() << '\n');
-  /*
-  // What is the point of all this?
-  // Figuring out the max deps in the program and printing the two instruction #s?
-  for (Liter = LoopToDepSetMap.begin();Liter != LoopToDepSetMap.end(); Liter++){
-  max_times = 0;
-  for (Siter = Liter->second.begin();Siter != Liter->second.end(); Siter++){
-  times = DepToTimesMap[Siter];
-  if (times > max_times){
-  max_times = times;
-  Id1 = InstToIdMap[(Siter)->first];
-  Id2 = InstToIdMap[(Siter)->second];
-  }
-  }
-  LoopToMaxDepTimesMap[Liter->first] = max_times;
-  LLVM_DEBUG(errs() << "LoopToIDMap_global[Liter->frist]   max_times   (Id1, Id2)\n");
-  LLVM_DEBUG(errs() << LoopToIdMap_global[Liter->first] << " " << max_times
-               << " ("  << Id1 << "," << Id2 << ")"<< '\n');
-
-  }
-   */
 
   // intentionally skip loop 0, since that is the global contex.
-  LLVM_DEBUG(for (unsigned i = 1; i < loopCount; i++) {
+  LLVM_DEBUG(for (unsigned i = 1; i < itercounts.size(); i++) {
     if (itercounts[i] > 0) {
       BasicBlock *header = IdToLoopMap_global[i];
       if (header) {
@@ -0,0 +1,40 @@
+#define DEBUG_TYPE "loop-nest-cache-aa"
+
+#include "llvm/ADT/Statistic.h"
+
+#include "scaf/SpeculationModules/LoopNestCacheAA.h"
+
+namespace liberty {
+using namespace llvm;
+
+STATISTIC(numQueries, "Num operation queries on target loops");
+STATISTIC(numNoModRef, "Num NoModRef implied by facts of nested loops");
+STATISTIC(numRecorded, "Num remedy-free results recorded");
+
+LoopAA::ModRefResult LoopNestCacheAA::modref(const Instruction *A,
+                                             TemporalRelation rel,
+                                             const Instruction *B,
+                                             const Loop *L, Remedies &R) {
+  if (!L || !L->contains(A) || !L->contains(B) || !hierarchy.isTarget(L))
+    return LoopAA::modref(A, rel, B, L, R);
+
+  ++numQueries;
+  const ModRefResult bound = hierarchy.getFactBound(L, A, rel, B);
+  if (bound == NoModRef) {
+    ++numNoModRef;
+    return NoModRef;
+  }
+
+  Remedies tmpR;
+  ModRefResult result = LoopAA::modref(A, rel, B, L, tmpR);
+  if (tmpR.empty()) {
+    ++numRecorded;
+    hierarchy.recordFact(L, A, rel, B, result);
+  }
+
+  for (auto remed : tmpR)
+    R.insert(remed);
+  return ModRefResult(result & bound);
+}
+
+} // namespace liberty
@@ -10,11 +10,14 @@ using namespace llvm;
 
 bool TargetLoopHierarchy::runOnModule(Module& m)
 {
-  std::vector< std::vector<Loop*> > h_vec;
+  h_vec.clear();
+  targetHeaders.clear();
+  facts.clear();
 
   // find a hierarchy between target loops
   ModuleLoops &mloops = getAnalysis< ModuleLoops >();
   Targets &targets = getAnalysis< Targets >();
+  targetHeaders.insert(targets.begin(), targets.end());
   for(Targets::iterator ti = targets.begin(mloops), te = targets.end(mloops) ; ti != te ; ++ti)
   {
     Loop* loop = *ti;
@@ -26,7 +29,7 @@ bool TargetLoopHierarchy::runOnModule(Module& m)
       Loop* iter = loop;
       while (iter)
       {
-        if ( std::find(targets.begin(), targets.end(), iter->getHeader()) != targets.end() )
+        if ( isTarget(iter) )
           h.push_back(iter);
         iter = iter->getParentLoop();
       }
@@ -34,27 +37,93 @@ bool TargetLoopHierarchy::runOnModule(Module& m)
     }
   }
 
+  return false;
+}
+
+void TargetLoopHierarchy::print(raw_ostream &os, const Module *m) const
+{
   // print a hierarchy
-  errs() << "*** Print Target Loop Hierarchy (size: " << h_vec.size() << ")\n";
-  errs() << "(inner) ----------- (outer):\n";
+  os << "*** Print Target Loop Hierarchy (size: " << h_vec.size() << ")\n";
+  os << "(inner) ----------- (outer):\n";
 
   for (unsigned i = 0 ; i < h_vec.size() ; i++)
   {
-    std::vector<Loop*>& h = h_vec[i];
-    errs() << " - ";
+    const std::vector<Loop*>& h = h_vec[i];
+    os << " - ";
     std::string fname = h[0]->getHeader()->getParent()->getName();
-    errs() << fname << ":: ";
+    os << fname << ":: ";
     for (unsigned j = 0 ; j < h.size() ; j++)
     {
       if (j != 0)
-        errs() << " -> ";
+        os << " -> ";
       std::string name = h[j]->getHeader()->getName().str();
-      errs() << name;
+      os << name;
     }
-    errs() << "\n";
+    os << "\n";
   }
+}
+
+void TargetLoopHierarchy::recordFact(const Loop *l, const Instruction *A,
+                                     LoopAA::TemporalRelation rel,
+                                     const Instruction *B,
+                                     LoopAA::ModRefResult res)
+{
+  if ( !isTarget(l) )
+    return;
+
+  PairFacts &pair = facts[l][OpPair(A,B)];
+  const unsigned char bit = 1u << rel;
+  if ( pair.known & bit )
+    res = LoopAA::ModRefResult(pair.results[rel] & res);
+  pair.known |= bit;
+  pair.results[rel] = res;
+}
+
+const TargetLoopHierarchy::PairFacts *TargetLoopHierarchy::lookupFacts(
+  const Loop *l, const Instruction *A, const Instruction *B) const
+{
+  auto i = facts.find(l);
+  if ( i == facts.end() )
+    return nullptr;
+  auto j = i->second.find(OpPair(A,B));
+  if ( j == i->second.end() )
+    return nullptr;
+  return &j->second;
+}
+
+LoopAA::ModRefResult TargetLoopHierarchy::getFactBound(
+  const Loop *l, const Instruction *A, LoopAA::TemporalRelation rel,
+  const Instruction *B) const
+{
+  const unsigned char sameBit = 1u << LoopAA::Same;
+  const unsigned char allBits = 7;
+
+  unsigned bound = LoopAA::ModRef;
+  if ( const PairFacts *pair = lookupFacts(l,A,B) )
+    if ( pair->known & (1u << rel) )
+      bound &= pair->results[rel];
+
+  // Outer facts are ordered: they say nothing of B before A.
+  if ( rel != LoopAA::After )
+    for (const Loop *outer = l->getParentLoop(); outer && bound; outer = outer->getParentLoop())
+      if ( const PairFacts *pair = lookupFacts(outer,A,B) )
+        if ( pair->known & sameBit )
+          bound &= pair->results[LoopAA::Same];
+
+  if ( rel == LoopAA::Same && bound )
+    for (const Loop *sub : l->getSubLoops())
+    {
+      if ( !sub->contains(A) || !sub->contains(B) )
+        continue;
+
+      const PairFacts *pair = lookupFacts(sub,A,B);
+      if ( pair && pair->known == allBits )
+        bound &= pair->results[LoopAA::Before] | pair->results[LoopAA::Same]
+               | pair->results[LoopAA::After];
+      break;
+    }
 
-  return true;
+  return LoopAA::ModRefResult(bound);
 }
 
 bool TargetLoopHierarchy::hasHotSubloop(Loop* l, Targets& targets)
@@ -64,7 +133,7 @@ bool TargetLoopHierarchy::hasHotSubloop(Loop* l, Targets& targets)
   for (unsigned i = 0 ; i < subloops.size() ; i++)
   {
     Loop* subloop = subloops[i];
-    if ( std::find(targets.begin(), targets.end(), subloop->getHeader()) != targets.end() )
+    if ( isTarget(subloop) )
       return true;
 
     if ( hasHotSubloop(subloop, targets) )
@@ -1,6 +1,8 @@
 #define DEBUG_TYPE "targets"
 
 #include "llvm/IR/Module.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
@@ -9,6 +11,7 @@
 #include "scaf/SpeculationModules/LoopProf/Targets.h"
 
 #include <list>
+#include <sys/time.h>
 
 namespace liberty
 {
@@ -37,6 +40,17 @@ static cl::opt<unsigned> MinIterationsPerInvoc(
   "target-min-iters", cl::init(8), cl::NotHidden,
   cl::desc("Target loops which iterate at least N times per invocation on average"));
 
+static cl::opt<unsigned> CoveragePercent(
+  "target-coverage", cl::init(0), cl::NotHidden,
+  cl::desc("Only target the hottest loops which together cover N% of the total execution time (0: all)"));
+
+static cl::opt<double> TimeBudget(
+  "target-time-budget", cl::init(0), cl::NotHidden,
+  cl::desc("Stop analyzing target loops after N seconds (0: no budget)"));
+
+STATISTIC(numDroppedByCoverage, "Num target loops dropped by -target-coverage");
+STATISTIC(numBudgetExhausted, "Num times a client stopped on -target-time-budget");
+
 Loop *header_to_loop_mapping_iterator::operator*() const
 {
   BasicBlock *header = *i;
@@ -175,17 +189,81 @@ void Targets::addLoopByName(Module &mod, const std::string &fname, const std::st
   }
 }
 
-struct SortLoops
+// Sort loops by execution weight, descending.  Look each time up
+// once; the profile is keyed by name.
+void Targets::sortByTime(LoopProfLoad &load)
+{
+  DenseMap<const BasicBlock *, unsigned long> times;
+  for(header_iterator i=begin(), e=end(); i!=e; ++i)
+    times[*i] = load.getLoopTime(*i);
+
+  std::stable_sort( Loops.begin(), Loops.end(),
+    [&times](const BasicBlock *a, const BasicBlock *b) {
+      return times[a] > times[b];
+    });
+}
+
+// Keep the hottest loops, up to the first one at which they cover
+// CoveragePercent of the total time.  The time of a loop includes
+// that of its subloops, so only the outermost loops kept so far
+// are counted.
+void Targets::limitCoverage(LoopProfLoad &load)
 {
-  SortLoops( LoopProfLoad &lpl ) : load(lpl) {}
+  const double goal = load.getTotTime() * (double)CoveragePercent / 100;
 
-  bool operator()(const BasicBlock * const & a, const BasicBlock * const & b)
+  std::vector<Loop *> counted;
+  double covered = 0;
+  LoopList::iterator i = Loops.begin();
+  while( i != Loops.end() && covered < goal )
   {
-    return load.getLoopTime(a) > load.getLoopTime(b);
+    BasicBlock *header = *i++;
+    LoopInfo &li = mloops->getAnalysis_LoopInfo(header->getParent());
+    Loop *loop = li.getLoopFor(header);
+
+    bool nested = false;
+    for(Loop *outer : counted)
+      nested |= outer->contains(loop);
+    if( nested )
+      continue;
+
+    for(unsigned j=0; j<counted.size(); )
+      if( loop->contains(counted[j]) )
+      {
+        covered -= load.getLoopTime(counted[j]->getHeader());
+        counted[j] = counted.back();
+        counted.pop_back();
+      }
+      else
+        ++j;
+
+    counted.push_back(loop);
+    covered += load.getLoopTime(header);
   }
-private:
-  LoopProfLoad &load;
-};
+
+  LLVM_DEBUG(errs() << "Dropping " << (Loops.end() - i) << " target loops past "
+                    << CoveragePercent << "% coverage\n");
+  numDroppedByCoverage += Loops.end() - i;
+  Loops.erase(i, Loops.end());
+}
+
+bool Targets::isWithinBudget(const Pass *client)
+{
+  if( TimeBudget <= 0 )
+    return true;
+
+  struct timeval now;
+  gettimeofday(&now, 0);
+  const double seconds = now.tv_sec + 1.e-6 * now.tv_usec;
+  // The first call of each client starts its clock
+  const double start = budgetStarts.insert(
+    std::make_pair(client, seconds) ).first->second;
+
+  if( seconds - start < TimeBudget )
+    return true;
+
+  ++numBudgetExhausted;
+  return false;
+}
 
 bool Targets::runOnModule(Module &mod)
 {
@@ -256,10 +334,10 @@ bool Targets::runOnModule(Module &mod)
 
   // Sort loops by execution weight, descending, if available.
   if( Loops.size() > 1 && load.isValid() )
-  {
-    SortLoops ltne(load);
-    std::stable_sort( Loops.begin(), Loops.end(), ltne );
-  }
+    sortByTime(load);
+
+  if( CoveragePercent > 0 && load.isValid() )
+    limitCoverage(load);
 
   errs() << "Focus on these loops (in this order):\n";
   for(header_iterator i=begin(), e=end(); i!=e; ++i)
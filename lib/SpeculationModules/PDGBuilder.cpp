@@ -1,5 +1,6 @@
 #include "llvm/IR/InstrTypes.h"
 #include <sstream>
+#include <set>
 #include <streambuf>
 #define DEBUG_TYPE "pdgbuilder"
 
@@ -17,11 +18,19 @@
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 
 #include "llvm/ADT/iterator_range.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/LineIterator.h"
+#include "llvm/Support/MemoryBuffer.h"
 
+#include "scaf/SpeculationModules/CompactSCCDAG.hpp"
+#include "scaf/SpeculationModules/ControlSpecRemed.h"
 #include "scaf/SpeculationModules/GlobalConfig.h"
+#include "scaf/SpeculationModules/LoopNestCacheAA.h"
+#include "scaf/SpeculationModules/LoopProf/TargetLoopHierarchy.h"
 #include "scaf/MemoryAnalysisModules/LLVMAAResults.h"
 #include "scaf/SpeculationModules/PDGBuilder.hpp"
 #include "scaf/SpeculationModules/ProfilePerformanceEstimator.h"
+#include "scaf/SpeculationModules/TransitiveControlDeps.hpp"
 #include "scaf/Utilities/ReportDump.h"
 #include "scaf/SpeculationModules/LoopProf/Targets.h"
 #include "scaf/Utilities/Metadata.h"
@@ -29,6 +38,7 @@
 #include "scaf/SpeculationModules/SlampOracleAA.h"
 
 #include "noelle/core/PDGPrinter.hpp"
+#include "noelle/core/SCCDAG.hpp"
 #include "Assumptions.h"
 
 using namespace llvm;
@@ -41,6 +51,24 @@ static cl::opt<bool> DumpPDG(
     cl::NotHidden,
     cl::desc("Dump out the PDG as dot files"));
 
+static cl::opt<std::string> WritePDG(
+    "write-pdg", cl::init(""), cl::NotHidden,
+    cl::desc("Serialize the PDG of each target loop to this file (JSON lines)"));
+
+static cl::opt<std::string> ReadPDG(
+    "read-pdg", cl::init(""), cl::NotHidden,
+    cl::desc("Load PDGs serialized by -write-pdg instead of recomputing them"));
+
+static cl::opt<bool> VerifySCCDAG(
+    "pdg-verify-sccdag", cl::init(false), cl::Hidden,
+    cl::desc("Check that CompactSCCDAG finds the same SCCs as the noelle "
+             "SCCDAG of each target loop, with and without speculation"));
+
+static cl::opt<bool> VerifyCtrlClosure(
+    "pdg-verify-ctrl-closure", cl::init(false), cl::Hidden,
+    cl::desc("Check TransitiveControlDeps against a naive closure of the "
+             "intra-iteration control dependences of each target loop"));
+
 static cl::opt<std::string> QueryDep(
   "query-dep", cl::init(""), cl::NotHidden,
   cl::desc("Query a specific dependence"));
@@ -70,6 +98,13 @@ cl::opt<bool> IgnoreCallsite = cl::opt<bool> ( "pdg-ignore-callsite",
     cl::NotHidden,
     cl::desc("Ignore all callsite in PDG"));
 
+static cl::opt<bool> SkipDeadQueries(
+    "pdg-skip-dead-queries", cl::init(false), cl::NotHidden,
+    cl::desc("With -enable-edgeprof, query memory dependences of "
+             "speculatively dead operations only with the modules below "
+             "the speculation modules, and draw those found removable by "
+             "control speculation; cheaper remedies are not sought"));
+
 void llvm::PDGBuilder::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.addRequired<TargetLibraryInfoWrapperPass>();
   AU.addRequired<LoopInfoWrapperPass>();
@@ -101,6 +136,7 @@ void llvm::PDGBuilder::getAnalysisUsage(AnalysisUsage &AU) const {
 
   AU.addRequired< ProfilePerformanceEstimator >();
   AU.addRequired< Targets >();
+  AU.addRequired< TargetLoopHierarchy >();
   AU.addRequired< ModuleLoops >();
 
   AU.setPreservesAll();
@@ -108,13 +144,57 @@ void llvm::PDGBuilder::getAnalysisUsage(AnalysisUsage &AU) const {
 
 bool llvm::PDGBuilder::runOnModule (Module &M){
   DL = &M.getDataLayout();
-  if (DumpPDG) {
+  if (ReadPDG != "")
+    loadPDGs(M, ReadPDG);
+
+  if (DumpPDG || WritePDG != "" || VerifySCCDAG || VerifyCtrlClosure) {
+    std::unique_ptr<raw_fd_ostream> fout;
+    if (WritePDG != "") {
+      std::error_code ec;
+      fout = std::make_unique<raw_fd_ostream>(WritePDG, ec, sys::fs::F_Text);
+      if (ec) {
+        errs() << "Cannot open " << WritePDG << ": " << ec.message() << '\n';
+        fout.reset();
+      }
+    }
+
     // LoopProf is always required
     ModuleLoops &mloops = getAnalysis< ModuleLoops >();
     Targets &targets = getAnalysis< Targets >();
     for(Targets::iterator i=targets.begin(mloops), e=targets.end(mloops); i!=e; ++i) {
       Loop *loop = *i;
-      auto pdg = getLoopPDG(loop);
+      if (!targets.isWithinBudget(this)) {
+        errs() << "Time budget exhausted; not building the PDG of loop "
+               << loop->getHeader()->getParent()->getName()
+               << "::" << loop->getHeader()->getName() << " or colder loops\n";
+        break;
+      }
+      auto cpdg = getLoopCompactPDG(loop);
+      if (!cpdg) {
+        errs() << "Not building the PDG of unclassified loop "
+               << loop->getHeader()->getParent()->getName()
+               << "::" << loop->getHeader()->getName() << '\n';
+        continue;
+      }
+
+      if (fout && !cpdg->serialize(*fout))
+        errs() << "Cannot serialize PDG of loop "
+               << loop->getHeader()->getParent()->getName()
+               << "::" << loop->getHeader()->getName()
+               << ": instructions are not named\n";
+
+      if (VerifySCCDAG) {
+        // Every edge, then only those which cannot be removed.
+        verifyCompactSCCDAG(*cpdg, 0);
+        verifyCompactSCCDAG(*cpdg, ~0UL);
+      }
+
+      if (VerifyCtrlClosure)
+        verifyTransitiveControlDeps(*cpdg);
+
+      if (!DumpPDG)
+        continue;
+      auto pdg = cpdg->toPDG();
 
       // dump pdg to dot files
       std::string filename;
@@ -158,10 +238,12 @@ bool llvm::PDGBuilder::runOnModule (Module &M){
       }
       LoopAA *aa = getAnalysis< LoopAA >().getTopAA();
 
-      auto pdg = std::make_unique<arcana::noelle::PDG>(loop);
+      CompactPDG cpdg(loop);
+
+      queryLoopCarriedMemoryDep(src, dst, loop, aa, cpdg);
+      queryIntraIterationMemoryDep(src, dst, loop, aa, cpdg);
 
-      queryLoopCarriedMemoryDep(src, dst, loop, aa, *pdg);
-      queryIntraIterationMemoryDep(src, dst, loop, aa, *pdg);
+      auto pdg = cpdg.toPDG();
 
       for (auto edge: pdg->fetchEdges(pdg->fetchNode(src), pdg->fetchNode(dst))) {
         errs() << edge->toString() << "\n";
@@ -177,13 +259,37 @@ bool llvm::PDGBuilder::runOnModule (Module &M){
 }
 
 std::unique_ptr<arcana::noelle::PDG> llvm::PDGBuilder::getLoopPDG(Loop *loop) {
-  auto pdg = std::make_unique<arcana::noelle::PDG>(loop);
+  auto cpdg = getLoopCompactPDG(loop);
+  if (!cpdg)
+    return nullptr;
+  auto pdg = cpdg->toPDG();
+  REPORT_DUMP(errs() << "PDG conversion completed\n");
+  return pdg;
+}
+
+std::unique_ptr<CompactPDG> llvm::PDGBuilder::getLoopCompactPDG(Loop *loop) {
+  auto loaded = loadedPDGs.find(loop->getHeader());
+  if (loaded != loadedPDGs.end()) {
+    REPORT_DUMP(errs() << "Using PDG loaded from " << ReadPDG << "\n");
+    return std::make_unique<CompactPDG>(*loaded->second);
+  }
+
+  // The SpecPriv modules need the heap assignment of the loop
+  if (EnableSpecPriv && !getAnalysis<Classify>().isClassified(loop))
+    return nullptr;
+
+  auto pdg = std::make_unique<CompactPDG>(loop);
 
   REPORT_DUMP(errs() << "constructEdgesFromMemory with CAF ...\n");
   auto llvmaa = getAnalysisIfAvailable<LLVMAAResults>();
   if (llvmaa) {
     llvmaa->computeAAResults(loop->getHeader()->getParent());
   }
+
+  // Complete the stack before the first query, so that its caches
+  // are only invalidated by the per-loop retargeting below.
+  addSpecModulesToLoopAA(loop);
+
   LoopAA *aa = getAnalysis< LoopAA >().getTopAA();
   aa->dump();
   constructEdgesFromMemory(*pdg, loop, aa);
@@ -197,7 +303,7 @@ std::unique_ptr<arcana::noelle::PDG> llvm::PDGBuilder::getLoopPDG(Loop *loop) {
 
   REPORT_DUMP(errs() << "construct Edges From UseDefs ...\n");
 
-  // constructEdgesFromUseDefs adds external nodes for live-ins and live-outs
+  // external nodes for live-ins and live-outs are only added by toPDG()
   constructEdgesFromUseDefs(*pdg, loop);
 
   REPORT_DUMP(errs() << "PDG construction completed\n");
@@ -205,25 +311,170 @@ std::unique_ptr<arcana::noelle::PDG> llvm::PDGBuilder::getLoopPDG(Loop *loop) {
   return pdg;
 }
 
-void llvm::PDGBuilder::addSpecModulesToLoopAA() {
+bool llvm::PDGBuilder::verifyCompactSCCDAG(const CompactPDG &cpdg,
+                                           unsigned long budget) {
+  CompactSCCDAG compact(cpdg);
+  compact.compute(budget);
+
+  auto pdg = cpdg.toPDG(budget);
+  SCCDAG sccdag(pdg.get());
+
+  // The partitions are the same iff the SCCs correspond one to one.
+  const unsigned N = cpdg.getNumInstructions();
+  std::unordered_map<SCC *, unsigned> toCompact;
+  std::vector<SCC *> toNoelle(compact.getNumSCCs(), nullptr);
+  for (unsigned i = 0; i < N; ++i) {
+    Instruction *inst = cpdg.getInstruction(i);
+    SCC *scc = sccdag.sccOfValue(inst);
+    const unsigned c = compact.getSCC(i);
+
+    auto res = toCompact.insert(std::make_pair(scc, c));
+    if (!toNoelle[c])
+      toNoelle[c] = scc;
+
+    if (res.first->second != c || toNoelle[c] != scc) {
+      Loop *loop = cpdg.getLoop();
+      errs() << "CompactSCCDAG differs from SCCDAG for loop "
+             << loop->getHeader()->getParent()->getName()
+             << "::" << loop->getHeader()->getName() << " with budget "
+             << budget << " at " << *inst << '\n';
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool llvm::PDGBuilder::verifyTransitiveControlDeps(const CompactPDG &cpdg) {
+  const unsigned CtrlII =
+      CompactPDG::getKind(CompactPDG::CtrlDep, CompactPDG::DataRAW, false);
+  TransitiveControlDeps closure(cpdg);
+
+  // Search from each operation in turn.
+  const unsigned N = cpdg.getNumInstructions();
+  for (unsigned src = 0; src < N; ++src) {
+    BitVector reached(N);
+    std::vector<unsigned> fringe(1, src);
+    while (!fringe.empty()) {
+      const unsigned s = fringe.back();
+      fringe.pop_back();
+      for (int d = cpdg.firstSuccessor(CtrlII, s); d >= 0;
+           d = cpdg.nextSuccessor(CtrlII, s, d))
+        if (!reached.test(d)) {
+          reached.set(d);
+          fringe.push_back(d);
+        }
+    }
+
+    for (unsigned dst = 0; dst < N; ++dst) {
+      if (closure.isControlDependent(src, dst) == reached.test(dst))
+        continue;
+
+      Loop *loop = cpdg.getLoop();
+      errs() << "TransitiveControlDeps differs from the naive closure "
+             << "for loop " << loop->getHeader()->getParent()->getName()
+             << "::" << loop->getHeader()->getName() << " from "
+             << *cpdg.getInstruction(src) << " to "
+             << *cpdg.getInstruction(dst) << '\n';
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void llvm::PDGBuilder::loadPDGs(Module &M, StringRef filename) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> buffer =
+      MemoryBuffer::getFile(filename);
+  if (!buffer) {
+    errs() << "Cannot read " << filename << ": "
+           << buffer.getError().message() << '\n';
+    return;
+  }
+
+  std::unordered_map<int, BasicBlock *> blocks;
+  for (Function &F : M)
+    for (BasicBlock &BB : F) {
+      int id = Namer::getBlkId(&BB);
+      if (id >= 0)
+        blocks[id] = &BB;
+    }
+
+  ModuleLoops &mloops = getAnalysis< ModuleLoops >();
+
+  // Edge records belong to the most recent loop record.  Drop any
+  // loop which does not match this module.
+  CompactPDG *current = nullptr;
+  const BasicBlock *currentHeader = nullptr;
+  unsigned lineNo = 0;
+  for (line_iterator line(**buffer), end; line != end; ++line) {
+    ++lineNo;
+
+    Expected<json::Value> value = json::parse(*line);
+    const json::Object *record = value ? value->getAsObject() : nullptr;
+    if (!record) {
+      if (!value)
+        consumeError(value.takeError());
+      errs() << filename << ":" << lineNo << ": malformed record\n";
+      continue;
+    }
+
+    int loopId = CompactPDG::getSerializedLoopId(*record);
+    if (loopId < 0) {
+      if (current && !current->deserializeEdge(*record)) {
+        errs() << filename << ":" << lineNo << ": bad edge, dropping loop\n";
+        loadedPDGs.erase(currentHeader);
+        current = nullptr;
+      }
+      continue;
+    }
+
+    current = nullptr;
+    if (!blocks.count(loopId))
+      continue;
+
+    BasicBlock *header = blocks[loopId];
+    Loop *loop =
+        mloops.getAnalysis_LoopInfo(header->getParent()).getLoopFor(header);
+    if (!loop || loop->getHeader() != header)
+      continue;
+
+    auto pdg = std::make_unique<CompactPDG>(loop);
+    if (!pdg->matchesSerializedLoop(*record))
+      continue;
+
+    current = pdg.get();
+    currentHeader = header;
+    loadedPDGs[header] = std::move(pdg);
+  }
+
+  REPORT_DUMP(errs() << "Loaded " << loadedPDGs.size() << " PDGs from "
+                     << filename << "\n");
+}
+
+void llvm::PDGBuilder::addSpecModulesToLoopAA(Loop *loop) {
+  if (nestaa)
+    return;
+
+  // Reuse facts between nested target loops
+  nestaa = new LoopNestCacheAA(getAnalysis< TargetLoopHierarchy >());
+  nestaa->InitializeLoopAA(this, *DL);
+
   PerformanceEstimator *perf = &getAnalysis<ProfilePerformanceEstimator>();
 
   if (EnableLamp) {
     auto &smtxMan = getAnalysis<SmtxSpeculationManager>();
-    smtxaa = new SmtxAA(&smtxMan, perf); // LAMP
-    smtxaa->InitializeLoopAA(this, *DL);
+    smtxaa = addSpecModule<SmtxAA>(&smtxMan, perf); // LAMP
   }
 
   if (EnableSlamp) {
     auto &slamp = getAnalysis<SLAMPLoadProfile>();
-    slampaa = new SlampOracleAA(&slamp);
-    slampaa->InitializeLoopAA(this, *DL);
+    slampaa = addSpecModule<SlampOracleAA>(&slamp);
   }
 
   if (EnableEdgeProf) {
     ctrlspec = getAnalysis<ProfileGuidedControlSpeculator>().getControlSpecPtr();
-    edgeaa = new EdgeCountOracle(ctrlspec); // Control Spec
-    edgeaa->InitializeLoopAA(this, *DL);
+    edgeaa = addSpecModule<EdgeCountOracle>(ctrlspec); // Control Spec
     //killflow_aware = &getAnalysis<KillFlow_CtrlSpecAware>(); // KillFlow
     //callsite_aware = &getAnalysis<CallsiteDepthCombinator_CtrlSpecAware>(); // CallsiteDepth
   }
@@ -231,13 +482,11 @@ void llvm::PDGBuilder::addSpecModulesToLoopAA() {
   if (EnableSpecPriv) {
     predspec =
       getAnalysis<ProfileGuidedPredictionSpeculator>().getPredictionSpecPtr();
-    predaa = new PredictionAA(predspec, perf); //Value Prediction 
-    predaa->InitializeLoopAA(this, *DL);
+    predaa = addSpecModule<PredictionAA>(predspec, perf); //Value Prediction 
 
     PtrResidueSpeculationManager &ptrresMan =
       getAnalysis<PtrResidueSpeculationManager>();
-    ptrresaa = new PtrResidueAA(*DL, ptrresMan, perf); // Pointer Residue SpecPriv
-    ptrresaa->InitializeLoopAA(this, *DL);
+    ptrresaa = addSpecModule<PtrResidueAA>(*DL, ptrresMan, perf); // Pointer Residue SpecPriv
 
     spresults = &getAnalysis<ReadPass>().getProfileInfo(); // SpecPriv Results
     classify = &getAnalysis<Classify>(); // SpecPriv Classify
@@ -245,24 +494,24 @@ void llvm::PDGBuilder::addSpecModulesToLoopAA() {
     // cannot validate points-to object info.
     // should only be used within localityAA validation only for points-to heap
     // use it to explore coverage. points-to is always avoided
-    pointstoaa = new PointsToAA(*spresults);
-    pointstoaa->InitializeLoopAA(this, *DL);
+    pointstoaa = addSpecModule<PointsToAA>(*spresults);
+
+    // Moved to each loop's heap assignment by specModulesLoopSetup()
+    const HeapAssignment &asgn = classify->getAssignmentFor(loop);
+    const Ctx *ctx = spresults->getCtx(loop);
+    roaa = addSpecModule<ReadOnlyAA>(*spresults, asgn, ctx, perf);
+    localaa = addSpecModule<ShortLivedAA>(*spresults, asgn, ctx, perf);
   }
 
   // FIXME: try to add txio and commlib back to PDG Building
-  txioaa = new TXIOAA();
-  txioaa->InitializeLoopAA(this, *DL);
+  txioaa = addSpecModule<TXIOAA>();
 
-  commlibsaa = new CommutativeLibsAA();
-  commlibsaa->InitializeLoopAA(this, *DL);
+  commlibsaa = addSpecModule<CommutativeLibsAA>();
 
-  simpleaa = new SimpleAA();
-  simpleaa->InitializeLoopAA(this, *DL);
+  simpleaa = addSpecModule<SimpleAA>();
 }
 
 void llvm::PDGBuilder::specModulesLoopSetup(Loop *loop) {
-  PerformanceEstimator *perf = &getAnalysis<ProfilePerformanceEstimator>();
-
   if (EnableEdgeProf) {
     ctrlspec->setLoopOfInterest(loop->getHeader());
     //killflow_aware->setLoopOfInterest(ctrlspec, loop);
@@ -280,138 +529,106 @@ void llvm::PDGBuilder::specModulesLoopSetup(Loop *loop) {
     }
 
     const Ctx *ctx = spresults->getCtx(loop);
-    roaa = new ReadOnlyAA(*spresults, asgn, ctx, perf);
-    roaa->InitializeLoopAA(this, *DL);
-
-    localaa = new ShortLivedAA(*spresults, asgn, ctx, perf);
-    localaa->InitializeLoopAA(this, *DL);
+    roaa->setAssignment(asgn, ctx);
+    localaa->setAssignment(asgn, ctx);
   }
+
+  for (LoopTarget *module : specModules)
+    module->setLoop(loop);
+
+  // The other modules may have cached answers given without them.
+  // Only those which reached the speculation modules are dropped.
+  getAnalysis< LoopAA >().getRealTopAA()->stackHasChanged(
+      getSpecModulesPosition());
 }
 
-void llvm::PDGBuilder::removeSpecModulesFromLoopAA() {
-  // c++ guarantee that if null nothing bad will happen
-  delete slampaa;
-  delete smtxaa;
-  delete edgeaa;
-  delete predaa;
-  delete ptrresaa;
-  delete pointstoaa;
-  delete roaa;
-  delete localaa;
-  delete txioaa;
-  delete commlibsaa;
-  delete simpleaa;
+void llvm::PDGBuilder::retireSpecModules(Loop *loop) {
+  for (LoopTarget *module : specModules)
+    module->setLoop(nullptr);
+
+  // ... or with them.
+  LoopAA *top = getAnalysis< LoopAA >().getRealTopAA();
+  top->stackHasChanged(getSpecModulesPosition());
+  top->loopHasFinished(loop);
+
   if (killflow_aware) {
     killflow_aware->setLoopOfInterest(nullptr, nullptr);
   }
 }
 
-void llvm::PDGBuilder::constructEdgesFromUseDefs(PDG &pdg, Loop *loop) {
-  for (auto inodePair : pdg.internalNodePairs()) {
-    Value *pdgValue = inodePair.first;
-    if (pdgValue->getNumUses() == 0)
-      continue;
-
-    for (auto &U : pdgValue->uses()) {
-      auto user = U.getUser();
-
-      // is argument possible here?
-      if (isa<Instruction>(user) || isa<Argument>(user)) {
-        const PHINode *phi = dyn_cast<PHINode>(user);
-        bool loopCarried = (phi && phi->getParent() == loop->getHeader());
-
-        // add external node if not already there. Used for live-outs
-        if (!pdg.isInternal(user))
-          pdg.fetchOrAddNode(user, /*internal=*/ false);
-
-        auto edge = pdg.addEdge(pdgValue, user);
-        edge->setMemMustType(false, true, DG_DATA_RAW);
-        edge->setLoopCarried(loopCarried);
-      }
-    }
-
-    // add register dependences and external nodes for live-ins
-    Instruction *user = dyn_cast<Instruction>(pdgValue);
-    assert(user && "A node of loop pdg is not an Instruction");
-
-    // For each user's (loop inst) operand which is not loop instruction,
-    // add reg dep (deps among loop insts are already added)
-    for (User::op_iterator j = user->op_begin(), z = user->op_end(); j != z;
-         ++j) {
-      Value *operand = *j;
-
-      if (!pdg.isInternal(operand) &&
-          (isa<Instruction>(operand) || isa<Argument>(operand))) {
-        pdg.fetchOrAddNode(operand, /*internal=*/false);
+// The first speculation module from the top of the stack, or aa if
+// there is none.  The modules from there down are the cheap ones
+// below the memory analysis modules, while the speculation modules
+// are not targeted to a loop.
+LoopAA *llvm::PDGBuilder::getSpecModulesAA(LoopAA *aa) const {
+  std::set<const LoopAA *> modules;
+  for (LoopTarget *module : specModules)
+    modules.insert(module->getLoopAA());
+  LoopAA *first = aa->getRealTopAA();
+  while (first && !modules.count(first))
+    first = first->getNextAA();
+  return first ? first : aa;
+}
 
-        auto edge = pdg.addEdge(operand, user);
-        edge->setMemMustType(false, true, DG_DATA_RAW);
-      }
-    }
-  }
+// The highest position of a speculation module.  Cached answers which
+// did not consult the stack that far down did not reach any of them.
+unsigned llvm::PDGBuilder::getSpecModulesPosition() const {
+  unsigned position = 0;
+  for (LoopTarget *module : specModules)
+    position = std::max(position, module->getLoopAA()->getStackPosition());
+  return position;
 }
 
-void buildTransitiveIntraIterationControlDependenceCache(
-    Loop *loop, PDG &pdg, PDG &IICtrlPDG,
-    std::unordered_map<const Instruction *,
-                       std::unordered_set<const Instruction *>>
-        cache) {
-  std::list<Instruction *> fringe;
+void llvm::PDGBuilder::releaseMemory() {
+  for (LoopTarget *module : specModules)
+    delete module;
+  specModules.clear();
+
+  slampaa = 0;
+  smtxaa = 0;
+  edgeaa = 0;
+  predaa = 0;
+  ptrresaa = 0;
+  pointstoaa = 0;
+  roaa = 0;
+  localaa = 0;
+  txioaa = 0;
+  commlibsaa = 0;
+  simpleaa = 0;
+
+  delete nestaa;
+  nestaa = 0;
+}
 
-  // initialization phase (populate IICtrlPDG with II ctrl deps from pdg)
+void llvm::PDGBuilder::constructEdgesFromUseDefs(CompactPDG &pdg, Loop *loop) {
+  const unsigned RegRAW =
+      CompactPDG::getKind(CompactPDG::RegDep, CompactPDG::DataRAW, false);
+  const unsigned RegRAWLC =
+      CompactPDG::getKind(CompactPDG::RegDep, CompactPDG::DataRAW, true);
 
-  for (Loop::block_iterator j = loop->block_begin(), z = loop->block_end();
-       j != z; ++j)
-    for (BasicBlock::iterator k = (*j)->begin(), g = (*j)->end(); k != g; ++k) {
-      Instruction *inst = &*k;
-      fringe.push_back(inst);
+  for (unsigned i = 0, N = pdg.getNumInstructions(); i < N; ++i) {
+    Instruction *def = pdg.getInstruction(i);
 
-      auto s = pdg.fetchNode(inst);
-      for (auto edge : s->getOutgoingEdges()) {
-        if (!edge->isControlDependence() || edge->isLoopCarriedDependence())
-          continue;
-        Instruction *si =
-            dyn_cast<Instruction>(edge->getIncomingT());
-        assert(si);
-        cache[inst].insert(si);
-        IICtrlPDG.addEdge((Value *)inst, (Value *)si);
-      }
-    }
+    // Register dependences to live-outs are drawn by toPDG()
+    for (auto &U : def->uses()) {
+      auto user = U.getUser();
+      if (!pdg.hasIndex(user))
+        continue;
 
-  // update cache iteratively
-
-  while (!fringe.empty()) {
-    Instruction *v = fringe.front();
-    fringe.pop_front();
-
-    std::vector<Instruction *> updates;
-
-    auto vN = IICtrlPDG.fetchNode(v);
-    for (auto edge : vN->getOutgoingEdges()) {
-      Instruction *m = dyn_cast<Instruction>(edge->getIncomingT());
-      assert(m);
-      auto mN = IICtrlPDG.fetchNode(m);
-      for (auto edgeM : mN->getOutgoingEdges()) {
-        Instruction *k =
-            dyn_cast<Instruction>(edgeM->getIncomingT());
-        assert(k);
-        if (!cache.count(v) || !cache[v].count(k))
-          updates.push_back(k);
-      }
-    }
+      const PHINode *phi = dyn_cast<PHINode>(user);
+      bool loopCarried = (phi && phi->getParent() == loop->getHeader());
 
-    if (!updates.empty()) {
-      for (unsigned i = 0 ; i < updates.size() ; i++) {
-        cache[v].insert(updates[i]);
-        IICtrlPDG.addEdge((Value *)v, (Value *)updates[i]);
-      }
-      fringe.push_back(v);
+      pdg.addEdge(loopCarried ? RegRAWLC : RegRAW, i, pdg.getIndex(user));
     }
   }
 }
 
 void llvm::PDGBuilder::constructEdgesFromControl(
-    PDG &pdg, Loop *loop) {
+    CompactPDG &pdg, Loop *loop) {
+  const unsigned CtrlII =
+      CompactPDG::getKind(CompactPDG::CtrlDep, CompactPDG::DataRAW, false);
+  const unsigned CtrlLC =
+      CompactPDG::getKind(CompactPDG::CtrlDep, CompactPDG::DataRAW, true);
 
   noctrlspec.setLoopOfInterest(loop->getHeader());
   SpecPriv::LoopPostDom pdt(noctrlspec, loop);
@@ -435,9 +652,7 @@ void llvm::PDGBuilder::constructEdgesFromControl(
         if (isSafeToSpeculativelyExecute(idst))
           continue;
 
-        auto edge = pdg.addEdge((Value *)term, (Value *)idst);
-        edge->setControl(true);
-        edge->setLoopCarried(false);
+        pdg.addEdge(CtrlII, pdg.getIndex(term), pdg.getIndex(idst));
       }
     }
   }
@@ -474,9 +689,8 @@ void llvm::PDGBuilder::constructEdgesFromControl(
         if( phi->getNumIncomingValues() == 1 )
           continue;
 
-        auto edge = pdg.addEdge((Value *)term, (Value *)phi);
-        edge->setControl(true);
-        edge->setLoopCarried(loop_carried);
+        pdg.addEdge(loop_carried ? CtrlLC : CtrlII, pdg.getIndex(term),
+                    pdg.getIndex(phi));
       }
     }
   }
@@ -486,12 +700,8 @@ void llvm::PDGBuilder::constructEdgesFromControl(
   typedef ControlSpeculation::ExitingBlocks Exitings;
 
   /*
-  // build a tmp pdg that holds transitive II-ctrl dependence info
-  std::unordered_map<const Instruction *,
-                     std::unordered_set<const Instruction *>>
-      IICtrlCache;
-  PDG IICtrlPDG(loop);
-  buildTransitiveIntraIterationControlDependenceCache(loop, pdg, IICtrlPDG, IICtrlCache);
+  // transitive II-ctrl dependence info
+  TransitiveControlDeps IICtrl(pdg);
   */
 
   Exitings exitings;
@@ -528,27 +738,61 @@ void llvm::PDGBuilder::constructEdgesFromControl(
         /*
         // TODO: double-check if this is actually useful. Be more conservative
         for now to speedupthe PDG's control dep construction
-        if (IICtrlCache.count(term)) if (IICtrlCache[term].count(idst)) continue;
+        if (IICtrl.isControlDependent(pdg.getIndex(term), pdg.getIndex(idst)))
+          continue;
         */
 
         // errs() << "new LC ctrl dep between " << *term << " and " << *idst <<
         // "\n";
-        auto edge = pdg.addEdge((Value *)term, (Value *)idst);
-        edge->setControl(true);
-        edge->setLoopCarried(true);
+        pdg.addEdge(CtrlLC, pdg.getIndex(term), pdg.getIndex(idst));
       }
     }
   }
 }
 
-void llvm::PDGBuilder::constructEdgesFromMemory(PDG &pdg, Loop *loop,
+// What an operation may do to memory, whatever it accesses
+static LoopAA::ModRefResult mayModRef(const Instruction *inst) {
+  return LoopAA::ModRefResult(
+      (inst->mayWriteToMemory() ? LoopAA::Mod : LoopAA::NoModRef) |
+      (inst->mayReadFromMemory() ? LoopAA::Ref : LoopAA::NoModRef));
+}
+
+// Control speculation removes every dependence of a speculatively
+// dead operation.  One remedy per dependence, like the remedies
+// of ControlSpecRemediator and EdgeCountOracle.
+static Remedies_ptr getDeadOpRemedies() {
+  auto remedy = std::make_shared<ControlSpecRemedy>();
+  remedy->cost = DEFAULT_CTRL_REMED_COST;
+  remedy->brI = nullptr;
+  auto R = std::make_shared<Remedies>();
+  R->insert(remedy);
+  return R;
+}
+
+void llvm::PDGBuilder::constructEdgesFromMemory(CompactPDG &pdg, Loop *loop,
                                                  LoopAA *aa) {
   noctrlspec.setLoopOfInterest(loop->getHeader());
   unsigned long memDepQueryCnt = 0;
-  for (auto nodeI : make_range(pdg.begin_nodes(), pdg.end_nodes())) {
-    Value *pdgValueI = nodeI->getT();
-    Instruction *i = dyn_cast<Instruction>(pdgValueI);
-    assert(i && "Expecting an instruction as the value of a PDG node");
+  unsigned long deadPairCnt = 0;
+  const unsigned N = pdg.getNumInstructions();
+
+  // Control speculation removes every dependence of an operation
+  // in a speculatively dead block; only ask the cheap modules at
+  // the bottom of the stack about them.
+  BitVector dead(N);
+  LoopAA *deadAA = aa;
+  if (EnableEdgeProf && SkipDeadQueries) {
+    deadAA = getSpecModulesAA(aa);
+    ControlSpeculation *deadspec =
+        getAnalysis<ProfileGuidedControlSpeculator>().getControlSpecPtr();
+    deadspec->setLoopOfInterest(loop->getHeader());
+    for (unsigned ii = 0; ii < N; ++ii)
+      if (deadspec->isSpeculativelyDead(pdg.getInstruction(ii)->getParent()))
+        dead.set(ii);
+  }
+
+  for (unsigned ii = 0; ii < N; ++ii) {
+    Instruction *i = pdg.getInstruction(ii);
 
     if (!i->mayReadOrWriteMemory())
       continue;
@@ -559,10 +803,8 @@ void llvm::PDGBuilder::constructEdgesFromMemory(PDG &pdg, Loop *loop,
         continue;
     }
 
-    for (auto nodeJ : make_range(pdg.begin_nodes(), pdg.end_nodes())) {
-      Value *pdgValueJ = nodeJ->getT();
-      Instruction *j = dyn_cast<Instruction>(pdgValueJ);
-      assert(j && "Expecting an instruction as the value of a PDG node");
+    for (unsigned jj = 0; jj < N; ++jj) {
+      Instruction *j = pdg.getInstruction(jj);
 
       if (!j->mayReadOrWriteMemory())
         continue;
@@ -573,6 +815,16 @@ void llvm::PDGBuilder::constructEdgesFromMemory(PDG &pdg, Loop *loop,
           continue;
       }
 
+      if (dead.test(ii) || dead.test(jj)) {
+        ++deadPairCnt;
+        queryMemoryDep(i, j, LoopAA::Before, LoopAA::After, loop, deadAA, pdg,
+                       true);
+        if (noctrlspec.isReachable(i, j, loop))
+          queryMemoryDep(i, j, LoopAA::Same, LoopAA::Same, loop, deadAA, pdg,
+                         true);
+        continue;
+      }
+
       ++memDepQueryCnt;
 
       queryLoopCarriedMemoryDep(i, j, loop, aa, pdg);
@@ -581,6 +833,42 @@ void llvm::PDGBuilder::constructEdgesFromMemory(PDG &pdg, Loop *loop,
   }
   REPORT_DUMP(errs() << "Total memory dependence queries to CAF: " << memDepQueryCnt
                << "\n");
+  REPORT_DUMP(errs() << "Speculatively dead pairs queried cheaply: " << deadPairCnt
+               << "\n");
+}
+
+// Draw the flow-, anti- and output-dependences from src to dst implied
+// by the forward and reverse results, removable by control speculation
+// if either operation is speculatively dead.
+void llvm::PDGBuilder::addMemoryDep(Instruction *src, Instruction *dst,
+                                    bool loopCarried,
+                                    LoopAA::ModRefResult forward,
+                                    LoopAA::ModRefResult reverse,
+                                    CompactPDG &pdg, bool dead) {
+  if (LoopAA::NoModRef == forward || LoopAA::NoModRef == reverse)
+    return;
+
+  bool RAW = (forward == LoopAA::Mod || forward == LoopAA::ModRef) &&
+             (reverse == LoopAA::Ref || reverse == LoopAA::ModRef);
+  bool WAR = (forward == LoopAA::Ref || forward == LoopAA::ModRef) &&
+             (reverse == LoopAA::Mod || reverse == LoopAA::ModRef);
+  bool WAW = (forward == LoopAA::Mod || forward == LoopAA::ModRef) &&
+             (reverse == LoopAA::Mod || reverse == LoopAA::ModRef);
+
+  const unsigned s = pdg.getIndex(src), d = pdg.getIndex(dst);
+  auto add = [&](CompactPDG::DataType data) {
+    const unsigned kind =
+        CompactPDG::getKind(CompactPDG::MemDep, data, loopCarried);
+    pdg.addEdge(kind, s, d);
+    if (dead)
+      pdg.setRemedies(kind, s, d, getDeadOpRemedies());
+  };
+  if (RAW)
+    add(CompactPDG::DataRAW);
+  if (WAR)
+    add(CompactPDG::DataWAR);
+  if (WAW)
+    add(CompactPDG::DataWAW);
 }
 
 // query memory dep conservatively (with only memory analysis modules in the
@@ -588,7 +876,7 @@ void llvm::PDGBuilder::constructEdgesFromMemory(PDG &pdg, Loop *loop,
 void llvm::PDGBuilder::queryMemoryDep(Instruction *src, Instruction *dst,
                                       LoopAA::TemporalRelation FW,
                                       LoopAA::TemporalRelation RV, Loop *loop,
-                                      LoopAA *aa, PDG &pdg) {
+                                      LoopAA *aa, CompactPDG &pdg, bool dead) {
   if (!src->mayReadOrWriteMemory())
     return;
   if (!dst->mayReadOrWriteMemory())
@@ -632,42 +920,25 @@ void llvm::PDGBuilder::queryMemoryDep(Instruction *src, Instruction *dst,
 
   // At this point, we know there is one or more of
   // a flow-, anti-, or output-dependence.
+  addMemoryDep(src, dst, loopCarried, forward, reverse, pdg, dead);
 
-  bool RAW = (forward == LoopAA::Mod || forward == LoopAA::ModRef) &&
-             (reverse == LoopAA::Ref || reverse == LoopAA::ModRef);
-  bool WAR = (forward == LoopAA::Ref || forward == LoopAA::ModRef) &&
-             (reverse == LoopAA::Mod || reverse == LoopAA::ModRef);
-  bool WAW = (forward == LoopAA::Mod || forward == LoopAA::ModRef) &&
-             (reverse == LoopAA::Mod || reverse == LoopAA::ModRef);
-
-  if (RAW) {
-    auto edge = pdg.addEdge((Value *)src, (Value *)dst);
-    edge->setMemMustType(true, false, DG_DATA_RAW);
-    edge->setLoopCarried(loopCarried);
-  }
-  if (WAR) {
-    auto edge = pdg.addEdge((Value *)src, (Value *)dst);
-    edge->setMemMustType(true, false, DG_DATA_WAR);
-    edge->setLoopCarried(loopCarried);
-  }
-  if (WAW) {
-    auto edge = pdg.addEdge((Value *)src, (Value *)dst);
-    edge->setMemMustType(true, false, DG_DATA_WAW);
-    edge->setLoopCarried(loopCarried);
-  }
+  // Did the memory analysis modules know anything
+  // beyond what src and dst may do?
+  if (forward == mayModRef(src) && reverse == mayModRef(dst))
+    pdg.setConservative(loopCarried, pdg.getIndex(src), pdg.getIndex(dst));
 }
 
 void llvm::PDGBuilder::queryIntraIterationMemoryDep(Instruction *src,
                                                      Instruction *dst,
                                                      Loop *loop, LoopAA *aa,
-                                                     PDG &pdg) {
+                                                     CompactPDG &pdg) {
   if (noctrlspec.isReachable(src, dst, loop))
     queryMemoryDep(src, dst, LoopAA::Same, LoopAA::Same, loop, aa, pdg);
 }
 
 void llvm::PDGBuilder::queryLoopCarriedMemoryDep(Instruction *src,
                                                  Instruction *dst, Loop *loop,
-                                                 LoopAA *aa, PDG &pdg) {
+                                                 LoopAA *aa, CompactPDG &pdg) {
   // there is always a feasible path for inter-iteration deps
   // (there is a path from any node in the loop to the header
   //  and the header dominates all the nodes of the loops)
@@ -677,47 +948,59 @@ void llvm::PDGBuilder::queryLoopCarriedMemoryDep(Instruction *src,
   queryMemoryDep(src, dst, LoopAA::Before, LoopAA::After, loop, aa, pdg);
 }
 
-void llvm::PDGBuilder::annotateMemDepsWithRemedies(PDG &pdg, Loop *loop,
+void llvm::PDGBuilder::annotateMemDepsWithRemedies(CompactPDG &pdg, Loop *loop,
                                                    LoopAA *aa) {
-  // setup SCAF (add spec modules to stack)
-  addSpecModulesToLoopAA();
+  // setup SCAF (target spec modules to this loop)
   specModulesLoopSetup(loop);
   aa->dump();
 
-  // try to annotate as removable every edge in the PDG with SCAF
-  for (auto edge : make_range(pdg.begin_edges(), pdg.end_edges())) {
+  // Where the memory analysis modules gave no answer, start at the
+  // first speculation module instead of asking them again.
+  // Recursive queries still go to the top of the stack.
+  LoopAA *resumeAA = getSpecModulesAA(aa);
 
-    if (!pdg.isInternal(edge->getIncomingT()) ||
-        !pdg.isInternal(edge->getOutgoingT()))
+  // try to annotate as removable every memory edge in the PDG with SCAF
+  for (unsigned kind = 0; kind < CompactPDG::NumKinds; ++kind) {
+    if (CompactPDG::getDepType(kind) != CompactPDG::MemDep)
       continue;
 
-    Instruction *src = dyn_cast<Instruction>(edge->getOutgoingT());
-    Instruction *dst = dyn_cast<Instruction>(edge->getIncomingT());
-    assert(src && dst && "src/dst not instructions in the PDG?");
-
-    Remedies_ptr R = std::make_shared<Remedies>();
-    bool rawDep = edge->isRAWDependence();
-    bool wawDep = edge->isWAWDependence();
+    bool rawDep = CompactPDG::getDataType(kind) == CompactPDG::DataRAW;
+    bool wawDep = CompactPDG::getDataType(kind) == CompactPDG::DataWAW;
 
     LoopAA::TemporalRelation FW = LoopAA::Same;
     LoopAA::TemporalRelation RV = LoopAA::Same;
-    if (edge->isLoopCarriedDependence()) {
+    if (CompactPDG::isLoopCarried(kind)) {
       FW = LoopAA::Before;
       RV = LoopAA::After;
     }
 
-    bool removableEdge =
-        Remediator::noMemoryDep(src, dst, FW, RV, loop, aa, rawDep, wawDep, *R);
+    for (unsigned s = 0, N = pdg.getNumInstructions(); s < N; ++s)
+      for (int d = pdg.firstSuccessor(kind, s); d >= 0;
+           d = pdg.nextSuccessor(kind, s, d)) {
+        // Already removable by control speculation
+        if (pdg.isRemovable(kind, s, d))
+          continue;
 
-    // annotate edge if removable
-    if (removableEdge) {
-      edge->addRemedies(R);
-      edge->setRemovable(true);
-    }
+        Instruction *src = pdg.getInstruction(s);
+        Instruction *dst = pdg.getInstruction(d);
+
+        LoopAA *queryAA =
+            pdg.isConservative(CompactPDG::isLoopCarried(kind), s, d)
+                ? resumeAA
+                : aa;
+
+        Remedies_ptr R = std::make_shared<Remedies>();
+        bool removableEdge = Remediator::noMemoryDep(
+            src, dst, FW, RV, loop, queryAA, rawDep, wawDep, *R);
+
+        // annotate edge if removable
+        if (removableEdge)
+          pdg.setRemedies(kind, s, d, R);
+      }
   }
 
   // LLVM_DEBUG(errs() << "revert stack to CAF ...\n");
-  removeSpecModulesFromLoopAA();
+  retireSpecModules(loop);
 }
 
 char PDGBuilder::ID = 0;
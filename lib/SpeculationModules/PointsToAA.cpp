@@ -24,6 +24,10 @@ bool PointsToRemedy::compare(const Remedy_ptr rhs) const {
   return this->ptr1 < pointstoRhs->ptr1;
 }
 
+LoopAA::RemedyRank PointsToAA::getMinRemedyRank() const {
+  return RemedyRank(true, true, DEFAULT_POINTS_TO_REMED_COST);
+}
+
 LoopAA::AliasResult PointsToAA::aliasCheck(
     const Pointer &P1,
     TemporalRelation rel,
@@ -1,3 +1,5 @@
+#include "llvm/ADT/Hashing.h"
+
 #include "scaf/SpeculationModules/PointsToProfiler/Pieces.h"
 
 namespace liberty
@@ -86,6 +88,31 @@ bool Ctx::step_equal(const Ctx *other) const
   return true;
 }
 
+uint64_t Ctx::step_bit() const
+{
+  hash_code h = hash_combine( (unsigned) type );
+  if( type == Ctx_Fcn )
+    h = hash_combine(h, fcn);
+  else if( type == Ctx_Loop )
+    h = hash_combine(h, header, depth);
+
+  return 1ull << ( ((size_t) h) % 64 );
+}
+
+void Ctx::computeEncoding()
+{
+  numSteps = 0;
+  stepMask = 0;
+  innermostLoop = 0;
+  for(const Ctx *i=this; i; i=i->parent)
+  {
+    ++numSteps;
+    stepMask |= i->step_bit();
+    if( !innermostLoop && i->type == Ctx_Loop )
+      innermostLoop = i;
+  }
+}
+
 bool Ctx::matches(const Ctx *cc) const
 {
   if( !cc )
@@ -93,34 +120,46 @@ bool Ctx::matches(const Ctx *cc) const
   else if( !this )
     return false;
 
-  for(const Ctx *i=this; i; i=i->parent)
+  // Quick rejects: cc cannot be a subsequence of a shorter
+  // chain, nor of one which lacks any of its steps.
+  if( numSteps && cc->numSteps )
   {
-    if( ! i->step_equal(cc) )
-      continue;
-
-    const Ctx *j=i, *k = cc;
-    while( j && k )
-    {
-      if( j->step_equal(k) )
-      {
-        j = j->parent;
-        k = k->parent;
-      }
-      else
-      {
-        j = j->parent;
-      }
-    }
+    if( cc->numSteps > numSteps )
+      return false;
+    if( cc->stepMask & ~stepMask )
+      return false;
+  }
 
-    if( !k )
+  // Greedily match the steps of cc, innermost first.
+  // If any embedding of cc exists, the greedy one does.
+  const Ctx *j=this, *k=cc;
+  while( j && k )
+  {
+    // Interned contexts: the remaining chains are identical.
+    if( j == k )
       return true;
+
+    if( j->step_equal(k) )
+      k = k->parent;
+
+    j = j->parent;
   }
 
-  return false;
+  return !k;
 }
 
 bool Ctx::isWithinSubloopOf(const Ctx *cc) const
 {
+  // The first loop along this chain decides, unless cc is
+  // a function which we might reach before any loop.
+  if( numSteps && innermostLoop )
+  {
+    if( cc->type == Ctx_Loop )
+      return innermostLoop->header != cc->header;
+    if( cc->type == Ctx_Top )
+      return true;
+  }
+
   for(const Ctx *i=this; i; i=i->parent)
   {
     // Have we reached cc yet?
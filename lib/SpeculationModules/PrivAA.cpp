@@ -24,6 +24,7 @@ using namespace llvm;
 using namespace arcana::noelle;
 
 STATISTIC(numPrivNoMemDep, "Number of false mem deps removed by privitization");
+STATISTIC(numVerdictHits, "Number of privatization verdicts served from cache");
 
 bool PrivRemedy::compare(const Remedy_ptr rhs) const {
   std::shared_ptr<PrivRemedy> privRhs =
@@ -160,6 +161,40 @@ bool PrivAA::isCheapPrivate(const Instruction *I, const Value **ptr,
   return false;
 }
 
+const PrivAA::PrivVerdict &
+PrivAA::getPrivVerdict(const Instruction *I, const Value *ptr, const Loop *L) {
+  if (verdictsVersion != asgn.getCheapPrivVersion()) {
+    opVerdicts.clear();
+    ptrVerdicts.clear();
+    verdictsVersion = asgn.getCheapPrivVersion();
+  }
+
+  std::map<VerdictKey, PrivVerdict> &verdicts = I ? opVerdicts : ptrVerdicts;
+  auto res = verdicts.insert(
+      std::make_pair(VerdictKey(I ? I : ptr, L), PrivVerdict()));
+  PrivVerdict &verdict = res.first->second;
+  if (!res.second) {
+    ++numVerdictHits;
+    return verdict;
+  }
+
+  Remedies R;
+  verdict.ptr = ptr;
+  verdict.cheap = isCheapPrivate(I, &verdict.ptr, L, R, verdict.aus);
+  verdict.R = std::make_shared<Remedies>(std::move(R));
+  return verdict;
+}
+
+void PrivAA::uponLoopFinished(const Loop *L) {
+  for (std::map<VerdictKey, PrivVerdict> *verdicts :
+       {&opVerdicts, &ptrVerdicts})
+    for (auto i = verdicts->begin(); i != verdicts->end();)
+      if (i->first.second == L)
+        i = verdicts->erase(i);
+      else
+        ++i;
+}
+
 LoopAA::AliasResult PrivAA::alias(const Value *P1, unsigned S1,
                                   TemporalRelation rel, const Value *P2,
                                   unsigned S2, const Loop *L, Remedies &R,
@@ -183,19 +218,20 @@ LoopAA::AliasResult PrivAA::alias(const Value *P1, unsigned S1,
   remedy->localPtr = nullptr;
   remedy->altPrivPtr = nullptr;
 
-  Remedies Ra, Rb, tmpR;
-  Ptrs ausA, ausB;
+  Remedies tmpR;
 
-  bool privateA = isCheapPrivate(nullptr, &P1, L, Ra, ausA);
-  bool privateB = isCheapPrivate(nullptr, &P2, L, Rb, ausB);
+  const PrivVerdict &privA = getPrivVerdict(nullptr, P1, L);
+  const PrivVerdict &privB = getPrivVerdict(nullptr, P2, L);
+  bool privateA = privA.cheap;
+  bool privateB = privB.cheap;
   if (privateA) {
-    for (auto remed : Ra)
+    for (auto remed : *privA.R)
       tmpR.insert(remed);
     remedy->privPtr = P1;
     if (privateB)
       remedy->altPrivPtr = P2;
   } else if (privateB) {
-    for (auto remed : Rb)
+    for (auto remed : *privB.R)
       tmpR.insert(remed);
     remedy->privPtr = P2;
     if (privateA)
@@ -224,20 +260,21 @@ LoopAA::ModRefResult PrivAA::modref(const Instruction *A, TemporalRelation rel,
   remedy->localPtr = nullptr;
   remedy->altPrivPtr = nullptr;
 
-  Remedies Ra, Rb, tmpR;
-  Ptrs ausA, ausB;
-  const Value *ptrA;
+  Remedies tmpR;
 
-  bool privateA = isCheapPrivate(A, &ptrA, L, Ra, ausA);
-  bool privateB = isCheapPrivate(nullptr, &ptrB, L, Rb, ausB);
+  const PrivVerdict &privA = getPrivVerdict(A, nullptr, L);
+  const PrivVerdict &privB = getPrivVerdict(nullptr, ptrB, L);
+  const Value *ptrA = privA.ptr;
+  bool privateA = privA.cheap;
+  bool privateB = privB.cheap;
   if (privateA) {
-    for (auto remed : Ra)
+    for (auto remed : *privA.R)
       tmpR.insert(remed);
     remedy->privPtr = ptrA;
     if (privateB)
       remedy->altPrivPtr = ptrB;
   } else if (privateB) {
-    for (auto remed : Rb)
+    for (auto remed : *privB.R)
       tmpR.insert(remed);
     remedy->privPtr = ptrB;
     if (privateA)
@@ -266,20 +303,21 @@ LoopAA::ModRefResult PrivAA::modref(const Instruction *A, TemporalRelation rel,
   remedy->localPtr = nullptr;
   remedy->altPrivPtr = nullptr;
 
-  Remedies Ra, Rb, tmpR;
-  Ptrs ausA, ausB;
-  const Value *ptrA, *ptrB;
+  Remedies tmpR;
 
-  bool privateA = isCheapPrivate(A, &ptrA, L, Ra, ausA);
-  bool privateB = isCheapPrivate(B, &ptrB, L, Rb, ausB);
+  const PrivVerdict &privA = getPrivVerdict(A, nullptr, L);
+  const PrivVerdict &privB = getPrivVerdict(B, nullptr, L);
+  const Value *ptrA = privA.ptr, *ptrB = privB.ptr;
+  bool privateA = privA.cheap;
+  bool privateB = privB.cheap;
   if (privateA) {
-    for (auto remed : Ra)
+    for (auto remed : *privA.R)
       tmpR.insert(remed);
     remedy->privPtr = ptrA;
     if (privateB)
       remedy->altPrivPtr = ptrB;
   } else if (privateB) {
-    for (auto remed : Rb)
+    for (auto remed : *privB.R)
       tmpR.insert(remed);
     remedy->privPtr = ptrB;
     if (privateA)
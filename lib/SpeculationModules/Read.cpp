@@ -13,6 +13,7 @@
 #include "scaf/Utilities/CallSiteFactory.h"
 #include "scaf/Utilities/FindUnderlyingObjects.h"
 #include "scaf/Utilities/GetMemOper.h"
+#include "scaf/Utilities/UnderlyingObjectsCache.h"
 
 #include <stdio.h>
 #include <sstream>
@@ -54,6 +55,10 @@ void Read::contextRenamedViaClone(
 
   // Update pointer residuals
   updateValue2Ctx2Residual( pointerResiduals, vmap, cmap );
+
+  // Cloning changed the IR; static underlying objects are stale.
+  if( uoc )
+    uoc->reset();
 }
 
 void Read::updateAu2Ctx2Count( AU2Ctx2Count &oldMap, const CtxToCtxMap &cmap, const AuToAuMap &amap)
@@ -897,11 +902,20 @@ bool Read::getUnderlyingAUs(const Value *ptr, const Ctx *ctx, Ptrs &aus) const
 //      isPointerInLoop = ctx->contains(iptr);
 
   // Find underlying objects using static info.
-  UO uos;
+  SmallVector<const Value*,4> computed;
+  ArrayRef<const Value*> uos;
 
   //errs() << "getUnderlyingAUs for ptr:  " << *ptr <<  '\n';
 
-  GetUnderlyingObjects(ptr, uos, *DL);
+  if( uoc )
+    uos = uoc->getUnderlyingObjects(ptr, *DL);
+  else
+  {
+    UO set;
+    GetUnderlyingObjects(ptr, set, *DL);
+    computed.append(set.begin(), set.end());
+    uos = computed;
+  }
 
 
   // Note that, even if the pointer is computed
@@ -910,7 +924,7 @@ bool Read::getUnderlyingAUs(const Value *ptr, const Ctx *ctx, Ptrs &aus) const
   // live-in values.
 
   // Map those to predictions.
-  for(UO::const_iterator i=uos.begin(), e=uos.end(); i!=e; ++i)
+  for(ArrayRef<const Value*>::iterator i=uos.begin(), e=uos.end(); i!=e; ++i)
   {
     const Value *uo = *i;
 
@@ -1012,7 +1026,7 @@ bool Read::areEverSimultaneouslyActive(const Ctx *A, const Ctx *B) const
   return false;
 }
 
-Read::Read() : SemanticAction(), pure(0), semi(0), ctrlspec(0)
+Read::Read() : SemanticAction(), pure(0), semi(0), ctrlspec(0), uoc(0)
 {
   fm = new FoldManager;
 }
@@ -1025,6 +1039,7 @@ Read::~Read()
 void Read::setPureFunAA(const PureFunAA *pfaa) { pure = pfaa; }
 void Read::setSemiLocalFunAA(const SemiLocalFunAA *slfaa) { semi = slfaa; }
 void Read::setControlSpeculator(ControlSpeculation *ctrl) { ctrlspec = ctrl; }
+void Read::setUnderlyingObjectsCache(UnderlyingObjectsCache *cache) { uoc = cache; }
 
 bool Read::predictIntAtLoop(const Value *v, const Ctx *ctx, Ints &predictions) const
 {
@@ -1116,6 +1131,9 @@ void Read::removeInstruction(const Instruction *no_longer_exists)
 {
   removeInstructionFromValue2Ctx2Ptrs(no_longer_exists, pointerPredictions);
   removeInstructionFromValue2Ctx2Ptrs(no_longer_exists, underlyingObjects);
+
+  if( uoc )
+    uoc->reset();
 }
 
 static cl::opt<std::string> ProfileFileName("specpriv-profile-filename",
@@ -1128,6 +1146,7 @@ void ReadPass::getAnalysisUsage(AnalysisUsage &au) const
   au.addRequired< PureFunAA >();
   au.addRequired< SemiLocalFunAA >();
   au.addRequired< ProfileGuidedControlSpeculator >();
+  au.addRequired< UnderlyingObjectsCache >();
   au.setPreservesAll();
 }
 
@@ -1155,6 +1174,8 @@ bool ReadPass::runOnModule(Module &mod)
 
   read->setDataLayout(DL);
 
+  read->setUnderlyingObjectsCache( &getAnalysis< UnderlyingObjectsCache >() );
+
   return false;
 }
 
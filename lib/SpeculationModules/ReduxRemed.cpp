@@ -25,6 +25,8 @@ STATISTIC(numRegDepsRemovedNoelleRedux,       "Num reg deps removed with noelle
 STATISTIC(numRegDepsRemovedRedux,             "Num reg deps removed with liberty redux");
 STATISTIC(numCondRegDepsRemoved,              "Num reg deps removed with cond redux");
 STATISTIC(numMemDepsRemovedRedux,             "Num mem deps removed");
+STATISTIC(numLoopsClassified,                 "Num loops whose reductions were classified");
+STATISTIC(numRegDepsClassified,               "Num reg deps classified");
 
 void ReduxRemedy::apply(Task *task) {
   // TODO: transfer the code for application of redux here.
@@ -41,6 +43,92 @@ bool ReduxRemedy::compare(const Remedy_ptr rhs) const {
     return (this->liveOutV == nullptr);
 }
 
+ReduxRemediator::LoopReductions &
+ReduxRemediator::getLoopReductions(const Loop *l) {
+  auto i = loopReductions.find(l);
+  if (i != loopReductions.end())
+    return i->second;
+
+  ++numLoopsClassified;
+  LoopReductions &redux = loopReductions[l];
+  Loop *ncL = const_cast<Loop *>(l);
+  findMemReductions(ncL, redux);
+  findMinMaxRegReductions(ncL);
+
+  // Classify the loop-carried register deps into each header PHI.
+  for (PHINode &phi : l->getHeader()->phis())
+    for (Value *incoming : phi.incoming_values()) {
+      const Instruction *src = dyn_cast<Instruction>(incoming);
+      if (src && l->contains(src))
+        getRegRedux(redux, src, &phi, l);
+    }
+
+  return redux;
+}
+
+const ReduxRemediator::RegRedux &
+ReduxRemediator::getRegRedux(LoopReductions &redux, const Instruction *A,
+                             const Instruction *B, const Loop *L) {
+  InstPair key(A, B);
+  auto i = redux.regDeps.find(key);
+  if (i != redux.regDeps.end())
+    return i->second;
+
+  RegRedux r = classifyRegDep(A, B, L);
+  return redux.regDeps[key] = r;
+}
+
+ReduxRemediator::RegRedux
+ReduxRemediator::classifyRegDep(const Instruction *A, const Instruction *B,
+                                const Loop *L) {
+  ++numRegDepsClassified;
+  RegRedux r;
+
+  //Liberty's reduction
+  if (reduxdet.isSumReduction(L, A, B, true, r.type)) {
+    r.kind = RegRedux::Sum;
+    return r;
+  }
+
+  //added support for cmpInst, before, only selectInst was supported
+  if (reduxdet.isMinMaxReduction(L, A, B, true, r.type, &r.depInst,
+                                 r.depType, &r.depUpdateInst, &r.cmpInst)) {
+    r.kind = RegRedux::MinMax;
+    return r;
+  }
+  r.type = Reduction::NotReduction;
+
+  // already know that instruction A is an operand of instruction B
+  RecurrenceDescriptor recdes;
+
+  // since we run loop-simplify
+  // before applying the remediators,
+  // loops should be in canonical
+  // form and have preHeaders. In
+  // some cases though, loopSimplify
+  // is unable to canonicalize some
+  // loops. Thus we need to check
+  // first
+
+  if (L->getLoopPreheader()) {
+    if (const PHINode *PhiB = dyn_cast<PHINode>(B)) {
+      if (RecurrenceDescriptor::isReductionPHI(const_cast<PHINode *>(PhiB),
+                                               const_cast<Loop *>(L),
+                                               recdes)) {
+        // B: x0 = phi(initial from outside loop, x1 from backedge)
+        // A: x1 = x0 + ..
+        r.kind = RegRedux::LLVM;
+        return r;
+      }
+    }
+  }
+
+  if (isConditionalReductionPHI(B, L))
+    r.kind = RegRedux::Cond;
+
+  return r;
+}
+
 bool ReduxRemediator::isRegReductionPHI(Instruction *I, Loop *l) {
   PHINode *phi = dyn_cast<PHINode>(I);
   if (phi == nullptr)
@@ -48,8 +136,10 @@ bool ReduxRemediator::isRegReductionPHI(Instruction *I, Loop *l) {
   if (l->getHeader() != I->getParent())
     return false;
   // check if result is cached
-  if (regReductions.count(I))
-    return true;
+  LoopReductions &redux = getLoopReductions(l);
+  auto cached = redux.regReductionPHIs.find(I);
+  if (cached != redux.regReductionPHIs.end())
+    return cached->second;
 
   std::set<PHINode*> ignore;
   VSet phis, binops, cmps, brs, liveOuts;
@@ -61,25 +151,27 @@ bool ReduxRemediator::isRegReductionPHI(Instruction *I, Loop *l) {
         type, opcode, phis, binops, cmps, brs, liveOuts, initVal) /*Outputs*/
      )
   {
-    Instruction *liveOutV = phi;
-    regReductions.insert(liveOutV);
-
-    errs() << "Found a register reduction:\n"
-           << "          PHI: " << *phi << '\n'
-           << "      Initial: " << *initVal << '\n'
-           << "    Internals:\n";
-    for(VSet::iterator i=phis.begin(), e=phis.end(); i!=e;  ++i)
-      errs() << "            o " << **i << '\n';
-    errs() << "      Updates:\n";
-    for(VSet::iterator i=binops.begin(), e=binops.end(); i!=e;  ++i)
-      errs() << "            o " << **i << '\n';
-
-    errs() << "    Live-outs:\n";
-    for(VSet::iterator i=liveOuts.begin(), e=liveOuts.end(); i!=e;  ++i)
-      errs() << "            o " << **i << '\n';
+    redux.regReductionPHIs[I] = true;
+
+    LLVM_DEBUG(
+      errs() << "Found a register reduction:\n"
+             << "          PHI: " << *phi << '\n'
+             << "      Initial: " << *initVal << '\n'
+             << "    Internals:\n";
+      for(VSet::iterator i=phis.begin(), e=phis.end(); i!=e;  ++i)
+        errs() << "            o " << **i << '\n';
+      errs() << "      Updates:\n";
+      for(VSet::iterator i=binops.begin(), e=binops.end(); i!=e;  ++i)
+        errs() << "            o " << **i << '\n';
+
+      errs() << "    Live-outs:\n";
+      for(VSet::iterator i=liveOuts.begin(), e=liveOuts.end(); i!=e;  ++i)
+        errs() << "            o " << **i << '\n';
+    );
 
       return true;
   }
+  redux.regReductionPHIs[I] = false;
   return false;
 }
 
@@ -144,7 +236,7 @@ void ReduxRemediator::findMinMaxRegReductions(Loop *l) {
   reduxdet.findMinMaxRegReductions(l, pdg);
 }
 
-void ReduxRemediator::findMemReductions(Loop *l) {
+void ReduxRemediator::findMemReductions(Loop *l, LoopReductions &redux) {
 
   std::set<Value *> visitedAccums;
   const std::vector<Loop *> subloops = l->getSubLoops();
@@ -196,7 +288,7 @@ void ReduxRemediator::findMemReductions(Loop *l) {
 
       // Now this is a reduction
       // This should be either add reduction or min/max reduction
-      memReductions.insert(store);
+      redux.memReductions.insert(store);
     }
   }
 }
@@ -205,7 +297,8 @@ bool ReduxRemediator::isMemReduction(const Instruction *I) {
   const StoreInst *sI = dyn_cast<StoreInst>(I);
   if (!sI)
     return false;
-  if (memReductions.count(sI))
+  assert(current && "No loop of interest");
+  if (current->memReductions.count(sI))
     return true;
 
   return false;
@@ -238,10 +331,6 @@ Remediator::RemedResp ReduxRemediator::regdep(const Instruction *A,
   // flag. Compiling with the flag will produce more optimal code overall and
   // should eventually be used.
 
-  Instruction *ncA = const_cast<Instruction*>(A);
-  Instruction *ncB = const_cast<Instruction*>(B);
-  Loop *ncL = const_cast<Loop *>(L);
-  Reduction::Type type;
   remedy->depInst = nullptr;
   remedy->depType = Reduction::NotReduction;
   remedy->depUpdateInst = nullptr;
@@ -261,151 +350,44 @@ Remediator::RemedResp ReduxRemediator::regdep(const Instruction *A,
   //errs() << "  Redux remed examining edge(s) from " << *A << " to " << *B
   //       << '\n';
 
-  //Liberty's reduction
-  if (reduxdet.isSumReduction(L, A, B, loopCarried, type)) {
+  const RegRedux &r = getRegRedux(getLoopReductions(L), A, B, L);
+
+  switch (r.kind) {
+  case RegRedux::Sum:
     ++numRegDepsRemovedSumRedux;
     LLVM_DEBUG(errs() << "Resolved by liberty sumRedux\n");
-    LLVM_DEBUG(errs() << "Removed reg dep between inst " << *A << "  and  " << *B
-                 << '\n');
-    remedResp.depRes = DepResult::NoDep;
-    remedy->liveOutV = B;
-    remedy->type = type;
-    remedy->reduxSCC = nullptr;
-    remedResp.remedy = remedy;
-    return remedResp;
-  }
-  const Instruction *depInst;
-  Reduction::Type depType;
-  const Instruction *depUpdateInst;
-  const CmpInst *cmpInst; //added support for cmpInst, before, only selectInst was supported
-  if (reduxdet.isMinMaxReduction(L, A, B, loopCarried, type, &depInst,
-                                 depType, &depUpdateInst, &cmpInst)) {
+    break;
+  case RegRedux::MinMax:
     ++numRegDepsRemovedMinMaxRedux;
     LLVM_DEBUG(errs() << "Resolved by liberty MinMaxRedux\n");
-    LLVM_DEBUG(errs() << "Removed reg dep between inst " << *A << "  and  " << *B
-                 << '\n');
-    remedResp.depRes = DepResult::NoDep;
-    remedy->liveOutV = B;
-    remedy->type = type;
-    remedy->depInst = depInst;
-    remedy->depType = depType;
-    remedy->depUpdateInst = depUpdateInst;
-    remedy->reduxSCC = nullptr;
-    remedy->cmpInst = cmpInst;
-    remedResp.remedy = remedy;
-    return remedResp;
-  }
-
-  //noelle's reduction
-  /*auto aSCC = loopDepInfo->getSCCManager()->getSCCDAG()->sccOfValue(ncA);
-  auto bSCC = loopDepInfo->getSCCManager()->getSCCDAG()->sccOfValue(ncB);
-  if (aSCC == bSCC &&
-      loopDepInfo->getSCCManager()->getSCCAttrs(aSCC)->canExecuteReducibly()) {
-    ++numRegDepsRemovedNoelleRedux;
-    LLVM_DEBUG(errs() << "Resolved by noelle Redux\n");
-    LLVM_DEBUG(errs() << "Removed reg dep between inst " << *A << "  and  " << *B
-                 << '\n');
-    remedResp.depRes = DepResult::NoDep;
-    remedy->reduxSCC = aSCC;
-    if (isa<PHINode>(B))
-      remedy->liveOutV = B;
-
-    bool foundAssocCommutBinOp = false;
-    for (auto node : make_range(aSCC->begin_nodes(), aSCC->end_nodes())) {
-      if (!aSCC->isInternal(node->getT()))
-        continue;
-
-      BinaryOperator *binop = dyn_cast<BinaryOperator>(node->getT());
-
-      if (binop) {
-        if (Reduction::Type type = Reduction::isAssocAndCommut(binop)) {
-          if (foundAssocCommutBinOp && (type != remedy->type)) {
-            errs() << "More than 1 accoc & commut binops in redux SCC!!";
-            remedResp.depRes = DepResult::Dep;
-            return remedResp;
-          }
-          //assert((!foundAssocCommutBinOp || (type == remedy->type)) &&
-          //       "More than 1 accoc & commut binops in redux SCC!!");
-          foundAssocCommutBinOp = true;
-          remedy->type = type;
-          LLVM_DEBUG(errs() << "Binop in redux SCC: " << *binop
-                       << " ,and redux type:" << type << '\n');
-        }
-      }
-    }
-    if (!foundAssocCommutBinOp) {
-      errs() << "Noelle redux SCC does not have a assoc & commut binop!!\n";
-      remedResp.depRes = DepResult::Dep;
-      return remedResp;
-    }
-    //assert(foundAssocCommutBinOp &&
-    //       "Noelle redux SCC does not have a assoc & commut binop!!");
-
-    remedResp.remedy = remedy;
-    return remedResp;
-  }*/
-
-  // use Nick's Redux
-  /*if (isRegReductionPHI(ncB, ncL)) {
+    remedy->depInst = r.depInst;
+    remedy->depType = r.depType;
+    remedy->depUpdateInst = r.depUpdateInst;
+    remedy->cmpInst = r.cmpInst;
+    break;
+  case RegRedux::LLVM:
     // B: x0 = phi(initial from outside loop, x1 from backedge)
     // A: x1 = x0 + ..
     // Loop-carried dep removed
-    ++numRegDepsRemovedRedux;
-    LLVM_DEBUG(errs() << "Resolved by liberty (specpriv but hopefully conservative) redux detection (loop-carried)\n");
-    LLVM_DEBUG(errs() << "Removed reg dep between inst " << *A << "  and  " << *B
-                 << '\n');
-    remedResp.depRes = DepResult::NoDep;
-    remedy->liveOutV = B;
-    remedy->reduxSCC = nullptr;
-    remedResp.remedy = remedy;
-    return remedResp;
-  }*/
-
-  // already know that instruction A is an operand of instruction B
-  RecurrenceDescriptor recdes;
-
-  // since we run loop-simplify
-  // before applying the remediators,
-  // loops should be in canonical
-  // form and have preHeaders. In
-  // some cases though, loopSimplify
-  // is unable to canonicalize some
-  // loops. Thus we need to check
-  // first
-
-  if (L->getLoopPreheader()) {
-    if (PHINode *PhiB = dyn_cast<PHINode>(ncB)) {
-      if (RecurrenceDescriptor::isReductionPHI(PhiB, ncL,
-                                               recdes)) {
-        // B: x0 = phi(initial from outside loop, x1 from backedge)
-        // A: x1 = x0 + ..
-        // Loop-carried dep removed
-        ++numRegDepsRemovedLLVMRedux;
-        LLVM_DEBUG(errs() << "Resolved by llvm redux detection (loop-carried)\n");
-        LLVM_DEBUG(errs() << "Removed reg dep between inst " << *A << "  and  " << *B
-                     << '\n');
-        remedResp.depRes = DepResult::NoDep;
-        remedy->liveOutV = B;
-        remedy->reduxSCC = nullptr;
-        remedResp.remedy = remedy;
-        return remedResp;
-      }
-    }
-  }
-
-  if (isConditionalReductionPHI(B, L)) {
+    ++numRegDepsRemovedLLVMRedux;
+    LLVM_DEBUG(errs() << "Resolved by llvm redux detection (loop-carried)\n");
+    break;
+  case RegRedux::Cond:
     ++numCondRegDepsRemoved;
     LLVM_DEBUG(errs() << "Resolved by cond redux detection\n");
-    LLVM_DEBUG(errs() << "Removed reg dep between inst " << *A << "  and  " << *B
-                 << '\n');
-    remedResp.depRes = DepResult::NoDep;
-    remedy->liveOutV = B;
-    remedy->reduxSCC = nullptr;
+    break;
+  case RegRedux::None:
+    //errs() << "Redux remed unable to resolve this dep\n";
     remedResp.remedy = remedy;
     return remedResp;
   }
 
-  //errs() << "Redux remed unable to resolve this dep\n";
+  LLVM_DEBUG(errs() << "Removed reg dep between inst " << *A << "  and  " << *B
+               << '\n');
+  remedResp.depRes = DepResult::NoDep;
+  remedy->liveOutV = B;
+  remedy->type = r.type;
+  remedy->reduxSCC = nullptr;
   remedResp.remedy = remedy;
   return remedResp;
 }
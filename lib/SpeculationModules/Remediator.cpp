@@ -138,6 +138,13 @@ namespace liberty
     return ptr;
   }
 
+  // What an operation may do to memory at all
+  static LoopAA::ModRefResult mayModRef(const Instruction *inst) {
+    return LoopAA::ModRefResult(
+        (inst->mayWriteToMemory() ? LoopAA::Mod : LoopAA::NoModRef) |
+        (inst->mayReadFromMemory() ? LoopAA::Ref : LoopAA::NoModRef));
+  }
+
   // FIXME:
   // is this necessary? Shouldn't the aa stack by construct finds the cheapest?
   bool Remediator::noMemoryDep(const Instruction *src, const Instruction *dst,
@@ -177,17 +184,31 @@ namespace liberty
       }
     }
 
+    // The remaining queries could only find an answer as cheap as this
+    if (aliasRes == LoopAA::NoModRef && aa->isCheapestPossible(aliasRemeds)) {
+      LoopAA::appendRemedies(R, aliasRemeds);
+      return true;
+    }
+
     // forward dep test
     LoopAA::ModRefResult forward = aa->modref(src, FW, dst, loop, fwdRemeds);
+    forward = LoopAA::ModRefResult(forward & mayModRef(src));
 
     if (LoopAA::NoModRef == forward)
       fwdRes = LoopAA::NoModRef;
 
+    if (fwdRes == LoopAA::NoModRef && aliasRes != LoopAA::NoModRef &&
+        aa->isCheapestPossible(fwdRemeds)) {
+      LoopAA::appendRemedies(R, fwdRemeds);
+      return true;
+    }
+
     // reverse dep test
     LoopAA::ModRefResult reverse = forward;
 
     if (FW != RV || src != dst) {
       reverse = aa->modref(dst, RV, src, loop, reverseRemeds);
+      reverse = LoopAA::ModRefResult(reverse & mayModRef(dst));
 
       if (LoopAA::NoModRef == reverse)
         reverseRes = LoopAA::NoModRef;
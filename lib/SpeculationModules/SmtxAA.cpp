@@ -57,6 +57,12 @@ namespace liberty::SpecPriv
     this->cost = perf->weight_with_gravity(this->memI, validation_weight);
   }
 
+  LoopAA::RemedyRank SmtxAA::getMinRemedyRank() const {
+    // Every answer relies on profiled (expensive) remedies,
+    // though their cost depends on the instructions.
+    return RemedyRank(false, true, 0);
+  }
+
   LoopAA::AliasResult SmtxAA::alias(const Value *ptrA, unsigned sizeA,
                                     TemporalRelation rel, const Value *ptrB,
                                     unsigned sizeB, const Loop *L, Remedies &R,
@@ -60,6 +60,10 @@ bool TXIOAA::isTXIOFcn(const Instruction *inst) {
   return false;
 }
 
+LoopAA::RemedyRank TXIOAA::getMinRemedyRank() const {
+  return RemedyRank(false, false, DEFAULT_TXIO_REMED_COST);
+}
+
 LoopAA::AliasResult TXIOAA::alias(const Value *ptrA, unsigned sizeA,
                                   TemporalRelation rel, const Value *ptrB,
                                   unsigned sizeB, const Loop *L, Remedies &R,
@@ -0,0 +1,46 @@
+#define DEBUG_TYPE "transitive-control-deps"
+
+#include "scaf/SpeculationModules/TransitiveControlDeps.hpp"
+
+namespace liberty {
+using namespace llvm;
+
+TransitiveControlDeps::TransitiveControlDeps(const CompactPDG &pdg)
+    : loop(pdg.getLoop()),
+      sccs(pdg, 1u << CompactPDG::getKind(CompactPDG::CtrlDep,
+                                          CompactPDG::DataRAW, false)) {
+  sccs.compute();
+
+  const unsigned N = pdg.getNumInstructions();
+  const unsigned numSCCs = sccs.getNumSCCs();
+  rows.assign(numSCCs, NoRow);
+
+  // Successors come later in topological order,
+  // so visit them first.
+  for (unsigned scc = numSCCs; scc-- > 0;) {
+    ArrayRef<unsigned> succs = sccs.getSuccessors(scc);
+    if (succs.empty())
+      continue;
+
+    BitVector row(N);
+    for (unsigned succ : succs) {
+      for (unsigned inst : sccs.getMembers(succ))
+        row.set(inst);
+      if (rows[succ] != NoRow)
+        row |= reached[rows[succ]];
+    }
+
+    rows[scc] = reached.size();
+    reached.push_back(std::move(row));
+  }
+}
+
+bool TransitiveControlDeps::isControlDependent(unsigned src,
+                                               unsigned dst) const {
+  const unsigned scc = sccs.getSCC(src);
+  if (sccs.isRecurrent(scc) && sccs.getSCC(dst) == scc)
+    return true;
+  return rows[scc] != NoRow && reached[rows[scc]].test(dst);
+}
+
+} // namespace liberty
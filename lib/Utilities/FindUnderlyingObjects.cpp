@@ -90,7 +90,7 @@ static void GetUnderlyingObjects(const Value *ptr, UO &beforePHI,
 }
 
 void GetUnderlyingObjects(const Value *ptr, UO &beforePHI, UO &afterPHI,
-                          bool isAfterPHI, const DataLayout &DL) {
+                          const DataLayout &DL, bool isAfterPHI) {
   UO visitedBefore, visitedAfter;
   GetUnderlyingObjects(ptr, beforePHI, visitedBefore, afterPHI, visitedAfter,
                        DL, isAfterPHI);
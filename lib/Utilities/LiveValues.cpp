@@ -1,5 +1,6 @@
 #define DEBUG_TYPE "live-values"
 
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/IR/CFG.h"
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Instructions.h"
@@ -18,8 +19,16 @@ typedef GB::ChildIteratorType GBI;
 typedef GraphTraits<Inverse<const BasicBlock *>> GR;
 typedef GR::ChildIteratorType GRI;
 
-LiveValues::LiveValues(const Function &fcn, bool includeFcnArgs)
-    : numbers(), revNumbers(), OUT() {
+LiveValues::LiveValues(const Function &fcn, bool includeFcnArgs, bool lazy)
+    : function(&fcn), includeFcnArgs(includeFcnArgs), lazy(lazy), numbers(),
+      revNumbers(), OUT() {
+  // In lazy mode, all work is deferred to the queries.
+  if (!lazy)
+    runDataflow();
+}
+
+void LiveValues::runDataflow() {
+  const Function &fcn = *function;
   LLVM_DEBUG(errs() << "\t- Performing dataflow analysis");
 
   // Now we are going to do some data flow analysis
@@ -157,6 +166,20 @@ void LiveValues::assignValueNumber(const Value *v) {
   revNumbers.push_back(v);
 }
 
+/// Sanity: ensure this is a definition.
+static bool isDefinition(const Value *lv) {
+  if (isa<StoreInst>(lv))
+    return false;
+  if (const Instruction *lvi = dyn_cast<Instruction>(lv))
+    if (lvi->isTerminator())
+      if (!isa<InvokeInst>(lv))
+        return false;
+  if (lv->getType()->isVoidTy())
+    return false;
+
+  return true;
+}
+
 static void translateBitVectorToValues(const BitVector &bitset,
                                        const LiveValues::Num2Value &revNumbers,
                                        LiveValues::ValueList &valueset) {
@@ -168,23 +191,27 @@ static void translateBitVectorToValues(const BitVector &bitset,
   // <==> for each live value in the set.
   for (int j = bitset.find_first(); j >= 0; j = bitset.find_next(j)) {
     const Value *lv = revNumbers[j];
-
-    // sanity: ensure this is a definition
-    if (isa<StoreInst>(lv))
-      continue;
-    if (const Instruction *lvi = dyn_cast<Instruction>(lv))
-      if (lvi->isTerminator())
-        if (!isa<InvokeInst>(lv))
-          continue;
-    if (lv->getType()->isVoidTy())
-      continue;
-
-    valueset.push_back(lv);
+    if (isDefinition(lv))
+      valueset.push_back(lv);
   }
 }
 
 void LiveValues::findLiveInToBB(const BasicBlock *bb,
                                 ValueList &liveIns) const {
+  if (lazy) {
+    BlockSet targets, phiPreds;
+    targets.insert(bb);
+
+    // Be conservative, since the query
+    // doesn't provide specific info.
+    if (const PHINode *phi = dyn_cast<PHINode>(&bb->front()))
+      for (unsigned j = 0, N = phi->getNumIncomingValues(); j < N; ++j)
+        phiPreds.insert(phi->getIncomingBlock(j));
+
+    collectLiveIn(targets, phiPreds, bb, liveIns);
+    return;
+  }
+
   ValueSets::const_iterator i = OUT.find(bb);
   if (i == OUT.end())
     return;
@@ -208,6 +235,14 @@ void LiveValues::findLiveValuesAcrossEdge(const BasicBlock *pred,
                                           ValueList &liveIns) const {
   const BasicBlock *bb = pred->getTerminator()->getSuccessor(succno);
 
+  if (lazy) {
+    BlockSet targets, phiPreds;
+    targets.insert(bb);
+    phiPreds.insert(pred);
+    collectLiveIn(targets, phiPreds, bb, liveIns);
+    return;
+  }
+
   ValueSets::const_iterator i = OUT.find(bb);
   if (i == OUT.end())
     return;
@@ -252,6 +287,21 @@ void LiveValues::computeIN(const BasicBlock *bb, BitVector &IN) const {
 
 void LiveValues::findLiveOutFromBB(const BasicBlock *bb,
                                    ValueList &liveIns) const {
+  if (lazy) {
+    if (includeFcnArgs)
+      for (Function::const_arg_iterator i = function->arg_begin(),
+                                        e = function->arg_end();
+           i != e; ++i)
+        if (isCandidate(&*i) && isLiveOutFromBB(&*i, bb))
+          liveIns.push_back(&*i);
+
+    for (const_inst_iterator i = inst_begin(function), e = inst_end(function);
+         i != e; ++i)
+      if (isCandidate(&*i) && isLiveOutFromBB(&*i, bb))
+        liveIns.push_back(&*i);
+    return;
+  }
+
   BitVector inbb;
   computeIN(bb, inbb);
 
@@ -263,6 +313,49 @@ void LiveValues::findLiveValuesAfterInst(const Instruction *inst,     // input
 {
   const BasicBlock *bb = inst->getParent();
 
+  if (lazy) {
+    // Start from the values live-out of bb...
+    ValueList liveOuts;
+    findLiveOutFromBB(bb, liveOuts);
+    DenseSet<const Value *> live(liveOuts.begin(), liveOuts.end());
+
+    // ...and step backwards to inst.
+    BasicBlock::const_iterator j = bb->end(), f = bb->begin();
+    while (j != f) {
+      --j;
+      const Instruction *def = &*j;
+
+      if (def == inst)
+        break;
+
+      live.erase(def);
+
+      if (isa<PHINode>(def))
+        continue;
+
+      typedef Instruction::const_op_iterator OpIt;
+      for (OpIt k = def->op_begin(), g = def->op_end(); k != g; ++k) {
+        const Value *use = *k;
+        if (isCandidate(use))
+          live.insert(use);
+      }
+    }
+
+    // Report in the same order as the eager mode.
+    if (includeFcnArgs)
+      for (Function::const_arg_iterator i = function->arg_begin(),
+                                        e = function->arg_end();
+           i != e; ++i)
+        if (live.count(&*i))
+          liveValues.push_back(&*i);
+
+    for (const_inst_iterator i = inst_begin(function), e = inst_end(function);
+         i != e; ++i)
+      if (live.count(&*i))
+        liveValues.push_back(&*i);
+    return;
+  }
+
   BitVector bitset;
   computeIN(bb, bitset);
 
@@ -275,25 +368,151 @@ void LiveValues::findLiveValuesAfterInst(const Instruction *inst,     // input
     if (def == inst)
       break;
 
+    // Record the defs
     Value2Num::const_iterator i = numbers.find(def);
-    if (i != numbers.end()) {
-      // Record the defs
+    if (i != numbers.end())
       bitset.reset(i->second);
 
-      // Record the uses
-      typedef Instruction::const_op_iterator OpIt;
-      for (OpIt k = def->op_begin(), g = def->op_end(); k != g; ++k) {
-        const Value *use = *k;
-        Value2Num::const_iterator i = numbers.find(use);
-        if (i == numbers.end())
-          continue;
+    // Record the uses, exactly as GEN does:
+    // stores and other void instructions use
+    // values too, but PHIs use them on edges.
+    if (isa<PHINode>(def))
+      continue;
 
-        bitset.set(i->second);
-      }
+    typedef Instruction::const_op_iterator OpIt;
+    for (OpIt k = def->op_begin(), g = def->op_end(); k != g; ++k) {
+      const Value *use = *k;
+      Value2Num::const_iterator i = numbers.find(use);
+      if (i == numbers.end())
+        continue;
+
+      bitset.set(i->second);
     }
   }
 
   translateBitVectorToValues(bitset, revNumbers, liveValues);
 }
 
+bool LiveValues::isCandidate(const Value *v) const {
+  // Same population the eager mode numbers.
+  if (v->use_empty())
+    return false;
+
+  if (const Argument *arg = dyn_cast<Argument>(v)) {
+    if (!includeFcnArgs || arg->getParent() != function)
+      return false;
+  } else if (const Instruction *inst = dyn_cast<Instruction>(v)) {
+    if (inst->getParent()->getParent() != function)
+      return false;
+  } else
+    return false;
+
+  return isDefinition(v);
+}
+
+bool LiveValues::isLiveInToAny(const Value *v, const BlockSet &targets) const {
+  // In SSA, a value is live-in to a block iff
+  // there is a path from that block to a use
+  // which does not pass through the def.  So,
+  // walk backwards from each use, stopping at
+  // the def's block, and see if we hit a target.
+  const BasicBlock *defBB = nullptr;
+  if (const Instruction *def = dyn_cast<Instruction>(v))
+    defBB = def->getParent();
+
+  BlockSet visited;
+  std::vector<const BasicBlock *> fringe;
+  for (const Use &use : v->uses()) {
+    const Instruction *user = dyn_cast<Instruction>(use.getUser());
+    if (!user)
+      continue;
+
+    // A PHI uses its operand at the end
+    // of the corresponding predecessor.
+    const BasicBlock *bb = user->getParent();
+    if (const PHINode *phi = dyn_cast<PHINode>(user))
+      bb = phi->getIncomingBlock(use);
+
+    if (bb == defBB)
+      continue;
+
+    if (visited.insert(bb).second)
+      fringe.push_back(bb);
+  }
+
+  while (!fringe.empty()) {
+    const BasicBlock *bb = fringe.back();
+    fringe.pop_back();
+
+    if (targets.count(bb))
+      return true;
+
+    for (GRI i = GR::child_begin(bb), e = GR::child_end(bb); i != e; ++i) {
+      const BasicBlock *pred = *i;
+      if (pred == defBB)
+        continue;
+
+      if (visited.insert(pred).second)
+        fringe.push_back(pred);
+    }
+  }
+
+  return false;
+}
+
+bool LiveValues::isLiveOutFromBB(const Value *v, const BasicBlock *bb) const {
+  BlockSet succs;
+  for (GBI i = GB::child_begin(bb), e = GB::child_end(bb); i != e; ++i) {
+    const BasicBlock *succ = *i;
+    succs.insert(succ);
+
+    for (BasicBlock::const_iterator k = succ->begin(), z = succ->end(); k != z;
+         ++k) {
+      const PHINode *phi = dyn_cast<PHINode>(&*k);
+      if (!phi)
+        break;
+
+      if (phi->getIncomingValueForBlock(bb) == v)
+        return true;
+    }
+  }
+
+  return isLiveInToAny(v, succs);
+}
+
+void LiveValues::collectLiveIn(const BlockSet &targets,
+                               const BlockSet &phiPreds,
+                               const BasicBlock *phiBlock,
+                               ValueList &liveIns) const {
+  // Values used by the PHIs of phiBlock along
+  // any of the edges from phiPreds.
+  DenseSet<const Value *> phiUses;
+  for (BasicBlock::const_iterator k = phiBlock->begin(), z = phiBlock->end();
+       k != z; ++k) {
+    const PHINode *phi = dyn_cast<PHINode>(&*k);
+    if (!phi)
+      break;
+
+    for (const BasicBlock *pred : phiPreds) {
+      const Value *use = phi->getIncomingValueForBlock(pred);
+      assert(use);
+      phiUses.insert(use);
+    }
+  }
+
+  if (includeFcnArgs)
+    for (Function::const_arg_iterator i = function->arg_begin(),
+                                      e = function->arg_end();
+         i != e; ++i)
+      if (isCandidate(&*i))
+        if (phiUses.count(&*i) || isLiveInToAny(&*i, targets))
+          liveIns.push_back(&*i);
+
+  for (const_inst_iterator i = inst_begin(function), e = inst_end(function);
+       i != e; ++i)
+    if (isCandidate(&*i))
+      if (phiUses.count(&*i) || isLiveInToAny(&*i, targets))
+        liveIns.push_back(&*i);
+}
+
 } // namespace liberty
@@ -0,0 +1,184 @@
+#define DEBUG_TYPE "underlying-objects-cache"
+
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Value.h"
+
+#include "scaf/Utilities/CaptureUtil.h"
+#include "scaf/Utilities/FindUnderlyingObjects.h"
+#include "scaf/Utilities/UnderlyingObjectsCache.h"
+
+#include <algorithm>
+
+namespace liberty {
+using namespace llvm;
+
+STATISTIC(numHits, "Num underlying object/capture queries served from cache");
+STATISTIC(numMisses, "Num underlying object/capture queries computed");
+STATISTIC(numResets, "Num times the cache was reset");
+
+void UnderlyingObjectsCache::Watch::deleted() {
+  cache->stale = true;
+  CallbackVH::deleted();
+}
+
+void UnderlyingObjectsCache::Watch::allUsesReplacedWith(Value *) {
+  cache->stale = true;
+}
+
+UnderlyingObjectsCache::UnderlyingObjectsCache()
+    : ImmutablePass(ID), stale(false) {}
+
+UnderlyingObjectsCache::~UnderlyingObjectsCache() { reset(); }
+
+void UnderlyingObjectsCache::reset() {
+  underlying.clear();
+  underlyingSplit.clear();
+  found.clear();
+  captureSets.clear();
+  captured.clear();
+  watched.clear();
+  watches.clear();
+  storage.Reset();
+  stale = false;
+}
+
+void UnderlyingObjectsCache::checkStale() {
+  if (!stale)
+    return;
+
+  ++numResets;
+  reset();
+}
+
+void UnderlyingObjectsCache::watch(const Value *v) {
+  if (watched.insert(v).second)
+    watches.emplace_back(const_cast<Value *>(v), this);
+}
+
+template <class Collection>
+UnderlyingObjectsCache::Objects
+UnderlyingObjectsCache::intern(const Collection &values) {
+  if (values.empty())
+    return Objects();
+
+  const Value **array = storage.Allocate<const Value *>(values.size());
+  std::copy(values.begin(), values.end(), array);
+
+  // Results must not outlive the values they name.
+  for (const Value *v : values)
+    watch(v);
+
+  // Sorted, so that clients may compare two results or binary
+  // search them, just as they would a std::set.
+  std::sort(array, array + values.size());
+  return Objects(array, values.size());
+}
+
+UnderlyingObjectsCache::Objects
+UnderlyingObjectsCache::getUnderlyingObjects(const Value *ptr,
+                                             const DataLayout &DL) {
+  checkStale();
+
+  Value2Objects::iterator i = underlying.find(ptr);
+  if (i != underlying.end()) {
+    ++numHits;
+    return i->second;
+  }
+
+  ++numMisses;
+  UO uo;
+  liberty::GetUnderlyingObjects(ptr, uo, DL);
+
+  watch(ptr);
+  return underlying[ptr] = intern(uo);
+}
+
+void UnderlyingObjectsCache::getUnderlyingObjects(const Value *ptr,
+                                                  Objects &beforePHI,
+                                                  Objects &afterPHI,
+                                                  const DataLayout &DL) {
+  checkStale();
+
+  Value2Split::iterator i = underlyingSplit.find(ptr);
+  if (i != underlyingSplit.end()) {
+    ++numHits;
+    beforePHI = i->second.first;
+    afterPHI = i->second.second;
+    return;
+  }
+
+  ++numMisses;
+  UO before, after;
+  liberty::GetUnderlyingObjects(ptr, before, after, DL);
+
+  watch(ptr);
+  beforePHI = intern(before);
+  afterPHI = intern(after);
+  underlyingSplit[ptr] = std::make_pair(beforePHI, afterPHI);
+}
+
+UnderlyingObjectsCache::Objects
+UnderlyingObjectsCache::findUnderlyingObjects(const Value *value) {
+  checkStale();
+
+  Value2Objects::iterator i = found.find(value);
+  if (i != found.end()) {
+    ++numHits;
+    return i->second;
+  }
+
+  ++numMisses;
+  ObjectSet objects;
+  liberty::findUnderlyingObjects(value, objects);
+
+  watch(value);
+  return found[value] = intern(objects);
+}
+
+bool UnderlyingObjectsCache::isCaptured(const Value *v) {
+  checkStale();
+
+  // A complete capture set answers this question too.
+  Value2Objects::iterator i = captureSets.find(v);
+  if (i != captureSets.end()) {
+    ++numHits;
+    return !i->second.empty();
+  }
+
+  DenseMap<const Value *, bool>::iterator j = captured.find(v);
+  if (j != captured.end()) {
+    ++numHits;
+    return j->second;
+  }
+
+  ++numMisses;
+  watch(v);
+  return captured[v] = liberty::findAllCaptures(v);
+}
+
+bool UnderlyingObjectsCache::findAllCaptures(const Value *v,
+                                             Objects &captures) {
+  checkStale();
+
+  Value2Objects::iterator i = captureSets.find(v);
+  if (i != captureSets.end()) {
+    ++numHits;
+    captures = i->second;
+    return !captures.empty();
+  }
+
+  ++numMisses;
+  CaptureSet set;
+  liberty::findAllCaptures(v, &set);
+
+  watch(v);
+  captures = captureSets[v] = intern(set);
+  return !captures.empty();
+}
+
+char UnderlyingObjectsCache::ID = 0;
+static RegisterPass<UnderlyingObjectsCache>
+    rp("underlying-objects-cache",
+       "Memoize underlying objects and capture sets", false, true);
+
+} // namespace liberty